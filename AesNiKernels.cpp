@@ -0,0 +1,317 @@
+#include "AesNiKernels.h"
+
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PFS_HAS_AESNI_KERNELS 1
+#endif
+
+#ifdef PFS_HAS_AESNI_KERNELS
+
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AESNI_TARGET
+#else
+#include <cpuid.h>
+#define AESNI_TARGET __attribute__((target("aes,sse4.1")))
+#endif
+
+//number of blocks that are processed in parallel to hide latency of aes instructions
+#define AESNI_INTERLEAVE 8
+
+namespace {
+
+bool detect_aesni()
+{
+   unsigned int regs[4] = {0};
+
+#ifdef _MSC_VER
+   int info[4];
+   __cpuid(info, 1);
+   for(int i = 0; i < 4; i++)
+      regs[i] = (unsigned int)info[i];
+#else
+   if(!__get_cpuid(1, &regs[0], &regs[1], &regs[2], &regs[3]))
+      return false;
+#endif
+
+   //ecx bit 25 - AES, ecx bit 19 - SSE4.1
+   return (regs[2] & (1u << 25)) != 0 && (regs[2] & (1u << 19)) != 0;
+}
+
+//aes-128 key schedule
+
+template<int rcon>
+AESNI_TARGET inline __m128i expand_step_128(__m128i key)
+{
+   __m128i gen = _mm_aeskeygenassist_si128(key, rcon);
+   gen = _mm_shuffle_epi32(gen, 0xFF);
+   key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+   key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+   key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+   return _mm_xor_si128(key, gen);
+}
+
+AESNI_TARGET void expand_enc_key_128(const unsigned char* key, __m128i* rk)
+{
+   rk[0] = _mm_loadu_si128((const __m128i*)key);
+   rk[1] = expand_step_128<0x01>(rk[0]);
+   rk[2] = expand_step_128<0x02>(rk[1]);
+   rk[3] = expand_step_128<0x04>(rk[2]);
+   rk[4] = expand_step_128<0x08>(rk[3]);
+   rk[5] = expand_step_128<0x10>(rk[4]);
+   rk[6] = expand_step_128<0x20>(rk[5]);
+   rk[7] = expand_step_128<0x40>(rk[6]);
+   rk[8] = expand_step_128<0x80>(rk[7]);
+   rk[9] = expand_step_128<0x1B>(rk[8]);
+   rk[10] = expand_step_128<0x36>(rk[9]);
+}
+
+//decryption schedule for equivalent inverse cipher
+AESNI_TARGET void expand_dec_key_128(const __m128i* enc, __m128i* rk)
+{
+   rk[0] = enc[10];
+   for(int i = 1; i < 10; i++)
+      rk[i] = _mm_aesimc_si128(enc[10 - i]);
+   rk[10] = enc[0];
+}
+
+//multiplication of tweak by x in GF(2^128)
+//this is bit exact equivalent of adds/adcs chain in xts_generate_mask_generic
+//each 32 bit lane is shifted left and carry of previous lane is added. carry of last lane is reduced with 0x87
+AESNI_TARGET inline __m128i xts_double(__m128i t)
+{
+   const __m128i poly = _mm_set_epi32(1, 1, 1, 0x87);
+   __m128i carry = _mm_srai_epi32(t, 31);
+   carry = _mm_shuffle_epi32(carry, 0x93);
+   carry = _mm_and_si128(carry, poly);
+   t = _mm_add_epi32(t, t);
+   return _mm_xor_si128(t, carry);
+}
+
+AESNI_TARGET inline __m128i encrypt_block_128(__m128i b, const __m128i* rk)
+{
+   b = _mm_xor_si128(b, rk[0]);
+   for(int r = 1; r < 10; r++)
+      b = _mm_aesenc_si128(b, rk[r]);
+   return _mm_aesenclast_si128(b, rk[10]);
+}
+
+AESNI_TARGET inline __m128i decrypt_block_128(__m128i b, const __m128i* rk)
+{
+   b = _mm_xor_si128(b, rk[0]);
+   for(int r = 1; r < 10; r++)
+      b = _mm_aesdec_si128(b, rk[r]);
+   return _mm_aesdeclast_si128(b, rk[10]);
+}
+
+template<bool decrypt>
+AESNI_TARGET void xts_crypt_128(const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t size, const unsigned char* src, unsigned char* dst)
+{
+   __m128i rk[11];
+   __m128i tk[11];
+
+   expand_enc_key_128(tweak_enc_key, tk);
+
+   if(decrypt)
+   {
+      __m128i ek[11];
+      expand_enc_key_128(dst_key, ek);
+      expand_dec_key_128(ek, rk);
+   }
+   else
+   {
+      expand_enc_key_128(dst_key, rk);
+   }
+
+   __m128i t = encrypt_block_128(_mm_loadu_si128((const __m128i*)tweak), tk);
+
+   std::uint32_t nBlocks = size / 0x10;
+   std::uint32_t i = 0;
+
+   //main loop - tweaks for next group are computed while aes rounds of current group are in flight
+   for(; i + AESNI_INTERLEAVE <= nBlocks; i += AESNI_INTERLEAVE)
+   {
+      __m128i tw[AESNI_INTERLEAVE];
+      __m128i b[AESNI_INTERLEAVE];
+
+      for(int j = 0; j < AESNI_INTERLEAVE; j++)
+      {
+         tw[j] = t;
+         t = xts_double(t);
+         b[j] = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + (i + j) * 0x10)), tw[j]);
+         b[j] = _mm_xor_si128(b[j], rk[0]);
+      }
+
+      for(int r = 1; r < 10; r++)
+      {
+         for(int j = 0; j < AESNI_INTERLEAVE; j++)
+            b[j] = decrypt ? _mm_aesdec_si128(b[j], rk[r]) : _mm_aesenc_si128(b[j], rk[r]);
+      }
+
+      for(int j = 0; j < AESNI_INTERLEAVE; j++)
+      {
+         b[j] = decrypt ? _mm_aesdeclast_si128(b[j], rk[10]) : _mm_aesenclast_si128(b[j], rk[10]);
+         _mm_storeu_si128((__m128i*)(dst + (i + j) * 0x10), _mm_xor_si128(b[j], tw[j]));
+      }
+   }
+
+   //remaining blocks
+   for(; i < nBlocks; i++)
+   {
+      __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + i * 0x10)), t);
+      b = decrypt ? decrypt_block_128(b, rk) : encrypt_block_128(b, rk);
+      _mm_storeu_si128((__m128i*)(dst + i * 0x10), _mm_xor_si128(b, t));
+      t = xts_double(t);
+   }
+}
+
+//decrypts single sector
+AESNI_TARGET void cbc_decrypt_sector_128(const __m128i* ek, const __m128i* dk, __m128i iv, std::uint32_t size, const unsigned char* src, unsigned char* dst)
+{
+   std::uint32_t nBlocks = size / 0x10;
+   std::uint32_t i = 0;
+
+   __m128i prev = iv;
+
+   //cbc decryption does not have dependencies between blocks so blocks are decrypted in groups
+   for(; i + AESNI_INTERLEAVE <= nBlocks; i += AESNI_INTERLEAVE)
+   {
+      __m128i c[AESNI_INTERLEAVE];
+      __m128i b[AESNI_INTERLEAVE];
+
+      //all ciphertext blocks of a group are loaded before anything is stored so that in place decryption works
+      for(int j = 0; j < AESNI_INTERLEAVE; j++)
+      {
+         c[j] = _mm_loadu_si128((const __m128i*)(src + (i + j) * 0x10));
+         b[j] = _mm_xor_si128(c[j], dk[0]);
+      }
+
+      for(int r = 1; r < 10; r++)
+      {
+         for(int j = 0; j < AESNI_INTERLEAVE; j++)
+            b[j] = _mm_aesdec_si128(b[j], dk[r]);
+      }
+
+      for(int j = 0; j < AESNI_INTERLEAVE; j++)
+      {
+         b[j] = _mm_aesdeclast_si128(b[j], dk[10]);
+         b[j] = _mm_xor_si128(b[j], (j == 0) ? prev : c[j - 1]);
+         _mm_storeu_si128((__m128i*)(dst + (i + j) * 0x10), b[j]);
+      }
+
+      prev = c[AESNI_INTERLEAVE - 1];
+   }
+
+   for(; i < nBlocks; i++)
+   {
+      __m128i c = _mm_loadu_si128((const __m128i*)(src + i * 0x10));
+      __m128i b = _mm_xor_si128(decrypt_block_128(c, dk), prev);
+      _mm_storeu_si128((__m128i*)(dst + i * 0x10), b);
+      prev = c;
+   }
+
+   //handle tail section - same cipher text stealing as in AESCBCDecrypt_base
+   std::uint32_t size_tail = size & 0xF;
+   if(size_tail == 0)
+      return;
+
+   unsigned char ks[0x10];
+   _mm_storeu_si128((__m128i*)ks, encrypt_block_128(prev, ek));
+
+   std::uint32_t size_block = size & (~0xF);
+   for(std::uint32_t k = 0; k < size_tail; k++)
+      dst[size_block + k] = src[size_block + k] ^ ks[k];
+}
+
+AESNI_TARGET void cbc_decrypt_sectors_128(const unsigned char* key, const unsigned char* tweak_mask, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst)
+{
+   __m128i ek[11];
+   __m128i dk[11];
+   expand_enc_key_128(key, ek);
+   expand_dec_key_128(ek, dk);
+
+   const __m128i mask = _mm_loadu_si128((const __m128i*)tweak_mask);
+
+   std::uint32_t offset = 0;
+   while(offset < size)
+   {
+      std::uint32_t bytes_left = size - offset;
+      std::uint32_t size_arg = (block_size < bytes_left) ? block_size : bytes_left;
+
+      //iv is built directly in register - lower 8 bytes is sector offset, upper 8 bytes are zero
+      __m128i iv = _mm_xor_si128(_mm_set_epi64x(0, (long long)(tweak_key + offset)), mask);
+
+      cbc_decrypt_sector_128(ek, dk, iv, size_arg, src + offset, dst + offset);
+
+      offset += block_size;
+   }
+}
+
+}
+
+bool aesni_is_supported()
+{
+   static const bool supported = detect_aesni();
+   return supported;
+}
+
+void aesni_xts_encrypt_128(const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t size, const unsigned char* src, unsigned char* dst)
+{
+   xts_crypt_128<false>(tweak, dst_key, tweak_enc_key, size, src, dst);
+}
+
+void aesni_xts_decrypt_128(const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t size, const unsigned char* src, unsigned char* dst)
+{
+   xts_crypt_128<true>(tweak, dst_key, tweak_enc_key, size, src, dst);
+}
+
+void aesni_cbc_decrypt_sectors_128(const unsigned char* key, const unsigned char* tweak_mask, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst)
+{
+   cbc_decrypt_sectors_128(key, tweak_mask, tweak_key, size, block_size, src, dst);
+}
+
+#else
+
+bool aesni_is_supported()
+{
+   return false;
+}
+
+void aesni_xts_encrypt_128(const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t size, const unsigned char* src, unsigned char* dst)
+{
+   (void)tweak;
+   (void)dst_key;
+   (void)tweak_enc_key;
+   (void)size;
+   (void)src;
+   (void)dst;
+   throw std::runtime_error("AES-NI kernels are not supported on this platform");
+}
+
+void aesni_xts_decrypt_128(const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t size, const unsigned char* src, unsigned char* dst)
+{
+   (void)tweak;
+   (void)dst_key;
+   (void)tweak_enc_key;
+   (void)size;
+   (void)src;
+   (void)dst;
+   throw std::runtime_error("AES-NI kernels are not supported on this platform");
+}
+
+void aesni_cbc_decrypt_sectors_128(const unsigned char* key, const unsigned char* tweak_mask, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst)
+{
+   (void)key;
+   (void)tweak_mask;
+   (void)tweak_key;
+   (void)size;
+   (void)block_size;
+   (void)src;
+   (void)dst;
+   throw std::runtime_error("AES-NI kernels are not supported on this platform");
+}
+
+#endif
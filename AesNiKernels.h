@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+//native aes kernels that use AES-NI instructions
+//these kernels are used instead of ICryptoOperations in hot paths when cpu supports them
+//all kernels support only 128 bit keys
+
+//returns true if cpu supports AES-NI and kernels were compiled in
+bool aesni_is_supported();
+
+//xts-aes over whole buffer with tweak doubling interleaved with aes rounds
+//tweak is encrypted with tweak_enc_key. size must be multiple of 0x10
+//src and dst may point to the same buffer
+void aesni_xts_encrypt_128(const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t size, const unsigned char* src, unsigned char* dst);
+
+void aesni_xts_decrypt_128(const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t size, const unsigned char* src, unsigned char* dst);
+
+//aes-cbc decryption of consecutive unicv sectors
+//iv of each sector is sector byte offset (tweak_key + n * block_size) as little endian 64 bit value xored with tweak_mask
+//tail of each sector that is not aligned to 0x10 is xored with encrypted last ciphertext block (or iv)
+//key is already derived key. src and dst may point to the same buffer
+void aesni_cbc_decrypt_sectors_128(const unsigned char* key, const unsigned char* tweak_mask, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst);
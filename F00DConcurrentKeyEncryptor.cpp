@@ -0,0 +1,156 @@
+#include "F00DConcurrentKeyEncryptor.h"
+
+#include "F00DNativeKeyEncryptor.h"
+#include "Utils.h"
+
+#include <cstring>
+#include <thread>
+#include <algorithm>
+
+F00DConcurrentKeyEncryptor::F00DConcurrentKeyEncryptor(CryptoOperationsTypes cryptoType)
+   : m_slots(new slot_t[F00D_CONCURRENT_CACHE_SLOTS]),
+     m_count(0),
+     m_cryptoType(cryptoType)
+{
+   for(std::size_t i = 0; i < F00D_CONCURRENT_CACHE_SLOTS; i++)
+   {
+      m_slots[i].state.store(slot_empty, std::memory_order_relaxed);
+      m_slots[i].size = 0;
+   }
+}
+
+bool F00DConcurrentKeyEncryptor::find(const unsigned char* key, std::uint32_t key_size, unsigned char* value) const
+{
+   std::size_t mask = F00D_CONCURRENT_CACHE_SLOTS - 1;
+
+   std::size_t i = F00DKeyCache::hash(key, key_size) & mask;
+   for(std::size_t n = 0; n < F00D_CONCURRENT_CACHE_SLOTS; n++, i = (i + 1) & mask)
+   {
+      const slot_t& s = m_slots[i];
+
+      std::uint32_t state = s.state.load(std::memory_order_acquire);
+      if(state == slot_empty)
+         return false;
+
+      //slot is being filled - key is copied right after slot is claimed so this does not take long
+      while(state == slot_writing)
+      {
+         std::this_thread::yield();
+         state = s.state.load(std::memory_order_acquire);
+      }
+
+      if(s.size == key_size && memcmp(s.key, key, key_size) == 0)
+      {
+         memcpy(value, s.value, key_size);
+         return true;
+      }
+   }
+
+   return false;
+}
+
+void F00DConcurrentKeyEncryptor::insert(const unsigned char* key, std::uint32_t key_size, const unsigned char* value)
+{
+   std::size_t mask = F00D_CONCURRENT_CACHE_SLOTS - 1;
+
+   std::size_t i = F00DKeyCache::hash(key, key_size) & mask;
+   for(std::size_t n = 0; n < F00D_CONCURRENT_CACHE_SLOTS; n++, i = (i + 1) & mask)
+   {
+      slot_t& s = m_slots[i];
+
+      std::uint32_t state = s.state.load(std::memory_order_acquire);
+      if(state == slot_empty)
+      {
+         //try to claim the slot. if other thread was faster - check what it has written
+         if(s.state.compare_exchange_strong(state, slot_writing, std::memory_order_acq_rel))
+         {
+            memcpy(s.key, key, key_size);
+            memcpy(s.value, value, key_size);
+            s.size = key_size;
+            s.state.store(slot_ready, std::memory_order_release);
+
+            m_count++;
+            return;
+         }
+      }
+
+      while(state == slot_writing)
+      {
+         std::this_thread::yield();
+         state = s.state.load(std::memory_order_acquire);
+      }
+
+      //key was already inserted by other thread
+      if(s.size == key_size && memcmp(s.key, key, key_size) == 0)
+         return;
+   }
+
+   //cache is full - key will be encrypted again next time
+}
+
+std::shared_ptr<ICryptoOperations> F00DConcurrentKeyEncryptor::acquire_cryptops()
+{
+   {
+      std::lock_guard<std::mutex> guard(m_cryptopsMutex);
+      if(!m_cryptopsPool.empty())
+      {
+         std::shared_ptr<ICryptoOperations> cryptops = m_cryptopsPool.back();
+         m_cryptopsPool.pop_back();
+         return cryptops;
+      }
+   }
+
+   return CryptoOperationsFactory::create(m_cryptoType);
+}
+
+void F00DConcurrentKeyEncryptor::release_cryptops(std::shared_ptr<ICryptoOperations> cryptops)
+{
+   std::lock_guard<std::mutex> guard(m_cryptopsMutex);
+   m_cryptopsPool.push_back(cryptops);
+}
+
+int F00DConcurrentKeyEncryptor::encrypt_key(const unsigned char* key, int key_size, unsigned char* drv_key)
+{
+   if(key_size != 0x80 &&
+      // key_size != 0xC0 && //TODO: need to implement padding
+      key_size != 0x100)
+      return -1;
+
+   std::uint32_t nbytes = key_size / 8;
+
+   if(find(key, nbytes, drv_key))
+      return 0;
+
+   std::shared_ptr<ICryptoOperations> cryptops = acquire_cryptops();
+   int res = F00DNativeKeyEncryptor::kprx_auth_service_0x50001(cryptops, key, nbytes, drv_key, 0);
+   release_cryptops(cryptops);
+
+   if(res < 0)
+      return -1;
+
+   insert(key, nbytes, drv_key);
+
+   return 0;
+}
+
+void F00DConcurrentKeyEncryptor::print_cache(std::ostream& os, std::string sep) const
+{
+   os << "Number of items in cache: " << m_count.load() << std::endl;
+
+   std::vector<const slot_t*> sorted;
+   for(std::size_t i = 0; i < F00D_CONCURRENT_CACHE_SLOTS; i++)
+   {
+      if(m_slots[i].state.load(std::memory_order_acquire) == slot_ready)
+         sorted.push_back(&m_slots[i]);
+   }
+
+   std::sort(sorted.begin(), sorted.end(), [](const slot_t* l, const slot_t* r)
+   {
+      if(l->size != r->size)
+         return l->size < r->size;
+      return memcmp(l->key, r->key, l->size) < 0;
+   });
+
+   for(auto s : sorted)
+      os << byte_array_to_string(s->key, s->size) << sep << byte_array_to_string(s->value, s->size) << std::endl;
+}
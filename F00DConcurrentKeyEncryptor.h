@@ -0,0 +1,68 @@
+#pragma once
+
+#include "IF00DKeyEncryptor.h"
+#include "ICryptoOperations.h"
+#include "CryptoOperationsFactory.h"
+#include "F00DKeyCache.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//number of slots in concurrent cache. it is not resized so it should be big enough for all klicensees in a session
+#define F00D_CONCURRENT_CACHE_SLOTS 1024
+
+//thread safe version of F00DNativeKeyEncryptor
+//cache hits do not take any locks - slots are published with release store of slot state
+//on a miss key is encrypted with crypto context taken from a pool and inserted at most once
+class F00DConcurrentKeyEncryptor : public IF00DKeyEncryptor
+{
+private:
+   enum slot_state : std::uint32_t
+   {
+      slot_empty = 0,
+      slot_writing = 1,
+      slot_ready = 2
+   };
+
+   struct slot_t
+   {
+      std::atomic<std::uint32_t> state;
+      std::uint32_t size;
+      std::uint8_t key[F00D_KEY_CACHE_MAX_KEY_SIZE];
+      std::uint8_t value[F00D_KEY_CACHE_MAX_KEY_SIZE];
+   };
+
+private:
+   std::unique_ptr<slot_t[]> m_slots;
+   std::atomic<std::size_t> m_count;
+
+   CryptoOperationsTypes m_cryptoType;
+
+   //each crypto context is used by one thread at a time
+   std::mutex m_cryptopsMutex;
+   std::vector<std::shared_ptr<ICryptoOperations> > m_cryptopsPool;
+
+public:
+   F00DConcurrentKeyEncryptor(CryptoOperationsTypes cryptoType);
+
+private:
+   bool find(const unsigned char* key, std::uint32_t key_size, unsigned char* value) const;
+
+   void insert(const unsigned char* key, std::uint32_t key_size, const unsigned char* value);
+
+   std::shared_ptr<ICryptoOperations> acquire_cryptops();
+
+   void release_cryptops(std::shared_ptr<ICryptoOperations> cryptops);
+
+public:
+   int encrypt_key(const unsigned char* key, int key_size, unsigned char* drv_key) override;
+
+   void print_cache(std::ostream& os, std::string sep = "\t") const override;
+
+   bool is_thread_safe() const override
+   {
+      return true;
+   }
+};
@@ -1,119 +1,294 @@
 #include "F00DFileKeyEncryptor.h"
 #include "Utils.h"
 
-#include <fstream>
-#include <regex>
+#include <string>
+#include <cstring>
+
+#include "MappedFile.h"
+
+namespace {
+
+int hex_to_nibble(char c)
+{
+   if(c >= '0' && c <= '9')
+      return c - '0';
+   if(c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+   if(c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+   return -1;
+}
+
+//decodes hex string of exactly nBytes * 2 characters
+bool hex_to_bytes(const char* str, std::size_t nBytes, unsigned char* dest)
+{
+   for(std::size_t i = 0; i < nBytes; i++)
+   {
+      int hi = hex_to_nibble(str[i * 2]);
+      int lo = hex_to_nibble(str[i * 2 + 1]);
+      if(hi < 0 || lo < 0)
+         return false;
+
+      dest[i] = (unsigned char)((hi << 4) | lo);
+   }
+   return true;
+}
+
+bool is_flat_separator(char c)
+{
+   return c == ' ' || c == '\t' || c == ',';
+}
+
+//minimal cursor for json cache files
+//only objects and strings are supported since this is all that cache file contains
+class json_cursor
+{
+private:
+   const char* m_pos;
+   const char* m_end;
+
+public:
+   json_cursor(const char* begin, const char* end)
+      : m_pos(begin), m_end(end)
+   {
+   }
+
+public:
+   void skip_ws()
+   {
+      while(m_pos < m_end && (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\r' || *m_pos == '\n'))
+         m_pos++;
+   }
+
+   bool at_end()
+   {
+      skip_ws();
+      return m_pos == m_end;
+   }
+
+   bool consume(char c)
+   {
+      skip_ws();
+      if(m_pos == m_end || *m_pos != c)
+         return false;
+      m_pos++;
+      return true;
+   }
+
+   //returns raw string contents without quotes. escape sequences are not decoded
+   //since keys, values and title ids never contain them
+   bool read_string(const char*& str, std::size_t& length)
+   {
+      if(!consume('"'))
+         return false;
+
+      str = m_pos;
+      while(m_pos < m_end && *m_pos != '"')
+      {
+         if(*m_pos == '\\')
+            return false;
+         m_pos++;
+      }
+
+      if(m_pos == m_end)
+         return false;
+
+      length = m_pos - str;
+      m_pos++;
+      return true;
+   }
+};
+
+}
 
 F00DFileKeyEncryptor::F00DFileKeyEncryptor(const psvpfs::path& filePath)
-   : m_filePath(filePath), m_isCacheLoaded(false)
+   : m_filePath(filePath), m_loadResult(-1)
 {
 }
 
-int F00DFileKeyEncryptor::load_cache_flat_file()
+int F00DFileKeyEncryptor::add_cache_entry(const char* key, std::size_t keyLength, const char* value, std::size_t valueLength)
 {
-   if(!psvpfs::exists(m_filePath))
+   // check key length to be 128 or 256 bit
+   if(keyLength != 32 && keyLength != 64)
       return -1;
 
-   std::ifstream input(m_filePath.generic_string().c_str());
-   if(!input.is_open())
+   //key size must equal value size
+   if(keyLength != valueLength)
       return -1;
 
-   std::string line;
-   std::vector<std::string> tokens;
-   while(std::getline(input, line))
+   std::uint32_t nbytes = static_cast<std::uint32_t>(keyLength / 2);
+
+   unsigned char keyData[F00D_KEY_CACHE_MAX_KEY_SIZE];
+   unsigned char valueData[F00D_KEY_CACHE_MAX_KEY_SIZE];
+   if(!hex_to_bytes(key, nbytes, keyData) || !hex_to_bytes(value, nbytes, valueData))
+      return -1;
+
+   // do not allow duplicates
+   if(!m_keyCache.insert(keyData, nbytes, valueData))
+      return -1;
+
+   return 0;
+}
+
+int F00DFileKeyEncryptor::load_cache_flat_file()
+{
+   MappedFile input;
+   if(!input.open(m_filePath))
+      return -1;
+
+   const char* pos = (const char*)input.data();
+   const char* end = pos + input.size();
+
+   while(pos < end)
    {
+      //find end of line
+      const char* eol = (const char*)memchr(pos, '\n', end - pos);
+      if(eol == nullptr)
+         eol = end;
+
+      const char* lineEnd = eol;
+      if(lineEnd > pos && *(lineEnd - 1) == '\r')
+         lineEnd--;
+
       //parse string - allow multiple split tokens
-      tokens.clear();
-      std::regex re(" \t,");
-      std::sregex_token_iterator first(line.begin(), line.end(), re, -1), last;
-      std::vector<std::string> tokens(first, last);
+      const char* tokens[3];
+      std::size_t lengths[3];
+      std::size_t nTokens = 0;
 
-      //there should be exactly three values - titleid, key, value
-      if(tokens.size() != 3)
-         return -1;
+      const char* p = pos;
+      while(p < lineEnd)
+      {
+         while(p < lineEnd && is_flat_separator(*p))
+            p++;
 
-      //extract tokens
-      std::string key = tokens.at(1);
-      std::string value = tokens.at(2);
+         if(p == lineEnd)
+            break;
 
-      // check key length to be 128 or 256 bit
-      if(key.length() != 32 && key.length() != 64)
-         return -1;
+         const char* tokenStart = p;
+         while(p < lineEnd && !is_flat_separator(*p))
+            p++;
 
-      //key size must equal value size
-      if(key.length() != value.length())
-         return -1;
+         //there should be exactly three values - titleid, key, value
+         if(nTokens == 3)
+            return -1;
 
-      // do not allow duplicates
-      auto kit = m_keyCache.find(key);
-      if(kit != m_keyCache.end())
-         return -1;
+         tokens[nTokens] = tokenStart;
+         lengths[nTokens] = p - tokenStart;
+         nTokens++;
+      }
 
-      m_keyCache.emplace(key, value);
+      //skip empty lines
+      if(nTokens != 0)
+      {
+         if(nTokens != 3)
+            return -1;
+
+         if(add_cache_entry(tokens[1], lengths[1], tokens[2], lengths[2]) < 0)
+            return -1;
+      }
+
+      pos = eol + 1;
    }
 
    return 0;
 }
-/*
+
 int F00DFileKeyEncryptor::load_cache_json_file()
 {
-   if(!psvpfs::exists(m_filePath))
+   MappedFile input;
+   if(!input.open(m_filePath))
       return -1;
 
-   try
-   {
-      boost::property_tree::ptree pt;
-      boost::property_tree::read_json(m_filePath.generic_string(), pt);
+   const char* begin = (const char*)input.data();
+   json_cursor cursor(begin, begin + input.size());
+
+   if(!cursor.consume('{'))
+      return -1;
 
-      for(auto& item : pt)
+   if(!cursor.consume('}'))
+   {
+      do
       {
          //parse entry
-         std::string titleid = item.first;
+         const char* titleid;
+         std::size_t titleidLength;
+         if(!cursor.read_string(titleid, titleidLength) || !cursor.consume(':') || !cursor.consume('{'))
+            return -1;
 
-         auto keych = item.second.get_child("key");
-         auto valuech = item.second.get_child("value");
+         const char* key = nullptr;
+         const char* value = nullptr;
+         std::size_t keyLength = 0;
+         std::size_t valueLength = 0;
 
-         std::string key = keych.get_value<std::string>();
-         std::string value = valuech.get_value<std::string>();
+         do
+         {
+            const char* name;
+            std::size_t nameLength;
+            const char* str;
+            std::size_t strLength;
+            if(!cursor.read_string(name, nameLength) || !cursor.consume(':') || !cursor.read_string(str, strLength))
+               return -1;
 
-         //check that values are not empty
-         if(titleid.empty() || key.empty() || value.empty())
-            return -1;
+            if(nameLength == 3 && memcmp(name, "key", 3) == 0)
+            {
+               key = str;
+               keyLength = strLength;
+            }
+            else if(nameLength == 5 && memcmp(name, "value", 5) == 0)
+            {
+               value = str;
+               valueLength = strLength;
+            }
+         }
+         while(cursor.consume(','));
 
-         // check key length to be 128 or 256 bit
-         if(key.length() != 32 && key.length() != 64)
+         if(!cursor.consume('}'))
             return -1;
 
-         //key size must equal value size
-         if(key.length() != value.length())
+         //check that values are not empty
+         if(titleidLength == 0 || key == nullptr || value == nullptr)
             return -1;
 
-         // do not allow duplicates
-         auto kit = m_keyCache.find(key);
-         if(kit != m_keyCache.end())
+         if(add_cache_entry(key, keyLength, value, valueLength) < 0)
             return -1;
-
-         m_keyCache.emplace(key, value);
       }
+      while(cursor.consume(','));
+
+      if(!cursor.consume('}'))
+         return -1;
    }
-   catch(std::exception e)
-   {
+
+   if(!cursor.at_end())
       return -1;
-   }
 
    return 0;
 }
 
+int F00DFileKeyEncryptor::load_cache_binary_file()
+{
+   return m_keyCache.load_binary(m_filePath);
+}
+
 int F00DFileKeyEncryptor::load_cache_file()
 {
-   if(m_filePath.extension() == ".txt")
-      return load_cache_flat_file();
-   else if(m_filePath.extension() == ".json")
+   if(!psvpfs::exists(m_filePath))
+      return -1;
+
+   if(m_filePath.extension() == ".json")
       return load_cache_json_file();
+   else if(m_filePath.extension() == ".bin")
+      return load_cache_binary_file();
    else
-      return -1;
+      return load_cache_flat_file();
 }
-*/
+
+int F00DFileKeyEncryptor::ensure_cache_loaded()
+{
+   std::call_once(m_loadFlag, [this]() { m_loadResult = load_cache_file(); });
+
+   return m_loadResult;
+}
+
 int F00DFileKeyEncryptor::encrypt_key(const unsigned char* key, int key_size, unsigned char* drv_key)
 {
    if(key_size != 0x80 &&
@@ -121,14 +296,14 @@ int F00DFileKeyEncryptor::encrypt_key(const unsigned char* key, int key_size, un
       key_size != 0x100)
       return -1;
 
-   std::string keyStr = byte_array_to_string(key, key_size / 8);
-
-   auto kit = m_keyCache.find(keyStr);
-   if(kit == m_keyCache.end())
+   if(ensure_cache_loaded() < 0)
       return -1;
 
    std::uint32_t nbytes = key_size / 8;
-   string_to_byte_array(kit->second, nbytes, drv_key);
+
+   if(!m_keyCache.find(key, nbytes, drv_key))
+      return -1;
+
    return 0;
 }
 
@@ -138,12 +313,13 @@ void F00DFileKeyEncryptor::print_cache(std::ostream& os, std::string sep) const
 
    //its not ok to print whole cache because it can be very long
 
-   int i = 0;
-   for (std::map<std::string, std::string>::const_iterator it = m_keyCache.begin(); it != m_keyCache.end(); ++it, i++)
-   {
-      if(i >= 10)
-         break;
+   m_keyCache.print(os, sep, 10);
+}
 
-      os << it->first << sep << it->second << std::endl;
-   }
-}
\ No newline at end of file
+int F00DFileKeyEncryptor::save_binary_cache(const psvpfs::path& filePath)
+{
+   if(ensure_cache_loaded() < 0)
+      return -1;
+
+   return m_keyCache.save_binary(filePath);
+}
@@ -1,18 +1,25 @@
 #pragma once
 
-#include <map>
-
 #include "IF00DKeyEncryptor.h"
+#include "F00DKeyCache.h"
 
 #include "LocalFilesystem.h"
 
+#include <mutex>
+
+//F00D encryptor that takes encrypted keys from cache file
+//supported formats are selected by extension:
+//.json - object of entries like "TITLEID": { "key": "...", "value": "..." }
+//.bin  - binary cache written by save_binary_cache. it is mapped and used in place
+//any other extension - flat file with lines like "TITLEID key value" (separated by spaces, tabs or commas)
 class F00DFileKeyEncryptor : public IF00DKeyEncryptor
 {
 private:
    psvpfs::path m_filePath;
 
-   std::map<std::string, std::string> m_keyCache;
-   bool m_isCacheLoaded;
+   F00DKeyCache m_keyCache;
+   std::once_flag m_loadFlag; //cache is loaded on first use, possibly by several threads at once
+   int m_loadResult;
 
 public:
    F00DFileKeyEncryptor(const psvpfs::path& filePath);
@@ -20,8 +27,28 @@ public:
 private:
    int load_cache_flat_file();
 
+   int load_cache_json_file();
+
+   int load_cache_binary_file();
+
+   int load_cache_file();
+
+   int add_cache_entry(const char* key, std::size_t keyLength, const char* value, std::size_t valueLength);
+
+   int ensure_cache_loaded();
+
 public:
    int encrypt_key(const unsigned char* key, int key_size, unsigned char* drv_key) override;
 
    void print_cache(std::ostream& os, std::string sep = "\t") const override;
-};
\ No newline at end of file
+
+   //cache is only read after it is loaded
+   bool is_thread_safe() const override
+   {
+      return true;
+   }
+
+public:
+   //loads cache file in any supported format and saves it in compact binary format
+   int save_binary_cache(const psvpfs::path& filePath);
+};
@@ -0,0 +1,224 @@
+#include "F00DKeyCache.h"
+
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+
+#include "Utils.h"
+
+//initial number of slots. grows twice when table is half full
+#define F00D_KEY_CACHE_INITIAL_SIZE 16
+
+F00DKeyCache::F00DKeyCache()
+   : m_table(nullptr),
+     m_nSlots(0),
+     m_count(0),
+     m_last(0)
+{
+   reset(F00D_KEY_CACHE_INITIAL_SIZE);
+}
+
+void F00DKeyCache::reset(std::size_t nSlots)
+{
+   m_file.reset();
+
+   m_entries.assign(nSlots, f00d_key_cache_entry_t());
+   for(auto& e : m_entries)
+      e.size = 0;
+
+   m_table = m_entries.data();
+   m_nSlots = nSlots;
+   m_count = 0;
+   m_last = 0;
+}
+
+std::size_t F00DKeyCache::hash(const unsigned char* key, std::uint32_t key_size)
+{
+   //keys are random aes keys so first 8 bytes mixed with size are good enough
+   //this function defines layout of binary cache file and must not be changed without changing the version
+   std::uint64_t h = 0;
+   memcpy(&h, key, sizeof(std::uint64_t));
+   h ^= key_size;
+   h ^= h >> 33;
+   h *= 0xFF51AFD7ED558CCDULL;
+   h ^= h >> 33;
+   return static_cast<std::size_t>(h);
+}
+
+//returns index of entry with the key or index of empty entry where key can be inserted
+//returns m_nSlots if table is full and key is not found
+std::size_t F00DKeyCache::probe(const unsigned char* key, std::uint32_t key_size) const
+{
+   std::size_t mask = m_nSlots - 1;
+
+   std::size_t i = hash(key, key_size) & mask;
+   for(std::size_t n = 0; n < m_nSlots; n++, i = (i + 1) & mask)
+   {
+      const f00d_key_cache_entry_t& e = m_table[i];
+      if(e.size == 0)
+         return i;
+      if(e.size == key_size && memcmp(e.key, key, key_size) == 0)
+         return i;
+   }
+
+   return m_nSlots;
+}
+
+bool F00DKeyCache::find(const unsigned char* key, std::uint32_t key_size, unsigned char* value)
+{
+   if(key_size == 0 || key_size > F00D_KEY_CACHE_MAX_KEY_SIZE)
+      return false;
+
+   //fast path
+   const f00d_key_cache_entry_t& last = m_table[m_last.load(std::memory_order_relaxed)];
+   if(last.size == key_size && memcmp(last.key, key, key_size) == 0)
+   {
+      memcpy(value, last.value, key_size);
+      return true;
+   }
+
+   std::size_t i = probe(key, key_size);
+   if(i == m_nSlots || m_table[i].size == 0)
+      return false;
+
+   m_last.store(i, std::memory_order_relaxed);
+   memcpy(value, m_table[i].value, key_size);
+   return true;
+}
+
+bool F00DKeyCache::insert(const unsigned char* key, std::uint32_t key_size, const unsigned char* value)
+{
+   if(key_size == 0 || key_size > F00D_KEY_CACHE_MAX_KEY_SIZE)
+      return false;
+
+   //mapped table is read only
+   if(m_file)
+      detach();
+
+   if((m_count + 1) * 2 > m_nSlots)
+      grow();
+
+   std::size_t i = probe(key, key_size);
+   f00d_key_cache_entry_t& e = m_entries[i];
+   if(e.size != 0)
+      return false;
+
+   memcpy(e.key, key, key_size);
+   memcpy(e.value, value, key_size);
+   e.size = key_size;
+
+   m_count++;
+   m_last = i;
+   return true;
+}
+
+//copies mapped table into owned storage
+void F00DKeyCache::detach()
+{
+   std::vector<f00d_key_cache_entry_t> entries(m_table, m_table + m_nSlots);
+   m_entries.swap(entries);
+   m_table = m_entries.data();
+   m_file.reset();
+}
+
+void F00DKeyCache::grow()
+{
+   std::vector<f00d_key_cache_entry_t> old(m_entries.size() * 2);
+   old.swap(m_entries);
+
+   for(auto& e : m_entries)
+      e.size = 0;
+
+   m_table = m_entries.data();
+   m_nSlots = m_entries.size();
+
+   for(auto& e : old)
+   {
+      if(e.size == 0)
+         continue;
+
+      m_entries[probe(e.key, e.size)] = e;
+   }
+
+   m_last = 0;
+}
+
+void F00DKeyCache::print(std::ostream& os, std::string sep, std::size_t maxItems) const
+{
+   std::vector<const f00d_key_cache_entry_t*> sorted;
+   for(std::size_t i = 0; i < m_nSlots; i++)
+   {
+      if(m_table[i].size != 0 && m_table[i].size <= F00D_KEY_CACHE_MAX_KEY_SIZE)
+         sorted.push_back(m_table + i);
+   }
+
+   std::sort(sorted.begin(), sorted.end(), [](const f00d_key_cache_entry_t* l, const f00d_key_cache_entry_t* r)
+   {
+      if(l->size != r->size)
+         return l->size < r->size;
+      return memcmp(l->key, r->key, l->size) < 0;
+   });
+
+   if(maxItems > 0 && sorted.size() > maxItems)
+      sorted.resize(maxItems);
+
+   for(auto e : sorted)
+      os << byte_array_to_string(e->key, e->size) << sep << byte_array_to_string(e->value, e->size) << std::endl;
+}
+
+int F00DKeyCache::load_binary(const psvpfs::path& filePath)
+{
+   std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+   if(!file->open(filePath))
+      return -1;
+
+   MappedFileView view(*file);
+
+   f00d_key_cache_header_t header;
+   if(!view.read(&header, sizeof(f00d_key_cache_header_t)))
+      return -1;
+
+   if(memcmp(header.magic, F00D_KEY_CACHE_MAGIC, 8) != 0)
+      return -1;
+
+   if(header.version != F00D_KEY_CACHE_VERSION || header.entrySize != sizeof(f00d_key_cache_entry_t))
+      return -1;
+
+   //number of slots must be power of 2 and there must be at least one empty slot
+   if(header.nSlots == 0 || (header.nSlots & (header.nSlots - 1)) != 0 || header.nEntries >= header.nSlots)
+      return -1;
+
+   if(view.size() != sizeof(f00d_key_cache_header_t) + static_cast<std::uint64_t>(header.nSlots) * sizeof(f00d_key_cache_entry_t))
+      return -1;
+
+   //entries are packed and only contain bytes so they can be used in place
+   m_entries.clear();
+   m_entries.shrink_to_fit();
+
+   m_file = file;
+   m_table = (const f00d_key_cache_entry_t*)view.peek(static_cast<std::uint64_t>(header.nSlots) * sizeof(f00d_key_cache_entry_t));
+   m_nSlots = header.nSlots;
+   m_count = header.nEntries;
+   m_last = 0;
+
+   return 0;
+}
+
+int F00DKeyCache::save_binary(const psvpfs::path& filePath) const
+{
+   std::ofstream output(filePath.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+   if(!output.is_open())
+      return -1;
+
+   f00d_key_cache_header_t header;
+   memcpy(header.magic, F00D_KEY_CACHE_MAGIC, 8);
+   header.version = F00D_KEY_CACHE_VERSION;
+   header.nSlots = static_cast<std::uint32_t>(m_nSlots);
+   header.nEntries = static_cast<std::uint32_t>(m_count);
+   header.entrySize = sizeof(f00d_key_cache_entry_t);
+
+   output.write((const char*)&header, sizeof(f00d_key_cache_header_t));
+   output.write((const char*)m_table, m_nSlots * sizeof(f00d_key_cache_entry_t));
+
+   return output ? 0 : -1;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <iostream>
+#include <string>
+#include <memory>
+#include <atomic>
+
+#include "LocalFilesystem.h"
+#include "MappedFile.h"
+
+//max size of key that F00D can encrypt (256 bit)
+#define F00D_KEY_CACHE_MAX_KEY_SIZE 0x20
+
+#define F00D_KEY_CACHE_MAGIC "F00DKEYC"
+#define F00D_KEY_CACHE_VERSION 1
+
+#pragma pack(push, 1)
+
+//header of binary cache file
+//header is followed by nSlots entries of the open addressing table exactly as they are stored in memory
+//all values are little endian
+struct f00d_key_cache_header_t
+{
+   std::uint8_t magic[8];
+   std::uint32_t version;
+   std::uint32_t nSlots; //power of 2
+   std::uint32_t nEntries;
+   std::uint32_t entrySize; //sizeof(f00d_key_cache_entry_t)
+};
+
+struct f00d_key_cache_entry_t
+{
+   std::uint8_t key[F00D_KEY_CACHE_MAX_KEY_SIZE];
+   std::uint8_t value[F00D_KEY_CACHE_MAX_KEY_SIZE];
+   std::uint32_t size; //0 if entry is empty
+};
+
+#pragma pack(pop)
+
+//binary cache of F00D encrypted keys
+//keys are stored in open addressing table with linear probing
+//last accessed entry is checked first since usually there is only one klicensee per title
+//table can also be attached to memory mapped binary cache file in which case it is used in place without loading
+class F00DKeyCache
+{
+private:
+   std::vector<f00d_key_cache_entry_t> m_entries; //owned storage. size is always power of 2
+
+   std::shared_ptr<MappedFile> m_file; //set if table is attached to binary cache file
+
+   const f00d_key_cache_entry_t* m_table; //points either to m_entries or into m_file
+   std::size_t m_nSlots;
+
+   std::size_t m_count;
+   std::atomic<std::size_t> m_last; //index of last accessed entry. lookups of loaded cache may run concurrently
+
+public:
+   F00DKeyCache();
+
+   F00DKeyCache(const F00DKeyCache&) = delete;
+
+   F00DKeyCache& operator=(const F00DKeyCache&) = delete;
+
+public:
+   std::size_t size() const
+   {
+      return m_count;
+   }
+
+public:
+   //copies cached value of key to value. returns false if key is not in the cache
+   bool find(const unsigned char* key, std::uint32_t key_size, unsigned char* value);
+
+   //returns false if key is already in the cache or key size is not supported
+   bool insert(const unsigned char* key, std::uint32_t key_size, const unsigned char* value);
+
+   //prints up to maxItems entries sorted by key. 0 means print all
+   void print(std::ostream& os, std::string sep, std::size_t maxItems) const;
+
+public:
+   //maps binary cache file and uses it as a table. only header is validated
+   int load_binary(const psvpfs::path& filePath);
+
+   int save_binary(const psvpfs::path& filePath) const;
+
+public:
+   static std::size_t hash(const unsigned char* key, std::uint32_t key_size);
+
+private:
+   std::size_t probe(const unsigned char* key, std::uint32_t key_size) const;
+
+   void reset(std::size_t nSlots);
+
+   void detach();
+
+   void grow();
+};
@@ -2,6 +2,7 @@
 
 #include "F00DFileKeyEncryptor.h"
 #include "F00DNativeKeyEncryptor.h"
+#include "F00DConcurrentKeyEncryptor.h"
 
 template<>
 std::shared_ptr<IF00DKeyEncryptor> F00DKeyEncryptorFactory::create<std::string>(F00DEncryptorTypes type, std::string arg)
@@ -25,4 +26,16 @@ std::shared_ptr<IF00DKeyEncryptor> F00DKeyEncryptorFactory::create<std::shared_p
    default:
       throw std::runtime_error("unexpected F00DEncryptorTypes value");
    }
+}
+
+template<>
+std::shared_ptr<IF00DKeyEncryptor> F00DKeyEncryptorFactory::create<CryptoOperationsTypes>(F00DEncryptorTypes type, CryptoOperationsTypes arg)
+{
+   switch(type)
+   {
+   case F00DEncryptorTypes::native_concurrent:
+      return std::make_shared<F00DConcurrentKeyEncryptor>(arg);
+   default:
+      throw std::runtime_error("unexpected F00DEncryptorTypes value");
+   }
 }
\ No newline at end of file
@@ -5,11 +5,13 @@
 
 #include "IF00DKeyEncryptor.h"
 #include "ICryptoOperations.h"
+#include "CryptoOperationsFactory.h"
 
 enum class F00DEncryptorTypes
 {
    file,
-   native
+   native,
+   native_concurrent //thread safe native implementation
 };
 
 class F00DKeyEncryptorFactory
@@ -23,4 +25,7 @@ template<>
 std::shared_ptr<IF00DKeyEncryptor> F00DKeyEncryptorFactory::create<std::string>(F00DEncryptorTypes type, std::string arg);
 
 template<>
-std::shared_ptr<IF00DKeyEncryptor> F00DKeyEncryptorFactory::create<std::shared_ptr<ICryptoOperations> >(F00DEncryptorTypes type, std::shared_ptr<ICryptoOperations> arg);
\ No newline at end of file
+std::shared_ptr<IF00DKeyEncryptor> F00DKeyEncryptorFactory::create<std::shared_ptr<ICryptoOperations> >(F00DEncryptorTypes type, std::shared_ptr<ICryptoOperations> arg);
+
+template<>
+std::shared_ptr<IF00DKeyEncryptor> F00DKeyEncryptorFactory::create<CryptoOperationsTypes>(F00DEncryptorTypes type, CryptoOperationsTypes arg);
\ No newline at end of file
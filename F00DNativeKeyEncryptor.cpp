@@ -11,7 +11,7 @@ F00DNativeKeyEncryptor::F00DNativeKeyEncryptor(std::shared_ptr<ICryptoOperations
 {
 }
 
-int F00DNativeKeyEncryptor::kprx_auth_service_0x50001(const unsigned char* key, int key_size, unsigned char* drv_key, int key_id) const
+int F00DNativeKeyEncryptor::kprx_auth_service_0x50001(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* key, int key_size, unsigned char* drv_key, int key_id)
 {
    memset(drv_key, 0, key_size);
 
@@ -39,7 +39,7 @@ int F00DNativeKeyEncryptor::kprx_auth_service_0x50001(const unsigned char* key,
    if(key_id != 0x00000000)
       return -1;
 
-   if(m_cryptops->aes_ecb_decrypt(key_dest, key_dest, key_size, contract_key0, 0x80) < 0)
+   if(cryptops->aes_ecb_decrypt(key_dest, key_dest, key_size, contract_key0, 0x80) < 0)
       return -1;
 
    memcpy(drv_key, key_dest, key_size);
@@ -55,25 +55,16 @@ int F00DNativeKeyEncryptor::encrypt_key(const unsigned char* key, int key_size,
       return -1;
 
    std::uint32_t nbytes = key_size / 8;
-   std::string keyStr = byte_array_to_string(key, nbytes);
 
-   auto kit = m_keyCache.find(keyStr);
-   if(kit != m_keyCache.end())
-   {
-      string_to_byte_array(kit->second, nbytes, drv_key);
+   if(m_keyCache.find(key, nbytes, drv_key))
       return 0;
-   }
-   else
-   {
-      if(kprx_auth_service_0x50001(key, nbytes, drv_key, 0) < 0)
-         return -1;
 
-      std::string drv_keyStr = byte_array_to_string(drv_key, nbytes);
+   if(kprx_auth_service_0x50001(m_cryptops, key, nbytes, drv_key, 0) < 0)
+      return -1;
 
-      m_keyCache.insert(std::make_pair(keyStr, drv_keyStr));
+   m_keyCache.insert(key, nbytes, drv_key);
 
-      return 0;
-   }
+   return 0;
 }
 
 void F00DNativeKeyEncryptor::print_cache(std::ostream& os, std::string sep) const
@@ -82,8 +73,5 @@ void F00DNativeKeyEncryptor::print_cache(std::ostream& os, std::string sep) cons
 
    //its ok to print whole cache since we only expect one item anyway
 
-   for(auto& item : m_keyCache)
-   {
-      os << item.first << sep << item.second << std::endl;
-   }
+   m_keyCache.print(os, sep, 0);
 }
\ No newline at end of file
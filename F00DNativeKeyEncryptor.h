@@ -2,22 +2,23 @@
 
 #include "IF00DKeyEncryptor.h"
 #include "ICryptoOperations.h"
+#include "F00DKeyCache.h"
 
-#include <map>
 #include <memory>
 
 class F00DNativeKeyEncryptor : public IF00DKeyEncryptor
 {
 private:
-   std::map<std::string, std::string> m_keyCache;
+   F00DKeyCache m_keyCache;
 
    std::shared_ptr<ICryptoOperations> m_cryptops;
 
 public:
    F00DNativeKeyEncryptor(std::shared_ptr<ICryptoOperations> cryptops);
 
-private:
-   int kprx_auth_service_0x50001(const unsigned char* key, int key_size, unsigned char* drv_key, int key_id) const;
+public:
+   //native implementation of F00D key encryption. it is stateless apart from crypto context
+   static int kprx_auth_service_0x50001(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* key, int key_size, unsigned char* drv_key, int key_id);
 
 public:
    int encrypt_key(const unsigned char* key, int key_size, unsigned char* drv_key) override;
@@ -453,7 +453,7 @@ bool FilesDbParser::parseFilesDb(std::ifstream& inputStream, std::vector<sce_ng_
 
    m_output << "Validating hash tree..." << std::endl;
 
-   if(!validate_hash_tree(0, m_header.root_icv_page_number, blocks, page_icvs))
+   if(!validate_hash_tree(0, m_header.root_icv_page_number, blocks, page_icvs, m_output))
    {
       m_output << "Failed to validate hash tree" << std::endl;
       return false;
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <vector>
 #include <map>
+#include <ostream>
 
 typedef struct page_icv_data
 {
@@ -17,4 +18,4 @@ std::uint32_t off2page(std::int64_t offset, std::uint32_t pageSize);
 
 struct sce_ng_pfs_block_t;
 
-bool validate_hash_tree(int level, std::uint32_t page, const std::vector<sce_ng_pfs_block_t>& blocks, const std::multimap<std::uint32_t, page_icv_data>& page_icvs);
\ No newline at end of file
+bool validate_hash_tree(int level, std::uint32_t page, const std::vector<sce_ng_pfs_block_t>& blocks, const std::multimap<std::uint32_t, page_icv_data>& page_icvs, std::ostream& output);
\ No newline at end of file
@@ -11,4 +11,10 @@ public:
    virtual int encrypt_key(const unsigned char* key, int key_size, unsigned char* drv_key) = 0;
 
    virtual void print_cache(std::ostream& os, std::string sep = "\t") const = 0;
+
+   //true if encrypt_key can be called from several threads at once
+   virtual bool is_thread_safe() const
+   {
+      return false;
+   }
 };
\ No newline at end of file
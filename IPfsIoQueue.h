@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+//alignment of every pool buffer. it is enough for direct io and is a divisor of sector size (0x8000) of pfs files
+#define PFS_IO_BUFFER_ALIGNMENT 0x1000
+
+//asynchronous reads and writes of file descriptors
+//queue owns pool of depth() buffers of buffer_size() bytes. every request transfers data of one buffer
+//so there is at most one request per buffer and at most depth() requests in flight
+//queue is not thread safe. every thread that does io has its own queue
+class IPfsIoQueue
+{
+public:
+   virtual ~IPfsIoQueue(){}
+
+public:
+   virtual std::uint32_t depth() const = 0;
+
+   virtual std::size_t buffer_size() const = 0;
+
+   virtual std::uint8_t* buffer(std::uint32_t index) = 0;
+
+public:
+   //queues read of size bytes at offset into buffer index
+   virtual int prep_read(int fd, std::uint32_t index, std::uint64_t offset, std::size_t size) = 0;
+
+   //queues write of first size bytes of buffer index at offset
+   virtual int prep_write(int fd, std::uint32_t index, std::uint64_t offset, std::size_t size) = 0;
+
+   //starts all queued requests at once
+   virtual int submit() = 0;
+
+   //waits for completion of any request. requests may complete in any order
+   //result is number of transferred bytes (less than requested only at the end of file) or negative on error
+   //returns -1 if there is nothing in flight
+   virtual int wait(std::uint32_t& index, std::int64_t& result) = 0;
+};
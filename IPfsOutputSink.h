@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <iostream>
+
+//destination of title that is extracted as a stream (tar archive or stdout, see PfsTarSink)
+//directory destination is written by PfsFilesystem::decrypt_files which also resumes and shards extraction
+//paths are relative to title root and use '/' as separator
+//files are written one at a time: begin_file, write exactly size bytes to returned stream, end_file
+class IPfsOutputSink
+{
+public:
+   virtual ~IPfsOutputSink(){}
+
+public:
+   virtual int create_directory(const std::string& path) = 0;
+
+   //returns null on error. stream is valid until end_file
+   virtual std::ostream* begin_file(const std::string& path, std::uint64_t size) = 0;
+
+   virtual int end_file() = 0;
+
+   //called once after all files are written
+   virtual int finish() = 0;
+};
@@ -15,38 +15,38 @@
 
 //check functions are based on code provided by Proxima
 
-int check_sealedkey(std::shared_ptr<ICryptoOperations> cryptops, sealedkey_t& sk)
+int check_sealedkey(std::shared_ptr<ICryptoOperations> cryptops, sealedkey_t& sk, std::ostream& output)
 {
    std::uint8_t result[0x20];
 
    if(std::string((char*)sk.magic, 8) != SEALEDKEY_MAGIC)
    {
-      std::cout << "sealedkey: invalid magic" << std::endl;
+      output << "sealedkey: invalid magic" << std::endl;
       return -1;
    }
 
    if(sk.type_major != SEALEDKEY_EXPECTED_TYPE_MAJOR)
    {
-      std::cout << "sealedkey: invalid type_major" << std::endl;
+      output << "sealedkey: invalid type_major" << std::endl;
       return -1;
    }
 
    if(sk.type_minor != SEALEDKEY_EXPECTED_TYPE_MINOR)
    {
-      std::cout << "sealedkey: invalid type_minor" << std::endl;
+      output << "sealedkey: invalid type_minor" << std::endl;
       return -1;
    }
 
    if(!isZeroVector(sk.padding, sk.padding + sizeof(sk.padding)))
    {
-      std::cout << "sealedkey: invalid padding" << std::endl;
+      output << "sealedkey: invalid padding" << std::endl;
       return -1;
    }
 
    cryptops->hmac_sha256((unsigned char*)&sk, result, 0x30, sealedkey_retail_key, 0x10);
    if(memcmp(sk.hmac, result, 0x20) == 0)
    {
-      std::cout << "sealedkey: matched retail hmac" << std::endl;
+      output << "sealedkey: matched retail hmac" << std::endl;
       return 0;
    }
    else
@@ -54,49 +54,49 @@ int check_sealedkey(std::shared_ptr<ICryptoOperations> cryptops, sealedkey_t& sk
       cryptops->hmac_sha256((unsigned char*)&sk, result, 0x30, sealedkey_debug_key, 0x10);
       if(memcmp(sk.hmac, result, 0x20) == 0)
       {
-         std::cout << "sealedkey: matched debug hmac" << std::endl;
+         output << "sealedkey: matched debug hmac" << std::endl;
          return 0;
       }
       else
       {
-         std::cout << "sealedkey: failed to match hmac" << std::endl;
+         output << "sealedkey: failed to match hmac" << std::endl;
          return -1;
       }
    }
 }
 
-int check_keystone(std::shared_ptr<ICryptoOperations> cryptops, keystone_t& ks)
+int check_keystone(std::shared_ptr<ICryptoOperations> cryptops, keystone_t& ks, std::ostream& output)
 {
    std::uint8_t result[0x20];
 
    if(std::string((char*)ks.magic, 8) != KEYSTONE_MAGIC)
    {
-      std::cout << "keystone: invalid magic" << std::endl;
+      output << "keystone: invalid magic" << std::endl;
       return -1;
    }
 
    if(ks.type != KEYSTONE_EXPECTED_TYPE)
    {
-      std::cout << "keystone: invalid type" << std::endl;
+      output << "keystone: invalid type" << std::endl;
       return -1;
    }
 
    if(ks.version != KEYSTONE_EXPECTED_VERSION)
    {
-      std::cout << "keystone: invalid version" << std::endl;
+      output << "keystone: invalid version" << std::endl;
       return -1;
    }
 
    if(!isZeroVector(ks.padding, ks.padding + sizeof(ks.padding)))
    {
-      std::cout << "keystone: invalid padding" << std::endl;
+      output << "keystone: invalid padding" << std::endl;
       return -1;
    }
 
    cryptops->hmac_sha256((unsigned char*)&ks, result, 0x40, keystone_hmac_secret, 0x20);
    if(memcmp(ks.keystone_hmac, result, 0x20) == 0)
    {
-      std::cout << "keystone: matched retail hmac" << std::endl;
+      output << "keystone: matched retail hmac" << std::endl;
       return 0;
    }
    else
@@ -104,20 +104,20 @@ int check_keystone(std::shared_ptr<ICryptoOperations> cryptops, keystone_t& ks)
       cryptops->hmac_sha256((unsigned char*)&ks, result, 0x40, keystone_debug_key, 0x20);
       if(memcmp(ks.keystone_hmac, result, 0x20) == 0)
       {
-         std::cout << "keystone: matched debug hmac!" << std::endl;
+         output << "keystone: matched debug hmac!" << std::endl;
          return 0;
       }
       else
       {
-         std::cout << "keystone: failed to match hmac" << std::endl;
+         output << "keystone: failed to match hmac" << std::endl;
          return -1;
       }
    }
 }
 
-int check_keystone(std::shared_ptr<ICryptoOperations> cryptops, keystone_t& ks, unsigned char* passcode)
+int check_keystone(std::shared_ptr<ICryptoOperations> cryptops, keystone_t& ks, unsigned char* passcode, std::ostream& output)
 {
-   if(check_keystone(cryptops, ks) < 0)
+   if(check_keystone(cryptops, ks, output) < 0)
       return -1;
 
    std::uint8_t result[0x20];
@@ -125,7 +125,7 @@ int check_keystone(std::shared_ptr<ICryptoOperations> cryptops, keystone_t& ks,
    cryptops->hmac_sha256(passcode, result, 0x20, passcode_hmac_secret, 0x20);
    if(memcmp(ks.passcode_hmac, result, 0x20) == 0)
    {
-      std::cout << "keystone: matched passcode hmac" << std::endl;
+      output << "keystone: matched passcode hmac" << std::endl;
       return 0;
    }
    else
@@ -133,12 +133,12 @@ int check_keystone(std::shared_ptr<ICryptoOperations> cryptops, keystone_t& ks,
       cryptops->hmac_sha256(passcode, result, 0x20, passcode_debug_key, 0x20);
       if(memcmp(ks.passcode_hmac, result, 0x20) == 0)
       {
-         std::cout << "keystone: matched debug passcode hmac!" << std::endl;
+         output << "keystone: matched debug passcode hmac!" << std::endl;
          return 0;
       }
       else
       {
-         std::cout << "keystone: failed to match passcode hmac" << std::endl;
+         output << "keystone: failed to match passcode hmac" << std::endl;
          return -1;
       }
    }
@@ -146,13 +146,13 @@ int check_keystone(std::shared_ptr<ICryptoOperations> cryptops, keystone_t& ks,
 
 //public functions
 
-int get_sealedkey(std::shared_ptr<ICryptoOperations> cryptops, const psvpfs::path& titleIdPath, unsigned char* dec_key)
+int get_sealedkey(std::shared_ptr<ICryptoOperations> cryptops, const psvpfs::path& titleIdPath, unsigned char* dec_key, std::ostream& output)
 {
    psvpfs::path filepath = titleIdPath / "sce_sys" / "sealedkey";
 
    if(!psvpfs::exists(filepath))
    {
-      std::cout << "sealedkey does not exist" << std::endl;
+      output << "sealedkey does not exist" << std::endl;
       return -1;
    }
 
@@ -161,7 +161,7 @@ int get_sealedkey(std::shared_ptr<ICryptoOperations> cryptops, const psvpfs::pat
    std::ifstream inputStream(filepath.generic_string().c_str(), std::ios::in | std::ios::binary);
    inputStream.read((char*)&sk, sizeof(sealedkey_t));
 
-   if(check_sealedkey(cryptops, sk) < 0)
+   if(check_sealedkey(cryptops, sk, output) < 0)
       return -1;
 
    cryptops->aes_cbc_decrypt(sk.enc_key, dec_key, sizeof(sk.enc_key), PFS_EncKey, 128, sk.iv);
@@ -169,13 +169,13 @@ int get_sealedkey(std::shared_ptr<ICryptoOperations> cryptops, const psvpfs::pat
    return 0;
 }
 
-int get_keystone(std::shared_ptr<ICryptoOperations> cryptops, const psvpfs::path& titleIdPath, char* passcode)
+int get_keystone(std::shared_ptr<ICryptoOperations> cryptops, const psvpfs::path& titleIdPath, std::ostream& output, char* passcode)
 {
    psvpfs::path filepath = titleIdPath / "sce_sys" / "keystone";
 
    if(!psvpfs::exists(filepath))
    {
-      std::cout << "keystone does not exist" << std::endl;
+      output << "keystone does not exist" << std::endl;
       return -1;
    }
 
@@ -185,9 +185,9 @@ int get_keystone(std::shared_ptr<ICryptoOperations> cryptops, const psvpfs::path
    inputStream.read((char*)&ks, 0x60);
 
    if(passcode == 0)
-      return check_keystone(cryptops, ks);
+      return check_keystone(cryptops, ks, output);
    else
-      return check_keystone(cryptops, ks, (unsigned char*)passcode);
+      return check_keystone(cryptops, ks, (unsigned char*)passcode, output);
 
    return 0;
 }
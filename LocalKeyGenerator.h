@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <ostream>
 
 #include "ICryptoOperations.h"
 
@@ -40,6 +41,6 @@ typedef struct keystone_t
 
 #pragma pack(pop)
 
-int get_sealedkey(std::shared_ptr<ICryptoOperations> cryptops, const psvpfs::path& titleIdPath, unsigned char* dec_key);
+int get_sealedkey(std::shared_ptr<ICryptoOperations> cryptops, const psvpfs::path& titleIdPath, unsigned char* dec_key, std::ostream& output);
 
-int get_keystone(std::shared_ptr<ICryptoOperations> cryptops, const psvpfs::path& titleIdPath, char* passcode = 0);
\ No newline at end of file
+int get_keystone(std::shared_ptr<ICryptoOperations> cryptops, const psvpfs::path& titleIdPath, std::ostream& output, char* passcode = 0);
\ No newline at end of file
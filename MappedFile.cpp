@@ -0,0 +1,261 @@
+#include "MappedFile.h"
+
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile()
+   : m_data(nullptr),
+     m_size(0),
+     m_isOpen(false),
+     m_mapping(nullptr)
+#ifdef _WIN32
+     , m_fileHandle(nullptr),
+     m_mapHandle(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+   close();
+}
+
+bool MappedFile::open(const psvpfs::path& filepath)
+{
+   close();
+
+   if(!map(filepath) && !read_to_buffer(filepath))
+      return false;
+
+   m_isOpen = true;
+   return true;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::map(const psvpfs::path& filepath)
+{
+   HANDLE file = CreateFileW(filepath.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   if(file == INVALID_HANDLE_VALUE)
+      return false;
+
+   LARGE_INTEGER size;
+   if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+   {
+      CloseHandle(file);
+      return false;
+   }
+
+   HANDLE mapHandle = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+   if(mapHandle == NULL)
+   {
+      CloseHandle(file);
+      return false;
+   }
+
+   void* mapping = MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+   if(mapping == NULL)
+   {
+      CloseHandle(mapHandle);
+      CloseHandle(file);
+      return false;
+   }
+
+   m_fileHandle = file;
+   m_mapHandle = mapHandle;
+   m_mapping = mapping;
+   m_data = (const std::uint8_t*)mapping;
+   m_size = size.QuadPart;
+   return true;
+}
+
+void MappedFile::close()
+{
+   if(m_mapping != nullptr)
+      UnmapViewOfFile(m_mapping);
+   if(m_mapHandle != nullptr)
+      CloseHandle((HANDLE)m_mapHandle);
+   if(m_fileHandle != nullptr)
+      CloseHandle((HANDLE)m_fileHandle);
+
+   m_mapping = nullptr;
+   m_mapHandle = nullptr;
+   m_fileHandle = nullptr;
+
+   m_buffer.clear();
+   m_buffer.shrink_to_fit();
+
+   m_data = nullptr;
+   m_size = 0;
+   m_isOpen = false;
+}
+
+#else
+
+bool MappedFile::map(const psvpfs::path& filepath)
+{
+   int fd = ::open(filepath.generic_string().c_str(), O_RDONLY);
+   if(fd < 0)
+      return false;
+
+   struct stat st;
+   if(fstat(fd, &st) != 0 || st.st_size == 0)
+   {
+      ::close(fd);
+      return false;
+   }
+
+   void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+   //mapping stays valid after descriptor is closed
+   ::close(fd);
+
+   if(mapping == MAP_FAILED)
+      return false;
+
+   //whole file is parsed front to back
+   madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+
+   m_mapping = mapping;
+   m_data = (const std::uint8_t*)mapping;
+   m_size = st.st_size;
+   return true;
+}
+
+void MappedFile::close()
+{
+   if(m_mapping != nullptr)
+      munmap(m_mapping, m_size);
+
+   m_mapping = nullptr;
+
+   m_buffer.clear();
+   m_buffer.shrink_to_fit();
+
+   m_data = nullptr;
+   m_size = 0;
+   m_isOpen = false;
+}
+
+#endif
+
+bool MappedFile::read_to_buffer(const psvpfs::path& filepath)
+{
+   std::ifstream inputStream(filepath.generic_string().c_str(), std::ios::in | std::ios::binary);
+   if(!inputStream.is_open())
+      return false;
+
+   inputStream.seekg(0, std::ios::end);
+   std::uint64_t fileSize = inputStream.tellg();
+   inputStream.seekg(0, std::ios::beg);
+
+   m_buffer.resize(static_cast<std::vector<std::uint8_t>::size_type>(fileSize));
+   inputStream.read((char*)m_buffer.data(), fileSize);
+   if(!inputStream)
+   {
+      m_buffer.clear();
+      return false;
+   }
+
+   m_data = m_buffer.data();
+   m_size = fileSize;
+   return true;
+}
+
+bool MappedFile::is_open() const
+{
+   return m_isOpen;
+}
+
+const std::uint8_t* MappedFile::data() const
+{
+   return m_data;
+}
+
+std::uint64_t MappedFile::size() const
+{
+   return m_size;
+}
+
+void MappedFile::prefetch() const
+{
+   if(m_mapping == nullptr)
+      return;
+
+#ifndef _WIN32
+   madvise(m_mapping, m_size, MADV_WILLNEED);
+#endif
+
+   //volatile prevents reads from being optimized out
+   const volatile std::uint8_t* ptr = m_data;
+   std::uint8_t sum = 0;
+   for(std::uint64_t i = 0; i < m_size; i += 0x1000)
+      sum ^= ptr[i];
+   (void)sum;
+}
+
+//===
+
+MappedFileView::MappedFileView(const std::uint8_t* data, std::uint64_t size)
+   : m_begin(data), m_size(size), m_pos(0)
+{
+}
+
+MappedFileView::MappedFileView(const MappedFile& file)
+   : m_begin(file.data()), m_size(file.size()), m_pos(0)
+{
+}
+
+bool MappedFileView::seek(std::uint64_t pos)
+{
+   if(pos > m_size)
+      return false;
+
+   m_pos = pos;
+   return true;
+}
+
+bool MappedFileView::skip(std::uint64_t size)
+{
+   if(size > m_size - m_pos)
+      return false;
+
+   m_pos += size;
+   return true;
+}
+
+const std::uint8_t* MappedFileView::peek(std::uint64_t size) const
+{
+   if(size > m_size - m_pos)
+      return nullptr;
+
+   return m_begin + m_pos;
+}
+
+const std::uint8_t* MappedFileView::view(std::uint64_t size)
+{
+   const std::uint8_t* result = peek(size);
+   if(result != nullptr)
+      m_pos += size;
+   return result;
+}
+
+bool MappedFileView::read(void* dst, std::uint64_t size)
+{
+   const std::uint8_t* src = view(size);
+   if(src == nullptr)
+      return false;
+
+   memcpy(dst, src, static_cast<std::size_t>(size));
+   return true;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "LocalFilesystem.h"
+
+//read only image of a whole file in memory
+//file is mapped into address space when possible and read into a buffer otherwise
+//(empty files, filesystems that do not support mapping etc)
+class MappedFile
+{
+private:
+   const std::uint8_t* m_data;
+   std::uint64_t m_size;
+   bool m_isOpen;
+
+   void* m_mapping; //address returned by mmap / MapViewOfFile. null if data is stored in m_buffer
+#ifdef _WIN32
+   void* m_fileHandle;
+   void* m_mapHandle;
+#endif
+
+   std::vector<std::uint8_t> m_buffer; //fallback storage
+
+public:
+   MappedFile();
+
+   MappedFile(const MappedFile&) = delete;
+
+   MappedFile& operator=(const MappedFile&) = delete;
+
+   ~MappedFile();
+
+public:
+   bool open(const psvpfs::path& filepath);
+
+   void close();
+
+public:
+   bool is_open() const;
+
+   const std::uint8_t* data() const;
+
+   std::uint64_t size() const;
+
+public:
+   //touches every page of the mapping so that later parsing does not block on page faults
+   void prefetch() const;
+
+private:
+   bool map(const psvpfs::path& filepath);
+
+   bool read_to_buffer(const psvpfs::path& filepath);
+};
+
+//bounds checked cursor over memory range (usually over MappedFile)
+//all methods fail instead of reading outside of the range
+class MappedFileView
+{
+private:
+   const std::uint8_t* m_begin;
+   std::uint64_t m_size;
+   std::uint64_t m_pos;
+
+public:
+   MappedFileView(const std::uint8_t* data, std::uint64_t size);
+
+   MappedFileView(const MappedFile& file);
+
+public:
+   std::uint64_t size() const
+   {
+      return m_size;
+   }
+
+   std::uint64_t tell() const
+   {
+      return m_pos;
+   }
+
+   bool seek(std::uint64_t pos);
+
+   bool skip(std::uint64_t size);
+
+public:
+   //returns pointer to next size bytes without moving the cursor. returns null if range is out of bounds
+   const std::uint8_t* peek(std::uint64_t size) const;
+
+   //returns pointer to next size bytes and moves the cursor. returns null if range is out of bounds
+   const std::uint8_t* view(std::uint64_t size);
+
+   //copies next size bytes to destination and moves the cursor
+   bool read(void* dst, std::uint64_t size);
+};
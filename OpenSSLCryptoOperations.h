@@ -12,7 +12,7 @@ typedef struct evp_mac_ctx_st EVP_MAC_CTX;
 typedef struct ossl_param_st OSSL_PARAM;
 }
 
-class OpenSSLCryptoOperations : public ICryptoOperations {
+class OpenSSLCryptoOperations final : public ICryptoOperations {
 public:
     OpenSSLCryptoOperations();
 
@@ -0,0 +1,129 @@
+#include "PfsCacheControl.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+int pfs_open_input(const psvpfs::path& filepath, bool direct)
+{
+#ifdef _WIN32
+   if(direct)
+      return -1;
+   return _wopen(filepath.wstring().c_str(), _O_RDONLY | _O_BINARY);
+#else
+   int flags = O_RDONLY | O_CLOEXEC;
+#if defined(O_DIRECT)
+   if(direct)
+      flags |= O_DIRECT;
+#elif !defined(__APPLE__)
+   if(direct)
+      return -1;
+#endif
+
+   int fd = ::open(filepath.c_str(), flags);
+
+#if !defined(O_DIRECT) && defined(__APPLE__)
+   //macos has no O_DIRECT but can disable caching of open file
+   if(fd >= 0 && direct && fcntl(fd, F_NOCACHE, 1) < 0)
+   {
+      ::close(fd);
+      return -1;
+   }
+#endif
+
+   return fd;
+#endif
+}
+
+int pfs_open_output(const psvpfs::path& filepath, bool truncate, bool direct)
+{
+#ifdef _WIN32
+   if(direct)
+      return -1;
+   return _wopen(filepath.wstring().c_str(), _O_WRONLY | _O_CREAT | (truncate ? _O_TRUNC : 0) | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+   int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+   if(truncate)
+      flags |= O_TRUNC;
+#if defined(O_DIRECT)
+   if(direct)
+      flags |= O_DIRECT;
+#elif !defined(__APPLE__)
+   if(direct)
+      return -1;
+#endif
+
+   int fd = ::open(filepath.c_str(), flags, 0644);
+
+#if !defined(O_DIRECT) && defined(__APPLE__)
+   if(fd >= 0 && direct && fcntl(fd, F_NOCACHE, 1) < 0)
+   {
+      ::close(fd);
+      return -1;
+   }
+#endif
+
+   return fd;
+#endif
+}
+
+int pfs_close(int fd)
+{
+#ifdef _WIN32
+   return _close(fd);
+#else
+   return ::close(fd);
+#endif
+}
+
+//hints are not errors. they are ignored where they are not supported
+
+void pfs_advise_sequential(int fd)
+{
+#ifdef __linux__
+   posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#else
+   (void)fd;
+#endif
+}
+
+void pfs_drop_cache(int fd, std::uint64_t offset, std::uint64_t size)
+{
+#ifdef __linux__
+   posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(size), POSIX_FADV_DONTNEED);
+#else
+   (void)fd;
+   (void)offset;
+   (void)size;
+#endif
+}
+
+void pfs_drop_written(int fd)
+{
+#ifdef __linux__
+   //dirty pages can not be dropped so writeback is started and waited for first
+   sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+   posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#else
+   (void)fd;
+#endif
+}
+
+void pfs_drop_cache(const psvpfs::path& filepath)
+{
+#ifdef __linux__
+   int fd = pfs_open_input(filepath);
+   if(fd < 0)
+      return;
+
+   pfs_drop_cache(fd, 0, 0);
+   pfs_close(fd);
+#else
+   (void)filepath;
+#endif
+}
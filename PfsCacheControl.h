@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+#include "LocalFilesystem.h"
+
+//how extraction uses page cache
+//title is read once and written once so keeping it in cache only evicts data of other programs
+enum class PfsCacheModes
+{
+   buffered, //page cache is used as usual
+   dontneed, //access is marked sequential and pages of the file are dropped when they are no longer needed
+   direct //O_DIRECT for aligned part of the file. unaligned tail goes through page cache and is dropped after use
+};
+
+//opens file for reading. direct open fails if platform or filesystem does not support direct io
+int pfs_open_input(const psvpfs::path& filepath, bool direct = false);
+
+//opens file for writing. file is created if it does not exist
+int pfs_open_output(const psvpfs::path& filepath, bool truncate, bool direct = false);
+
+int pfs_close(int fd);
+
+//hints that file is read from start to end
+void pfs_advise_sequential(int fd);
+
+//drops clean cached pages of the range. size 0 means up to the end of file
+void pfs_drop_cache(int fd, std::uint64_t offset, std::uint64_t size);
+
+//waits for writeback of the whole file and drops its pages
+void pfs_drop_written(int fd);
+
+//drops cached pages of file that is not open
+void pfs_drop_cache(const psvpfs::path& filepath);
@@ -8,6 +8,7 @@
 #include "SceKernelUtilsForDriver.h"
 #include "PfsCryptEngineBase.h"
 #include "PfsCryptEngineSelectors.h"
+#include "OpenSSLCryptoOperations.h"
 
 //----------------------
 
@@ -164,24 +165,14 @@ int cbc_dec(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKe
    unsigned const char* tweak_enc_key = crypt_ctx->subctx->data->tweak_enc_key;
 
    //remove encryption layer
-
-   int offset = 0;
-   std::uint32_t counter = 0;
+   //all sectors are passed in single call - pfs_decrypt_unicv splits data into sectors itself
+   //and this allows it to derive the key only once
 
    std::uint64_t tweak_key = crypt_ctx->subctx->data->block_size * crypt_ctx->subctx->sector_base;
 
-   std::uint32_t bytes_left = crypt_ctx->subctx->data->block_size * (crypt_ctx->subctx->nBlocks - 1) + (crypt_ctx->subctx->tail_size);
-   
-   do
-   {
-      int size_arg = ((crypt_ctx->subctx->data->block_size < bytes_left) ? crypt_ctx->subctx->data->block_size : bytes_left);
-      pfs_decrypt_unicv(cryptops, iF00D, key, tweak_enc_key, tweak_key + offset, size_arg, crypt_ctx->subctx->data->block_size, buffer + offset, buffer + offset, crypt_ctx->subctx->data->crypto_engine_flag, crypt_ctx->subctx->data->key_id);
+   std::uint32_t size = crypt_ctx->subctx->data->block_size * (crypt_ctx->subctx->nBlocks - 1) + (crypt_ctx->subctx->tail_size);
 
-      bytes_left = bytes_left - crypt_ctx->subctx->data->block_size;
-      offset = offset + crypt_ctx->subctx->data->block_size;
-      counter = counter + 1;
-   }
-   while(counter != crypt_ctx->subctx->nBlocks);
+   pfs_decrypt_unicv(cryptops, iF00D, key, tweak_enc_key, tweak_key, size, crypt_ctx->subctx->data->block_size, buffer, buffer, crypt_ctx->subctx->data->crypto_engine_flag, crypt_ctx->subctx->data->key_id);
 
    return 0;
 }
@@ -445,3 +436,162 @@ void pfs_decrypt(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF
       break;
    }
 }
+
+//----------------------
+
+//specialized kernels for read operation
+//gamedata/savedata, keygen and verify/decrypt switches are template parameters
+//so that each combination is compiled into separate loop without flag checks
+//crypto objects are passed to inner loops through non-owning context
+//when backend is OpenSSLCryptoOperations calls are dispatched statically
+
+template<typename TCryptoOperations, bool gamedata>
+int icv_verify_kernel(const PfsCryptoContext<TCryptoOperations>& ctx, const CryptEngineSubctx* subctx, const unsigned char* source)
+{
+   const CryptEngineData* data = subctx->data;
+
+   std::uint32_t bytes_left = data->block_size * (subctx->nBlocks - 1) + (subctx->tail_size);
+
+   const unsigned char* signatures_base = subctx->signature_table;
+
+   unsigned char digest[0x14] = {0};
+   unsigned char bytes14[0x14] = {0};
+
+   for(std::uint32_t i = 0; i < subctx->nBlocks; i++)
+   {
+      //calculate ICV
+      if(gamedata)
+      {
+         std::uint32_t tweak_key = subctx->sector_base + i;
+         SceKernelUtilsForDriver_sceHmacSha1DigestForDriver(ctx, data->secret, 0x14, (unsigned char*)&tweak_key, 4, digest);
+
+         int size_arg = (data->block_size < bytes_left) ? data->block_size : bytes_left;
+         SceSblSsMgrForDriver_sceSblSsMgrHMACSHA1ForDriver(ctx, source, bytes14, size_arg, digest, 0, 1, 0);
+      }
+      else
+      {
+         SceSblSsMgrForDriver_sceSblSsMgrHMACSHA1ForDriver(ctx, source, bytes14, data->block_size, data->secret, 0, 1, 0);
+      }
+
+      //compare ICVs
+      if(memcmp(signatures_base, bytes14, 0x14) != 0)
+         return -1;
+
+      bytes_left = bytes_left - data->block_size;
+      source = source + data->block_size;
+      signatures_base = signatures_base + 0x14;
+   }
+
+   return 0;
+}
+
+template<typename TCryptoOperations, bool gamedata, bool keygen, bool verify, bool decrypt>
+void crypt_for_read_kernel(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, CryptEngineWorkCtx* crypt_ctx)
+{
+   //kernel is selected with pfs_select_decrypt_kernel which checks the actual type of cryptops
+   PfsCryptoContext<TCryptoOperations> ctx(static_cast<TCryptoOperations*>(cryptops.get()), iF00D.get());
+
+   const CryptEngineSubctx* subctx = crypt_ctx->subctx;
+   const CryptEngineData* data = subctx->data;
+
+   unsigned char* work_buffer = gamedata ? subctx->work_buffer1 : subctx->work_buffer0;
+
+   if(subctx->nBlocks == 0)
+   {
+      crypt_ctx->error = 0;
+      return;
+   }
+
+   //verifies icv table
+   if(verify)
+   {
+      if(icv_verify_kernel<TCryptoOperations, gamedata>(ctx, subctx, work_buffer) < 0)
+      {
+         crypt_ctx->error = 0x80140F02;
+         return;
+      }
+   }
+
+   //remove encryption layer
+   if(decrypt)
+   {
+      std::uint64_t tweak_key = data->block_size * subctx->sector_base;
+
+      if(gamedata)
+      {
+         std::uint32_t size = data->block_size * (subctx->nBlocks - 1) + (subctx->tail_size);
+         pfs_decrypt_unicv_cbc<TCryptoOperations, keygen>(ctx, data->dec_key, data->tweak_enc_key, tweak_key, size, data->block_size, work_buffer, work_buffer, data->key_id);
+      }
+      else
+      {
+         pfs_decrypt_icv_xts<TCryptoOperations>(ctx, data->dec_key, data->tweak_enc_key, 0x80, tweak_key, subctx->nBlocks, data->block_size, work_buffer, work_buffer);
+      }
+   }
+
+   crypt_ctx->error = 0;
+}
+
+template<typename TCryptoOperations, bool gamedata, bool keygen>
+pfs_crypt_kernel_t select_read_kernel(bool verify, bool decrypt)
+{
+   if(verify)
+      return decrypt ? crypt_for_read_kernel<TCryptoOperations, gamedata, keygen, true, true> : crypt_for_read_kernel<TCryptoOperations, gamedata, keygen, true, false>;
+   else
+      return decrypt ? crypt_for_read_kernel<TCryptoOperations, gamedata, keygen, false, true> : crypt_for_read_kernel<TCryptoOperations, gamedata, keygen, false, false>;
+}
+
+template<typename TCryptoOperations>
+pfs_crypt_kernel_t select_read_kernel(const CryptEngineData* data, bool verify, bool decrypt)
+{
+   if(is_gamedata(data->mode_index))
+   {
+      if(data->crypto_engine_flag & CRYPTO_ENGINE_CRYPTO_USE_KEYGEN)
+         return select_read_kernel<TCryptoOperations, true, true>(verify, decrypt);
+      else
+         return select_read_kernel<TCryptoOperations, true, false>(verify, decrypt);
+   }
+   else
+   {
+      //keygen is not used by xts-aes
+      return select_read_kernel<TCryptoOperations, false, false>(verify, decrypt);
+   }
+}
+
+pfs_crypt_kernel_t select_kernel(const CryptEngineSubctx* subctx, const ICryptoOperations* cryptops, bool verify_only)
+{
+   const CryptEngineData* data = subctx->data;
+
+   //only plain read of whole sectors is specialized
+   if(subctx->opt_code != CRYPT_ENGINE_READ || subctx->nBlocksTail != 0)
+      return pfs_decrypt;
+
+   //cmac operates with global buffer and also enables fake and unk modes - use generic kernel
+   if(data->crypto_engine_flag & CRYPTO_ENGINE_CRYPTO_USE_CMAC)
+      return pfs_decrypt;
+
+   bool is_dir = (data->fs_attr & ATTR_DIR) != 0;
+
+   bool verify = pfs_has_icv(data->fs_attr, data->crypto_engine_flag);
+   bool decrypt = !is_dir && !(data->fs_attr & ATTR_NENC) && !verify_only;
+
+   //known backends are dispatched statically
+   if(dynamic_cast<const OpenSSLCryptoOperations*>(cryptops) != nullptr)
+      return select_read_kernel<OpenSSLCryptoOperations>(data, verify, decrypt);
+   else
+      return select_read_kernel<ICryptoOperations>(data, verify, decrypt);
+}
+
+bool pfs_has_icv(std::uint16_t fs_attr, std::uint16_t crypto_engine_flag)
+{
+   return !(fs_attr & ATTR_DIR) && !(fs_attr & ATTR_NICV) && !(crypto_engine_flag & CRYPTO_ENGINE_SKIP_VERIFY);
+}
+
+pfs_crypt_kernel_t pfs_select_decrypt_kernel(const CryptEngineSubctx* subctx, const ICryptoOperations* cryptops)
+{
+   return select_kernel(subctx, cryptops, false);
+}
+
+pfs_crypt_kernel_t pfs_select_verify_kernel(const CryptEngineSubctx* subctx, const ICryptoOperations* cryptops)
+{
+   return select_kernel(subctx, cryptops, true);
+}
@@ -69,4 +69,20 @@ typedef struct derive_keys_ctx
 
 }derive_keys_ctx;
 
-void pfs_decrypt(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, CryptEngineWorkCtx *work_ctx);
\ No newline at end of file
+void pfs_decrypt(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, CryptEngineWorkCtx *work_ctx);
+
+//true if icv of sectors is checked for file with these settings. false for directories, files without icv and images that skip verification
+bool pfs_has_icv(std::uint16_t fs_attr, std::uint16_t crypto_engine_flag);
+
+//decryption kernel signature. pfs_decrypt is the generic kernel
+typedef void (*pfs_crypt_kernel_t)(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, CryptEngineWorkCtx* work_ctx);
+
+//selects kernel that is specialized for settings of initialized subctx and for type of cryptops
+//settings do not change for the whole file so kernel can be selected once and inner loops do not check flags
+//selected kernel must be called with the same cryptops
+//returns pfs_decrypt if settings are not supported by specialized kernels
+pfs_crypt_kernel_t pfs_select_decrypt_kernel(const CryptEngineSubctx* subctx, const ICryptoOperations* cryptops);
+
+//same as pfs_select_decrypt_kernel but selected kernel only verifies icv of sectors and leaves data encrypted
+//returns pfs_decrypt (which also decrypts) if settings are not supported by specialized kernels
+pfs_crypt_kernel_t pfs_select_verify_kernel(const CryptEngineSubctx* subctx, const ICryptoOperations* cryptops);
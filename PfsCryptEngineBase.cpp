@@ -4,9 +4,17 @@
 #include <string>
 #include <cstring>
 #include <stdexcept>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PFS_HAS_SSE2_XTS_MASK 1
+#endif
 
 #include "SceSblSsMgrForDriver.h"
 #include "SceKernelUtilsForDriver.h"
+#include "AesNiKernels.h"
+#include "OpenSSLCryptoOperations.h"
 
 //#### FUNCTIONS OF GROUP 1/2 are used to encrypt/decrypt unicv.db ####
 
@@ -49,7 +57,8 @@ int AESCBCEncrypt_base(std::shared_ptr<ICryptoOperations> cryptops, const unsign
 }
 
 //ok
-int AESCBCDecrypt_base(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* key, unsigned char* tweak, std::uint32_t size, const unsigned char* src, unsigned char* dst)
+template<typename TCryptoOperations>
+int AESCBCDecrypt_base(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* key, unsigned char* tweak, std::uint32_t size, const unsigned char* src, unsigned char* dst)
 {
    int size_tail = size & 0xF; // get size of tail
    int size_block = size & (~0xF); // get block size aligned to 0x10 boundary
@@ -58,7 +67,7 @@ int AESCBCDecrypt_base(std::shared_ptr<ICryptoOperations> cryptops, const unsign
 
    if(size_block != 0)
    {
-      int result0 = SceSblSsMgrForDriver_sceSblSsMgrAESCBCDecryptForDriver(cryptops, src, dst, size_block, key, 0x80, tweak, 1);
+      int result0 = SceSblSsMgrForDriver_sceSblSsMgrAESCBCDecryptForDriver(ctx, src, dst, size_block, key, 0x80, tweak, 1);
       if(result0 != 0)
          return result0;
    }
@@ -74,7 +83,7 @@ int AESCBCDecrypt_base(std::shared_ptr<ICryptoOperations> cryptops, const unsign
    
    //encrypt iv using key
 
-   int result1 = SceSblSsMgrForDriver_sceSblSsMgrAESECBEncryptForDriver(cryptops, tweak, tweak_enc, 0x10, key, 0x80, 1);
+   int result1 = SceSblSsMgrForDriver_sceSblSsMgrAESECBEncryptForDriver(ctx, tweak, tweak_enc, 0x10, key, 0x80, 1);
    if(result1 != 0)
       return result1;
 
@@ -86,6 +95,11 @@ int AESCBCDecrypt_base(std::shared_ptr<ICryptoOperations> cryptops, const unsign
    return 0;
 }
 
+int AESCBCDecrypt_base(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* key, unsigned char* tweak, std::uint32_t size, const unsigned char* src, unsigned char* dst)
+{
+   return AESCBCDecrypt_base(PfsCryptoContext<ICryptoOperations>(cryptops.get(), nullptr), key, tweak, size, src, dst);
+}
+
 //ok
 int AESCBCEncryptWithKeygen_base(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, const unsigned char* key, unsigned char* tweak, std::uint32_t size, const unsigned char* src, unsigned char* dst, std::uint16_t key_id)
 {   
@@ -127,7 +141,8 @@ int AESCBCEncryptWithKeygen_base(std::shared_ptr<ICryptoOperations> cryptops, st
 }
 
 //ok
-int AESCBCDecryptWithKeygen_base(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, const unsigned char* key, unsigned char* tweak, std::uint32_t size, const unsigned char* src, unsigned char* dst, std::uint16_t key_id)
+template<typename TCryptoOperations>
+int AESCBCDecryptWithKeygen_base(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* key, unsigned char* tweak, std::uint32_t size, const unsigned char* src, unsigned char* dst, std::uint16_t key_id)
 {
    std::uint16_t kid = key_id;
 
@@ -138,7 +153,7 @@ int AESCBCDecryptWithKeygen_base(std::shared_ptr<ICryptoOperations> cryptops, st
 
    if(size_block != 0)
    {
-      int result0 = SceSblSsMgrForDriver_sceSblSsMgrAESCBCDecryptWithKeygenForDriver(cryptops, iF00D, src, dst, size_block, key, 0x80, tweak, kid, 1);
+      int result0 = SceSblSsMgrForDriver_sceSblSsMgrAESCBCDecryptWithKeygenForDriver(ctx, src, dst, size_block, key, 0x80, tweak, kid, 1);
       if(result0 != 0)
          return result0;
    }
@@ -154,7 +169,7 @@ int AESCBCDecryptWithKeygen_base(std::shared_ptr<ICryptoOperations> cryptops, st
 
    //encrypt iv using key
 
-   int result1 = SceSblSsMgrForDriver_sceSblSsMgrAESECBEncryptWithKeygenForDriver(cryptops, iF00D, tweak, tweak_enc, 0x10, key, 0x80, kid, 1);
+   int result1 = SceSblSsMgrForDriver_sceSblSsMgrAESECBEncryptWithKeygenForDriver(ctx, tweak, tweak_enc, 0x10, key, 0x80, kid, 1);
    if(result1 != 0)
       return result1;
 
@@ -166,6 +181,11 @@ int AESCBCDecryptWithKeygen_base(std::shared_ptr<ICryptoOperations> cryptops, st
    return 0;
 }
 
+int AESCBCDecryptWithKeygen_base(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, const unsigned char* key, unsigned char* tweak, std::uint32_t size, const unsigned char* src, unsigned char* dst, std::uint16_t key_id)
+{
+   return AESCBCDecryptWithKeygen_base(PfsCryptoContext<ICryptoOperations>(cryptops.get(), iF00D.get()), key, tweak, size, src, dst, key_id);
+}
+
 //#### GROUP 2 (possible keygen aes-cmac-cts dec/aes-cmac-cts enc) (technically there is no dec/enc - this is pair of same functions since cmac) ####
 
 // FUNCTIONS ARE SIMILAR
@@ -373,27 +393,21 @@ std::uint32_t adcs(std::uint32_t left, std::uint32_t right, std::uint32_t* carry
 }
 
 //this implementation is nearly identical to XTS-AES implementation here
-//the only difference is that this method not only calculates multiply 2 (LFSR shift)
-//but also xores source data with the LFSR register
-//multiplication by 2 is implemented through addition (x1 = x0 + x0)
+//the only difference is that multiplication by 2 (LFSR shift) is implemented through addition (x1 = x0 + x0)
 //https://github.com/libtom/libtomcrypt/blob/c14bcf4d302f954979f0de43f7544cf30873f5a6/src/modes/xts/xts_mult_x.c#L20
 //here is more info about tweak perturbation
 //https://crypto.stackexchange.com/questions/47223/xex-mode-how-to-perturb-the-tweak
-int xts_mult_x_xor_data_xts(std::uint32_t* src, std::uint32_t* tweak_enc_value, std::uint32_t* dst, std::uint32_t size)
+//this function writes sequence of tweaks for size bytes of data to mask
+//tweak_value is advanced to the tweak that follows the last one so that sequence can be continued with next call
+void xts_generate_mask_generic(unsigned char* tweak_value, std::uint32_t size, unsigned char* mask)
 {
    std::uint32_t tweak_cpy[4] = {0};
-   memcpy(tweak_cpy, tweak_enc_value, 0x10);
+   memcpy(tweak_cpy, tweak_value, 0x10);
 
-   while(size != 0)
+   for(std::uint32_t offset = 0; offset < size; offset += 0x10)
    {
-      dst[0] = src[0] ^ tweak_cpy[0];
-      dst[1] = src[1] ^ tweak_cpy[1];
-      dst[2] = src[2] ^ tweak_cpy[2];
-      dst[3] = src[3] ^ tweak_cpy[3];
+      memcpy(mask + offset, tweak_cpy, 0x10);
 
-      src += 4;
-      dst += 4;
-      
       std::uint32_t carry = 0;
       tweak_cpy[0] = adds(tweak_cpy[0], tweak_cpy[0], &carry);
       tweak_cpy[1] = adcs(tweak_cpy[1], tweak_cpy[1], &carry);
@@ -402,11 +416,87 @@ int xts_mult_x_xor_data_xts(std::uint32_t* src, std::uint32_t* tweak_enc_value,
 
       if(carry > 0)
          tweak_cpy[0] = tweak_cpy[0] ^ 0x87;
-      
-      size = size - 0x10;
    }
 
-   return 0;
+   memcpy(tweak_value, tweak_cpy, 0x10);
+}
+
+//same as xts_generate_mask_generic
+void xts_generate_mask(unsigned char* tweak_value, std::uint32_t size, unsigned char* mask)
+{
+#ifdef PFS_HAS_SSE2_XTS_MASK
+   //each 32 bit lane is doubled and carry of previous lane is added
+   //carry of last lane goes to lane 0 and is reduced with 0x87
+   const __m128i poly = _mm_set_epi32(1, 1, 1, 0x87);
+
+   __m128i t = _mm_loadu_si128((const __m128i*)tweak_value);
+
+   for(std::uint32_t offset = 0; offset < size; offset += 0x10)
+   {
+      _mm_storeu_si128((__m128i*)(mask + offset), t);
+
+      __m128i carry = _mm_srai_epi32(t, 31);
+      carry = _mm_shuffle_epi32(carry, 0x93);
+      carry = _mm_and_si128(carry, poly);
+      t = _mm_xor_si128(_mm_add_epi32(t, t), carry);
+   }
+
+   _mm_storeu_si128((__m128i*)tweak_value, t);
+#else
+   xts_generate_mask_generic(tweak_value, size, mask);
+#endif
+}
+
+//xores data with mask produced by xts_generate_mask. src and dst may point to the same buffer
+void xts_xor_mask(const unsigned char* src, const unsigned char* mask, unsigned char* dst, std::uint32_t size)
+{
+   std::uint32_t offset = 0;
+
+#ifdef PFS_HAS_SSE2_XTS_MASK
+   for(; offset + 0x40 <= size; offset += 0x40)
+   {
+      __m128i d0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + offset + 0x00)), _mm_loadu_si128((const __m128i*)(mask + offset + 0x00)));
+      __m128i d1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + offset + 0x10)), _mm_loadu_si128((const __m128i*)(mask + offset + 0x10)));
+      __m128i d2 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + offset + 0x20)), _mm_loadu_si128((const __m128i*)(mask + offset + 0x20)));
+      __m128i d3 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + offset + 0x30)), _mm_loadu_si128((const __m128i*)(mask + offset + 0x30)));
+      _mm_storeu_si128((__m128i*)(dst + offset + 0x00), d0);
+      _mm_storeu_si128((__m128i*)(dst + offset + 0x10), d1);
+      _mm_storeu_si128((__m128i*)(dst + offset + 0x20), d2);
+      _mm_storeu_si128((__m128i*)(dst + offset + 0x30), d3);
+   }
+
+   for(; offset < size; offset += 0x10)
+   {
+      __m128i d = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + offset)), _mm_loadu_si128((const __m128i*)(mask + offset)));
+      _mm_storeu_si128((__m128i*)(dst + offset), d);
+   }
+#else
+   for(; offset < size; offset += 0x08)
+   {
+      std::uint64_t d = 0;
+      std::uint64_t m = 0;
+      memcpy(&d, src + offset, 0x08);
+      memcpy(&m, mask + offset, 0x08);
+      d = d ^ m;
+      memcpy(dst + offset, &d, 0x08);
+   }
+#endif
+}
+
+//mask is generated in chunks of fixed buffer on stack so that sectors of any size do not allocate
+void xts_xor_tweaks(const unsigned char* tweak_enc_value, std::uint32_t size, const unsigned char* src, unsigned char* dst)
+{
+   unsigned char tweak[0x10];
+   memcpy(tweak, tweak_enc_value, 0x10);
+
+   unsigned char mask[XTS_MASK_CHUNK_SIZE];
+
+   for(std::uint32_t offset = 0; offset < size; offset += XTS_MASK_CHUNK_SIZE)
+   {
+      std::uint32_t chunk = std::min<std::uint32_t>(size - offset, XTS_MASK_CHUNK_SIZE);
+      xts_generate_mask(tweak, chunk, mask);
+      xts_xor_mask(src + offset, mask, dst + offset, chunk);
+   }
 }
 
 //this implementation assumes that src and dst are 0x10 bytes long (used by cmac related functions)
@@ -442,41 +532,61 @@ int xts_mult_x_xor_data_cmac(std::uint32_t* src, std::uint32_t* tweak_enc_value,
 //ok
 int XTSAESEncrypt_base(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t key_size, std::uint32_t size, const unsigned char* src, unsigned char* dst)
 {
+   //single pass native kernel. produces same result as code below
+   if(key_size == 0x80 && aesni_is_supported())
+   {
+      aesni_xts_encrypt_128(tweak, dst_key, tweak_enc_key, size, src, dst);
+      return 0;
+   }
+
    //encrypt tweak
 
    unsigned char tweak_enc_value[0x10] = {0};
    cryptops->aes_ecb_encrypt(tweak, tweak_enc_value, 0x10, tweak_enc_key, key_size);
 
-   //do tweak crypt
+   //do tweak crypt. tweaks are generated again after ecb pass instead of being kept for whole data
 
-   xts_mult_x_xor_data_xts((std::uint32_t*)src, (std::uint32_t*)tweak_enc_value, (std::uint32_t*)dst, size);
+   xts_xor_tweaks(tweak_enc_value, size, src, dst);
 
    int result0 = SceSblSsMgrForDriver_sceSblSsMgrAESECBEncryptForDriver(cryptops, dst, dst, size, dst_key, key_size, 1);
    if(result0 == 0)
-      xts_mult_x_xor_data_xts((std::uint32_t*)dst, (std::uint32_t*)tweak_enc_value, (std::uint32_t*)dst, size);
+      xts_xor_tweaks(tweak_enc_value, size, dst, dst);
 
    return result0;
 }
 
 //ok
-int XTSAESDecrypt_base(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t key_size, std::uint32_t size, const unsigned char* src, unsigned char* dst)
+template<typename TCryptoOperations>
+int XTSAESDecrypt_base(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t key_size, std::uint32_t size, const unsigned char* src, unsigned char* dst)
 {
+   //single pass native kernel. produces same result as code below
+   if(key_size == 0x80 && aesni_is_supported())
+   {
+      aesni_xts_decrypt_128(tweak, dst_key, tweak_enc_key, size, src, dst);
+      return 0;
+   }
+
    //encrypt tweak
 
    unsigned char tweak_enc_value[0x10] = {0};
-   cryptops->aes_ecb_encrypt(tweak, tweak_enc_value, 0x10, tweak_enc_key, key_size);
+   ctx.cryptops()->aes_ecb_encrypt(tweak, tweak_enc_value, 0x10, tweak_enc_key, key_size);
 
-   //do tweak uncrypt
+   //do tweak uncrypt. tweaks are generated again after ecb pass instead of being kept for whole data
 
-   xts_mult_x_xor_data_xts((std::uint32_t*)src, (std::uint32_t*)tweak_enc_value, (std::uint32_t*)dst, size);
+   xts_xor_tweaks(tweak_enc_value, size, src, dst);
 
-   int result0 = SceSblSsMgrForDriver_sceSblSsMgrAESECBDecryptForDriver(cryptops, dst, dst, size, dst_key, key_size, 1);
+   int result0 = SceSblSsMgrForDriver_sceSblSsMgrAESECBDecryptForDriver(ctx, dst, dst, size, dst_key, key_size, 1);
    if(result0 == 0)
-      xts_mult_x_xor_data_xts((std::uint32_t*)dst, (std::uint32_t*)tweak_enc_value, (std::uint32_t*)dst, size);
+      xts_xor_tweaks(tweak_enc_value, size, dst, dst);
 
    return result0;
 }
 
+int XTSAESDecrypt_base(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t key_size, std::uint32_t size, const unsigned char* src, unsigned char* dst)
+{
+   return XTSAESDecrypt_base(PfsCryptoContext<ICryptoOperations>(cryptops.get(), nullptr), tweak, dst_key, tweak_enc_key, key_size, size, src, dst);
+}
+
 //#### GROUP 4 (no keygen xts-cmac dec/xts-cmac enc) (technically there is no dec/enc - this is pair of same functions since cmac) ####
 
 // FUNCTIONS ARE SIMILAR
@@ -517,4 +627,15 @@ int XTSCMACDecrypt_base(std::shared_ptr<ICryptoOperations> cryptops, const unsig
       xts_mult_x_xor_data_cmac((std::uint32_t*)dst, (std::uint32_t*)tweak_enc_value, (std::uint32_t*)dst, size);
 
    return result0;
-}
\ No newline at end of file
+}
+
+//non-owning variants are instantiated for generic interface and for concrete backends
+
+template int AESCBCDecrypt_base<ICryptoOperations>(const PfsCryptoContext<ICryptoOperations>& ctx, const unsigned char* key, unsigned char* tweak, std::uint32_t size, const unsigned char* src, unsigned char* dst);
+template int AESCBCDecrypt_base<OpenSSLCryptoOperations>(const PfsCryptoContext<OpenSSLCryptoOperations>& ctx, const unsigned char* key, unsigned char* tweak, std::uint32_t size, const unsigned char* src, unsigned char* dst);
+
+template int AESCBCDecryptWithKeygen_base<ICryptoOperations>(const PfsCryptoContext<ICryptoOperations>& ctx, const unsigned char* key, unsigned char* tweak, std::uint32_t size, const unsigned char* src, unsigned char* dst, std::uint16_t key_id);
+template int AESCBCDecryptWithKeygen_base<OpenSSLCryptoOperations>(const PfsCryptoContext<OpenSSLCryptoOperations>& ctx, const unsigned char* key, unsigned char* tweak, std::uint32_t size, const unsigned char* src, unsigned char* dst, std::uint16_t key_id);
+
+template int XTSAESDecrypt_base<ICryptoOperations>(const PfsCryptoContext<ICryptoOperations>& ctx, const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t key_size, std::uint32_t size, const unsigned char* src, unsigned char* dst);
+template int XTSAESDecrypt_base<OpenSSLCryptoOperations>(const PfsCryptoContext<OpenSSLCryptoOperations>& ctx, const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t key_size, std::uint32_t size, const unsigned char* src, unsigned char* dst);
@@ -5,13 +5,14 @@
 
 #include "IF00DKeyEncryptor.h"
 #include "ICryptoOperations.h"
+#include "PfsCryptoContext.h"
 
 //#### FUNCTIONS OF GROUP 1/2 are used to encrypt/decrypt unicv.db ####
 //group 1 is relevant - it is implementation of aes-cbc-cts used to encrypt/ decrypt unicv.db
 //it is important that: tweak is used as iv and aes-cbc implements cts
 
 //group 2 is not relevant in particular since it is a cmac that outputs only 0x10 bytes
-//these functions operate with global g_cmac_buffer buffer and not with destination buffer
+//these functions operate with per thread g_cmac_buffer buffer and not with destination buffer
 //true purpose of cmac functions is still not known
 
 //#### GROUP 1 (possible keygen aes-cbc-cts dec/aes-cbc-cts enc) ####
@@ -42,7 +43,7 @@ int AESCMACDecryptWithKeygen_base(std::shared_ptr<ICryptoOperations> cryptops, s
 //group 3 is relevant - it is implementation of xts-aes used to encrypt/ decrypt icv.db
 
 //group 4 is not relevant in particular since it is a cmac that outputs only 0x10 bytes
-//these functions operate with global g_cmac_buffer buffer and not with destination buffer
+//these functions operate with per thread g_cmac_buffer buffer and not with destination buffer
 //true purpose of cmac functions is still not known
 
 //#### GROUP 3 (no keygen xts-aes dec/xts-aes enc) ####
@@ -51,10 +52,37 @@ int XTSAESEncrypt_base(std::shared_ptr<ICryptoOperations> cryptops, const unsign
 
 int XTSAESDecrypt_base(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t key_size, std::uint32_t size, const unsigned char* src, unsigned char* dst);
 
+//tweak sequence of xts-aes. size has to be multiple of 0x10
+//xts_generate_mask and xts_xor_mask are vectorized where possible, xts_generate_mask_generic is the original adds/adcs implementation
+
+//size of stack buffer that keeps part of mask. xts-aes functions generate mask in chunks of this size
+#define XTS_MASK_CHUNK_SIZE 0x1000
+
+void xts_generate_mask_generic(unsigned char* tweak_value, std::uint32_t size, unsigned char* mask);
+
+void xts_generate_mask(unsigned char* tweak_value, std::uint32_t size, unsigned char* mask);
+
+void xts_xor_mask(const unsigned char* src, const unsigned char* mask, unsigned char* dst, std::uint32_t size);
+
+//xores size bytes of data with sequence of tweaks that starts with tweak_enc_value. src and dst may point to the same buffer
+void xts_xor_tweaks(const unsigned char* tweak_enc_value, std::uint32_t size, const unsigned char* src, unsigned char* dst);
+
 //#### GROUP 4 (no keygen xts-cmac dec/xts-cmac enc) (technically there is no dec/enc - this is pair of same functions since cmac) ####
 
 //should use g_cmac_buffer global buffer
 int XTSCMACEncrypt_base(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t key_size, std::uint32_t size, const unsigned char* src, unsigned char dst[0x10]);
 
 //should use g_cmac_buffer global buffer
-int XTSCMACDecrypt_base(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t key_size, std::uint32_t size, const unsigned char* src, unsigned char dst[0x10]);
\ No newline at end of file
+int XTSCMACDecrypt_base(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t key_size, std::uint32_t size, const unsigned char* src, unsigned char dst[0x10]);
+
+//#### NON-OWNING VARIANTS ####
+//used in inner loops of crypt engine. functions above with same names forward to them
+
+template<typename TCryptoOperations>
+int AESCBCDecrypt_base(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* key, unsigned char* tweak, std::uint32_t size, const unsigned char* src, unsigned char* dst);
+
+template<typename TCryptoOperations>
+int AESCBCDecryptWithKeygen_base(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* key, unsigned char* tweak, std::uint32_t size, const unsigned char* src, unsigned char* dst, std::uint16_t key_id);
+
+template<typename TCryptoOperations>
+int XTSAESDecrypt_base(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key, std::uint32_t key_size, std::uint32_t size, const unsigned char* src, unsigned char* dst);
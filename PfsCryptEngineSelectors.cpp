@@ -6,6 +6,8 @@
 
 #include "PfsCryptEngineBase.h"
 #include "FlagOperations.h"
+#include "AesNiKernels.h"
+#include "OpenSSLCryptoOperations.h"
 
 //this macro unwraps 64 bit sector number into byte array
 #define UINT64_TO_BYTEARRAY(x, y)                                              \
@@ -36,10 +38,80 @@ int UINT128_BYTEARRAY_INC(unsigned char iv[0x10])
 //#### GROUP 1 (possible keygen aes-cbc-cts dec/aes-cbc-cts enc) ####
 //#### GROUP 2 (possible keygen aes-cmac-cts dec/aes-cmac-cts enc) (technically there is no dec/enc - this is pair of same functions since cmac) ####
 
-unsigned char g_cmac_buffer[0x10] = {0};
+//cmac result is scratch that nobody reads. it is per thread so that titles with cmac can be decrypted concurrently (batch lanes, verify lanes)
+thread_local unsigned char g_cmac_buffer[0x10] = {0};
+
+template<typename TCryptoOperations, bool keygen>
+int pfs_decrypt_unicv_cbc(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* key, const unsigned char* tweak_mask, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst, std::uint16_t key_id)
+{
+   if(size == 0)
+      return 0;
+
+   //fast path - key is derived once for all sectors and sectors are decrypted with native kernel
+   //this is equivalent of AESCBCDecryptWithKeygen_base called for each sector below
+   if(keygen && key_id == 0 && aesni_is_supported())
+   {
+      unsigned char drv_key[0x20] = {0}; //use max possible buffer
+      if(ctx.iF00D()->encrypt_key(key, 0x80, drv_key) < 0)
+         return -1;
+
+      aesni_cbc_decrypt_sectors_128(drv_key, tweak_mask, tweak_key, size, block_size, src, dst);
+      return 0;
+   }
+
+   unsigned char tweak[0x10] = {0};
+
+   std::uint32_t offset = 0;
+   std::uint32_t bytes_left = size;
+
+   do
+   {
+      std::uint64_t tweak_key_ofst = tweak_key + offset;
+      UINT64_TO_BYTEARRAY(tweak_key_ofst, tweak); // modify tweak (mimic xts-aes) by adding offset to the tweak
+
+      memset(tweak + 8, 0, 8); //set upper tweak to 0
+
+      for(int i = 0; i < 0x10; i++)
+         tweak[i] = tweak[i] ^ tweak_mask[i]; // xor tweak with mask (kinda mimic tweak_enc_value in xts-aes)
+
+      std::uint32_t size_arg = (block_size < bytes_left) ? block_size : bytes_left;
+
+      int result0 = 0;
+      if(keygen)
+         result0 = AESCBCDecryptWithKeygen_base(ctx, key, tweak, size_arg, src + offset, dst + offset, key_id); //cbc decrypt with tweak as iv
+      else
+         result0 = AESCBCDecrypt_base(ctx, key, tweak, size_arg, src + offset, dst + offset); //cbc decrypt with tweak as iv
+
+      if(result0 != 0)
+         return result0;
+
+      offset = offset + block_size;
+      bytes_left = bytes_left - block_size;
+   }
+   while(size > offset);
+
+   return 0;
+}
+
+template int pfs_decrypt_unicv_cbc<ICryptoOperations, true>(const PfsCryptoContext<ICryptoOperations>& ctx, const unsigned char* key, const unsigned char* tweak_mask, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst, std::uint16_t key_id);
+template int pfs_decrypt_unicv_cbc<ICryptoOperations, false>(const PfsCryptoContext<ICryptoOperations>& ctx, const unsigned char* key, const unsigned char* tweak_mask, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst, std::uint16_t key_id);
+
+template int pfs_decrypt_unicv_cbc<OpenSSLCryptoOperations, true>(const PfsCryptoContext<OpenSSLCryptoOperations>& ctx, const unsigned char* key, const unsigned char* tweak_mask, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst, std::uint16_t key_id);
+template int pfs_decrypt_unicv_cbc<OpenSSLCryptoOperations, false>(const PfsCryptoContext<OpenSSLCryptoOperations>& ctx, const unsigned char* key, const unsigned char* tweak_mask, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst, std::uint16_t key_id);
 
 int pfs_decrypt_unicv(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, const unsigned char* key, const unsigned char* tweak_mask, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst, std::uint16_t crypto_engine_flag, std::uint16_t key_id)
 {
+   //plain aes-cbc-cts does not depend on global cmac buffer and is handled by specialized kernels
+   if(!(crypto_engine_flag & CRYPTO_ENGINE_CRYPTO_USE_CMAC))
+   {
+      PfsCryptoContext<ICryptoOperations> ctx(cryptops.get(), iF00D.get());
+
+      if(crypto_engine_flag & CRYPTO_ENGINE_CRYPTO_USE_KEYGEN)
+         return pfs_decrypt_unicv_cbc<ICryptoOperations, true>(ctx, key, tweak_mask, tweak_key, size, block_size, src, dst, key_id);
+      else
+         return pfs_decrypt_unicv_cbc<ICryptoOperations, false>(ctx, key, tweak_mask, tweak_key, size, block_size, src, dst, key_id);
+   }
+
    unsigned char tweak[0x10] = {0};
 
    UINT64_TO_BYTEARRAY(tweak_key, tweak); //convert std::uint64_t tweak to byte array
@@ -74,19 +146,9 @@ int pfs_decrypt_unicv(std::shared_ptr<ICryptoOperations> cryptops, std::shared_p
             size_arg = bytes_left;
 
          if(crypto_engine_flag & CRYPTO_ENGINE_CRYPTO_USE_KEYGEN)
-         {
-            if(crypto_engine_flag & CRYPTO_ENGINE_CRYPTO_USE_CMAC)
-               AESCMACDecryptWithKeygen_base(cryptops, iF00D, key, tweak, size_arg, src + offset, g_cmac_buffer, key_id);
-            else
-               AESCBCDecryptWithKeygen_base(cryptops, iF00D, key, tweak, size_arg, src + offset, dst + offset, key_id); //cbc decrypt with tweak as iv
-         }
+            AESCMACDecryptWithKeygen_base(cryptops, iF00D, key, tweak, size_arg, src + offset, g_cmac_buffer, key_id);
          else
-         {
-            if(crypto_engine_flag & CRYPTO_ENGINE_CRYPTO_USE_CMAC)
-               AESCMACDecrypt_base(cryptops, key, tweak, size_arg, src + offset, g_cmac_buffer);
-            else
-               AESCBCDecrypt_base(cryptops, key, tweak, size_arg, src + offset, dst + offset); //cbc decrypt with tweak as iv
-         }
+            AESCMACDecrypt_base(cryptops, key, tweak, size_arg, src + offset, g_cmac_buffer);
 
          offset = offset + block_size;
          bytes_left = bytes_left - block_size;
@@ -96,12 +158,9 @@ int pfs_decrypt_unicv(std::shared_ptr<ICryptoOperations> cryptops, std::shared_p
 
    //copy result to dest buffer since cmac functions operate with global buffer
 
-   if(crypto_engine_flag & CRYPTO_ENGINE_CRYPTO_USE_CMAC)
+   if(dst != src)
    {
-      if(dst != src)
-      {
-         memcpy(dst, src, size);
-      }
+      memcpy(dst, src, size);
    }
 
    return 0;
@@ -183,6 +242,36 @@ int pfs_encrypt_unicv(std::shared_ptr<ICryptoOperations> cryptops, std::shared_p
 //assuming that it adds 1 to tweak_key when decrypting each next block
 //in practice though it looks like this method is only used to decrypt single block
 
+template<typename TCryptoOperations>
+int pfs_decrypt_icv_xts(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* key, const unsigned char* tweak_enc_key, std::uint32_t keysize, std::uint64_t tweak_key, std::uint32_t nSectors, std::uint32_t block_size, const unsigned char* src, unsigned char* dst)
+{
+   unsigned char tweak[0x10] = {0};
+
+   if(block_size <= 0xF) //block_size should be at least one block
+      return 0x80140609;
+
+   std::uint64_t offset = 0;
+
+   for(std::uint32_t i = 0; i < nSectors; i++)
+   {
+      std::uint64_t tweak_key_ofst = tweak_key + offset;
+      UINT64_TO_BYTEARRAY(tweak_key_ofst, tweak); //convert std::uint64_t tweak to byte array
+
+      memset(tweak + 8, 0, 8); //set upper tweak to 0
+
+      int result0 = XTSAESDecrypt_base(ctx, tweak, key, tweak_enc_key, keysize, block_size, src + offset, dst + offset); //xts-aes decrypt
+      if(result0 != 0)
+         return result0;
+
+      offset = offset + block_size;
+   }
+
+   return 0;
+}
+
+template int pfs_decrypt_icv_xts<ICryptoOperations>(const PfsCryptoContext<ICryptoOperations>& ctx, const unsigned char* key, const unsigned char* tweak_enc_key, std::uint32_t keysize, std::uint64_t tweak_key, std::uint32_t nSectors, std::uint32_t block_size, const unsigned char* src, unsigned char* dst);
+template int pfs_decrypt_icv_xts<OpenSSLCryptoOperations>(const PfsCryptoContext<OpenSSLCryptoOperations>& ctx, const unsigned char* key, const unsigned char* tweak_enc_key, std::uint32_t keysize, std::uint64_t tweak_key, std::uint32_t nSectors, std::uint32_t block_size, const unsigned char* src, unsigned char* dst);
+
 int pfs_decrypt_icv(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* key, const unsigned char* tweak_enc_key, std::uint32_t keysize, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst, std::uint16_t crypto_engine_flag)
 {
    unsigned char tweak[0x10] = {0};
@@ -5,12 +5,19 @@
 
 #include "IF00DKeyEncryptor.h"
 #include "ICryptoOperations.h"
+#include "PfsCryptoContext.h"
 
 //#### GROUP 1 (possible keygen aes-cbc-cts dec/aes-cbc-cts enc) ####
 //#### GROUP 2 (possible keygen aes-cmac-cts dec/aes-cmac-cts enc) (technically there is no dec/enc - this is pair of same functions since cmac) ####
 
 int pfs_decrypt_unicv(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, const unsigned char* key, const unsigned char* tweak_mask, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst, std::uint16_t crypto_engine_flag, std::uint16_t key_id);
 
+//aes-cbc-cts decryption of consecutive sectors without cmac
+//keygen is known for the whole file so flag checks are resolved at compile time
+//instantiated for ICryptoOperations and OpenSSLCryptoOperations
+template<typename TCryptoOperations, bool keygen>
+int pfs_decrypt_unicv_cbc(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* key, const unsigned char* tweak_mask, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst, std::uint16_t key_id);
+
 int pfs_encrypt_unicv(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, const unsigned char* key, const unsigned char* tweak_mask, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst, std::uint16_t crypto_engine_flag, std::uint16_t key_id);
 
 //#### GROUP 3 (no keygen xts-aes dec/xts-aes enc) ####
@@ -18,4 +25,10 @@ int pfs_encrypt_unicv(std::shared_ptr<ICryptoOperations> cryptops, std::shared_p
 
 int pfs_decrypt_icv(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* key, const unsigned char* tweak_enc_key, std::uint32_t keysize, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst, std::uint16_t crypto_engine_flag);
 
+//xts-aes decryption of nSectors full sectors without cmac
+//tweak of each sector is tweak_key + sector offset in bytes
+//instantiated for ICryptoOperations and OpenSSLCryptoOperations
+template<typename TCryptoOperations>
+int pfs_decrypt_icv_xts(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* key, const unsigned char* tweak_enc_key, std::uint32_t keysize, std::uint64_t tweak_key, std::uint32_t nSectors, std::uint32_t block_size, const unsigned char* src, unsigned char* dst);
+
 int pfs_encrypt_icv(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* key, const unsigned char* tweak_enc_key, std::uint32_t keysize, std::uint64_t tweak_key, std::uint32_t size, std::uint32_t block_size, const unsigned char* src, unsigned char* dst, std::uint16_t crypto_engine_flag);
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "IF00DKeyEncryptor.h"
+#include "ICryptoOperations.h"
+
+//non-owning view of crypto objects that is passed through inner loops of crypt engine instead of shared pointers
+//objects are owned by PfsFilesystem and must outlive the context
+//TCryptoOperations can be a concrete final implementation (like OpenSSLCryptoOperations)
+//in which case calls are dispatched statically and can be inlined
+template<typename TCryptoOperations>
+class PfsCryptoContext
+{
+private:
+   TCryptoOperations* m_cryptops;
+   IF00DKeyEncryptor* m_iF00D;
+
+public:
+   PfsCryptoContext(TCryptoOperations* cryptops, IF00DKeyEncryptor* iF00D)
+      : m_cryptops(cryptops), m_iF00D(iF00D)
+   {
+   }
+
+public:
+   TCryptoOperations* cryptops() const
+   {
+      return m_cryptops;
+   }
+
+   IF00DKeyEncryptor* iF00D() const
+   {
+      return m_iF00D;
+   }
+};
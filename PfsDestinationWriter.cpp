@@ -0,0 +1,491 @@
+#include "PfsDestinationWriter.h"
+
+#include "PfsIoQueueFactory.h"
+
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#endif
+#endif
+
+//thin wrappers over system calls that differ between platforms
+
+static std::int64_t fd_write(int fd, const char* data, std::size_t size)
+{
+#ifdef _WIN32
+   return _write(fd, data, static_cast<unsigned int>(std::min<std::size_t>(size, 0x40000000)));
+#else
+   return ::write(fd, data, size);
+#endif
+}
+
+static std::int64_t fd_read(int fd, char* data, std::size_t size)
+{
+#ifdef _WIN32
+   return _read(fd, data, static_cast<unsigned int>(std::min<std::size_t>(size, 0x40000000)));
+#else
+   return ::read(fd, data, size);
+#endif
+}
+
+static int fd_truncate(int fd, std::uint64_t size)
+{
+#ifdef _WIN32
+   return _chsize_s(fd, size) == 0 ? 0 : -1;
+#else
+   return ::ftruncate(fd, static_cast<off_t>(size));
+#endif
+}
+
+//reserves space without changing the data. failure is not an error since it is only a hint
+static void fd_preallocate(int fd, std::uint64_t size)
+{
+#ifdef __linux__
+   //fallocate fails on filesystems without support instead of writing zeros like posix_fallocate does
+   if(size > 0)
+      fallocate(fd, 0, 0, static_cast<off_t>(size));
+#else
+   (void)fd;
+   (void)size;
+#endif
+}
+
+//clones whole file sharing extents with the source (btrfs, xfs)
+static bool fd_clone(int src, int dst)
+{
+#if defined(__linux__) && defined(FICLONE)
+   return ioctl(dst, FICLONE, src) == 0;
+#else
+   (void)src;
+   (void)dst;
+   return false;
+#endif
+}
+
+//copies data inside the kernel. may also reflink or do server side copy on network filesystems
+//returns number of bytes copied or -1 if copy_file_range is not available for these files
+static std::int64_t fd_copy_range(int src, int dst, std::uint64_t size)
+{
+#if defined(__linux__) && defined(__NR_copy_file_range)
+   std::uint64_t copied = 0;
+
+   while(copied < size)
+   {
+      std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(size - copied, 0x40000000));
+
+      long res = syscall(__NR_copy_file_range, src, NULL, dst, NULL, chunk, 0);
+      if(res < 0)
+      {
+         if(errno == EINTR)
+            continue;
+
+         //unsupported for these files. caller falls back to reads and writes from current offset
+         if(copied == 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP || errno == EBADF))
+            return -1;
+
+         return copied > 0 ? static_cast<std::int64_t>(copied) : -1;
+      }
+
+      //end of source
+      if(res == 0)
+         break;
+
+      copied += res;
+   }
+
+   return copied;
+#else
+   (void)src;
+   (void)dst;
+   (void)size;
+   return -1;
+#endif
+}
+
+//===
+
+PfsFileWriter::PfsFileWriter(std::shared_ptr<IPfsIoQueue> queue, PfsCacheModes mode)
+   : m_queue(queue), m_mode(mode), m_fd(-1), m_tailFd(-1), m_offset(0), m_current(0), m_nInFlight(0), m_failed(false)
+{
+   if(!m_queue)
+      m_queue = PfsIoQueueFactory::create(PfsIoQueueTypes::sync, 1, PFS_WRITER_BUFFER_SIZE);
+
+   m_pending.assign(m_queue->depth(), 0);
+}
+
+PfsFileWriter::~PfsFileWriter()
+{
+   close();
+}
+
+void PfsFileWriter::set_digest(std::shared_ptr<PfsChunkDigest> digest)
+{
+   m_digest = digest;
+}
+
+int PfsFileWriter::open(const psvpfs::path& filepath, std::uint64_t size)
+{
+   close();
+
+   //direct io needs aligned buffers of aligned size
+   if(m_mode == PfsCacheModes::direct && m_queue->buffer_size() % PFS_IO_BUFFER_ALIGNMENT == 0)
+   {
+      m_fd = pfs_open_output(filepath, true, true);
+      if(m_fd >= 0)
+      {
+         m_tailFd = pfs_open_output(filepath, false);
+         if(m_tailFd < 0)
+         {
+            pfs_close(m_fd);
+            m_fd = -1;
+            return -1;
+         }
+      }
+   }
+
+   //filesystem may not support direct io. then pages are dropped when file is closed
+   if(m_fd < 0)
+      m_fd = pfs_open_output(filepath, true);
+   if(m_fd < 0)
+      return -1;
+
+   fd_preallocate(m_fd, size);
+
+   m_offset = 0;
+   m_failed = false;
+
+   if(m_digest)
+      m_digest->reset();
+
+   m_current = 0;
+   char* data = reinterpret_cast<char*>(m_queue->buffer(m_current));
+   setp(data, data + m_queue->buffer_size());
+
+   return 0;
+}
+
+int PfsFileWriter::close()
+{
+   if(m_fd < 0)
+      return 0;
+
+   if(flush_buffer() < 0)
+      m_failed = true;
+
+   while(m_nInFlight > 0)
+   {
+      if(complete_write() < 0)
+         break;
+   }
+
+   //preallocated space beyond written data is released
+   if(fd_truncate(m_fd, m_offset) < 0)
+      m_failed = true;
+
+   if(m_mode != PfsCacheModes::buffered)
+      pfs_drop_written(m_tailFd >= 0 ? m_tailFd : m_fd);
+
+   if(m_tailFd >= 0 && pfs_close(m_tailFd) < 0)
+      m_failed = true;
+   m_tailFd = -1;
+
+   if(pfs_close(m_fd) < 0)
+      m_failed = true;
+
+   m_fd = -1;
+   setp(0, 0);
+
+   return m_failed ? -1 : 0;
+}
+
+std::int64_t PfsFileWriter::complete_write()
+{
+   std::uint32_t index;
+   std::int64_t result;
+   if(m_queue->wait(index, result) < 0)
+   {
+      m_failed = true;
+      m_nInFlight = 0;
+      return -1;
+   }
+
+   if(result < 0 || static_cast<std::size_t>(result) != m_pending[index])
+      m_failed = true;
+
+   m_pending[index] = 0;
+   m_nInFlight--;
+
+   return index;
+}
+
+int PfsFileWriter::flush_buffer()
+{
+   std::size_t size = pptr() - pbase();
+   if(size == 0)
+      return 0;
+
+   //data is hashed once here. tail that is moved below is written by submit_write directly
+   if(m_digest)
+      m_digest->update(reinterpret_cast<const std::uint8_t*>(pbase()), size);
+
+   if(m_tailFd < 0)
+      return submit_write(m_fd, size);
+
+   //direct io needs aligned size. this only happens at the end of file
+   //aligned part is written directly and unaligned tail is moved to next buffer and written through page cache
+   std::size_t tail = size % PFS_IO_BUFFER_ALIGNMENT;
+   if(tail == 0)
+      return submit_write(m_fd, size);
+
+   if(size > tail)
+   {
+      const char* tailData = pbase() + size - tail;
+      if(submit_write(m_fd, size - tail) < 0)
+         return -1;
+
+      //buffer that is being written is only read so tail can be copied from it
+      memmove(pptr(), tailData, tail);
+      pbump(static_cast<int>(tail));
+   }
+
+   return submit_write(m_tailFd, tail);
+}
+
+int PfsFileWriter::submit_write(int fd, std::size_t size)
+{
+   if(m_queue->prep_write(fd, m_current, m_offset, size) < 0 || m_queue->submit() < 0)
+   {
+      m_failed = true;
+      return -1;
+   }
+
+   m_pending[m_current] = size;
+   m_nInFlight++;
+   m_offset += size;
+
+   //next free buffer. if all of them are in flight the oldest write has to finish
+   std::int64_t next = -1;
+   for(std::uint32_t i = 0; i < m_pending.size() && next < 0; i++)
+   {
+      if(m_pending[i] == 0)
+         next = i;
+   }
+
+   if(next < 0)
+      next = complete_write();
+
+   if(next < 0 || m_failed)
+      return -1;
+
+   m_current = static_cast<std::uint32_t>(next);
+   char* data = reinterpret_cast<char*>(m_queue->buffer(m_current));
+   setp(data, data + m_queue->buffer_size());
+
+   return 0;
+}
+
+PfsFileWriter::int_type PfsFileWriter::overflow(int_type c)
+{
+   if(m_fd < 0 || m_failed)
+      return traits_type::eof();
+
+   if(flush_buffer() < 0)
+      return traits_type::eof();
+
+   if(!traits_type::eq_int_type(c, traits_type::eof()))
+   {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+   }
+
+   return traits_type::not_eof(c);
+}
+
+std::streamsize PfsFileWriter::xsputn(const char* s, std::streamsize n)
+{
+   if(m_fd < 0 || m_failed)
+      return 0;
+
+   std::streamsize total = n;
+
+   while(n > 0)
+   {
+      std::size_t chunk = std::min<std::size_t>(static_cast<std::size_t>(n), epptr() - pptr());
+      memcpy(pptr(), s, chunk);
+      pbump(static_cast<int>(chunk));
+
+      s += chunk;
+      n -= chunk;
+
+      if(pptr() == epptr() && flush_buffer() < 0)
+         return total - n;
+   }
+
+   return total;
+}
+
+int PfsFileWriter::sync()
+{
+   //partial buffer would break alignment of next direct writes. it is written by close
+   if(m_tailFd >= 0)
+      return 0;
+
+   return flush_buffer() < 0 ? -1 : 0;
+}
+
+//===
+
+PfsDestinationWriter::PfsDestinationWriter(std::ostream& output, PfsCacheModes mode)
+   : m_output(output), m_mode(mode)
+{
+}
+
+int PfsDestinationWriter::create_directories(const psvpfs::path& directory)
+{
+   std::string key = directory.generic_string();
+   if(m_directories.find(key) != m_directories.end())
+      return 0;
+
+   std::error_code ec;
+   psvpfs::create_directories(directory, ec);
+   if(ec)
+   {
+      m_output << "Failed to create: " << key << std::endl;
+      return -1;
+   }
+
+   //all parents exist too
+   for(psvpfs::path p = directory; !p.empty() && m_directories.insert(p.generic_string()).second; p = p.parent_path())
+   {
+      if(p == p.parent_path())
+         break;
+   }
+
+   return 0;
+}
+
+int PfsDestinationWriter::open_file(const psvpfs::path& filepath, std::uint64_t size, PfsFileWriter& writer)
+{
+   if(create_directories(filepath.parent_path()) < 0)
+      return -1;
+
+   if(writer.open(filepath, size) < 0)
+   {
+      m_output << "Failed to open " << filepath.generic_string() << std::endl;
+      return -1;
+   }
+
+   return 0;
+}
+
+int PfsDestinationWriter::copy_file(const psvpfs::path& source, const psvpfs::path& destination, std::uint64_t size)
+{
+   if(create_directories(destination.parent_path()) < 0)
+      return -1;
+
+   int src = pfs_open_input(source);
+   if(src < 0)
+   {
+      m_output << "Failed to open " << source.generic_string() << std::endl;
+      return -1;
+   }
+
+   int dst = pfs_open_output(destination, true);
+   if(dst < 0)
+   {
+      pfs_close(src);
+      m_output << "Failed to open " << destination.generic_string() << std::endl;
+      return -1;
+   }
+
+   if(m_mode != PfsCacheModes::buffered)
+      pfs_advise_sequential(src);
+
+   bool ok = true;
+
+   //clone copies whole file. it is trimmed to the size below
+   if(!fd_clone(src, dst))
+   {
+      std::uint64_t copied = 0;
+
+      std::int64_t res = fd_copy_range(src, dst, size);
+      if(res > 0)
+         copied = res;
+
+      //plain copy of what is left. both offsets are at the end of copied range
+      std::vector<char> buffer;
+      while(copied < size)
+      {
+         if(buffer.empty())
+            buffer.resize(PFS_WRITER_BUFFER_SIZE);
+
+         std::int64_t nRead = fd_read(src, buffer.data(), static_cast<std::size_t>(std::min<std::uint64_t>(size - copied, buffer.size())));
+         if(nRead < 0)
+         {
+#ifndef _WIN32
+            if(errno == EINTR)
+               continue;
+#endif
+            ok = false;
+            break;
+         }
+
+         //source is shorter. rest is filled by truncate
+         if(nRead == 0)
+            break;
+
+         for(std::int64_t done = 0; done < nRead; )
+         {
+            std::int64_t nWritten = fd_write(dst, buffer.data() + done, static_cast<std::size_t>(nRead - done));
+            if(nWritten < 0)
+            {
+#ifndef _WIN32
+               if(errno == EINTR)
+                  continue;
+#endif
+               ok = false;
+               break;
+            }
+            done += nWritten;
+         }
+
+         if(!ok)
+            break;
+
+         copied += nRead;
+      }
+   }
+
+   if(ok && fd_truncate(dst, size) < 0)
+      ok = false;
+
+   if(m_mode != PfsCacheModes::buffered)
+   {
+      pfs_drop_cache(src, 0, 0);
+      pfs_drop_written(dst);
+   }
+
+   pfs_close(src);
+   if(pfs_close(dst) < 0)
+      ok = false;
+
+   if(!ok)
+   {
+      m_output << "Failed to copy: " << source.generic_string() << " to " << destination.generic_string() << std::endl;
+      return -1;
+   }
+
+   return 0;
+}
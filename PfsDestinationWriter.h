@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <set>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <streambuf>
+
+#include "LocalFilesystem.h"
+#include "IPfsIoQueue.h"
+#include "PfsCacheControl.h"
+#include "PfsExtractManifest.h"
+
+//size of write buffer when writer has no queue of its own. writes are issued in multiples of this size except for the tail of the file
+#define PFS_WRITER_BUFFER_SIZE 0x100000
+
+//buffered writer of single output file
+//file is preallocated at its final size so that filesystem can place it contiguously
+//data is collected into buffers of the queue and every full buffer is written with single request at aligned offset
+//next buffer is filled while previous ones are still being written
+//in direct mode full buffers are written with direct io and unaligned tail of the file through page cache
+//if digest is set every buffer is hashed before it is written so that output does not have to be read back
+class PfsFileWriter : public std::streambuf
+{
+private:
+   std::shared_ptr<IPfsIoQueue> m_queue;
+   PfsCacheModes m_mode;
+   int m_fd;
+   int m_tailFd; //buffered descriptor for unaligned tail in direct mode. -1 otherwise
+   std::uint64_t m_offset; //offset of next write
+   std::vector<std::size_t> m_pending; //size of write in flight of every buffer. 0 if buffer is free
+   std::uint32_t m_current; //buffer that is being filled
+   std::uint32_t m_nInFlight;
+   bool m_failed;
+   std::shared_ptr<PfsChunkDigest> m_digest;
+
+public:
+   //queue can be shared by writers that are used one after another
+   PfsFileWriter(std::shared_ptr<IPfsIoQueue> queue = std::shared_ptr<IPfsIoQueue>(), PfsCacheModes mode = PfsCacheModes::buffered);
+
+   PfsFileWriter(const PfsFileWriter&) = delete;
+
+   PfsFileWriter& operator=(const PfsFileWriter&) = delete;
+
+   ~PfsFileWriter();
+
+public:
+   //digest is reset by open and covers all data of the file after close
+   void set_digest(std::shared_ptr<PfsChunkDigest> digest);
+
+   //creates or truncates the file and preallocates size bytes
+   int open(const psvpfs::path& filepath, std::uint64_t size);
+
+   //flushes the buffer, trims file to the number of written bytes and closes it
+   //returns -1 if any write failed
+   int close();
+
+   bool is_open() const
+   {
+      return m_fd >= 0;
+   }
+
+private:
+   int flush_buffer();
+
+   //writes first size bytes of current buffer and switches to next free buffer
+   int submit_write(int fd, std::size_t size);
+
+   //waits for any write and returns its buffer
+   std::int64_t complete_write();
+
+protected:
+   int_type overflow(int_type c) override;
+
+   std::streamsize xsputn(const char* s, std::streamsize n) override;
+
+   int sync() override;
+};
+
+//creates output tree in destination root
+//directories that were created already are remembered so that each one is created with single call
+class PfsDestinationWriter
+{
+private:
+   std::ostream& m_output;
+   PfsCacheModes m_mode;
+   std::set<std::string> m_directories;
+
+public:
+   PfsDestinationWriter(std::ostream& output, PfsCacheModes mode = PfsCacheModes::buffered);
+
+public:
+   int create_directories(const psvpfs::path& directory);
+
+   //creates parent directories and opens preallocated file
+   int open_file(const psvpfs::path& filepath, std::uint64_t size, PfsFileWriter& writer);
+
+   //copies first size bytes of source file (file is extended with zeros if source is shorter)
+   //clone (reflink) is tried first, then copy_file_range and then plain reads and writes
+   //copy always goes through page cache. pages of both files are dropped afterwards unless mode is buffered
+   int copy_file(const psvpfs::path& source, const psvpfs::path& destination, std::uint64_t size);
+};
@@ -0,0 +1,298 @@
+#include "PfsExtractManifest.h"
+
+#include "MappedFile.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+
+static std::string to_uppercase_copy(const std::string& str)
+{
+   std::string result = str;
+   std::transform(result.begin(), result.end(), result.begin(), static_cast<int (*)(int)>(std::toupper));
+   return result;
+}
+
+PfsChunkDigest::PfsChunkDigest(std::shared_ptr<ICryptoOperations> cryptops)
+   : m_cryptops(cryptops)
+{
+}
+
+void PfsChunkDigest::reset()
+{
+   m_chunk.clear();
+   m_chunkDigests.clear();
+}
+
+void PfsChunkDigest::update(const std::uint8_t* data, std::size_t size)
+{
+   while(size > 0)
+   {
+      if(m_chunk.empty() && size >= PFS_EXTRACT_DIGEST_CHUNK_SIZE)
+      {
+         std::size_t offset = m_chunkDigests.size();
+         m_chunkDigests.resize(offset + 0x14);
+         m_cryptops->sha1(data, m_chunkDigests.data() + offset, PFS_EXTRACT_DIGEST_CHUNK_SIZE);
+
+         data += PFS_EXTRACT_DIGEST_CHUNK_SIZE;
+         size -= PFS_EXTRACT_DIGEST_CHUNK_SIZE;
+         continue;
+      }
+
+      std::size_t n = std::min<std::size_t>(size, PFS_EXTRACT_DIGEST_CHUNK_SIZE - m_chunk.size());
+      m_chunk.insert(m_chunk.end(), data, data + n);
+
+      data += n;
+      size -= n;
+
+      if(m_chunk.size() == PFS_EXTRACT_DIGEST_CHUNK_SIZE)
+      {
+         std::size_t offset = m_chunkDigests.size();
+         m_chunkDigests.resize(offset + 0x14);
+         m_cryptops->sha1(m_chunk.data(), m_chunkDigests.data() + offset, static_cast<int>(m_chunk.size()));
+         m_chunk.clear();
+      }
+   }
+}
+
+std::string PfsChunkDigest::finish()
+{
+   if(!m_chunk.empty())
+   {
+      std::size_t offset = m_chunkDigests.size();
+      m_chunkDigests.resize(offset + 0x14);
+      m_cryptops->sha1(m_chunk.data(), m_chunkDigests.data() + offset, static_cast<int>(m_chunk.size()));
+   }
+
+   unsigned char digest[0x14] = {0};
+   m_cryptops->sha1(m_chunkDigests.data(), digest, static_cast<int>(m_chunkDigests.size()));
+
+   reset();
+
+   return byte_array_to_string(digest, 0x14);
+}
+
+//===
+
+PfsExtractManifest::PfsExtractManifest(std::shared_ptr<ICryptoOperations> cryptops, std::ostream& output, const psvpfs::path& destinationRoot,
+                                       const std::string& name)
+   : m_cryptops(cryptops), m_output(output), m_destinationRoot(destinationRoot), m_manifestPath(destinationRoot / name), m_validSize(0), m_verify(false)
+{
+}
+
+std::string PfsExtractManifest::get_relative_path(const psvpfs::path& outputPath) const
+{
+   return psvpfs::relative(outputPath, m_destinationRoot).generic_string();
+}
+
+bool PfsExtractManifest::parse_line(const std::string& line, pfs_manifest_entry_t& entry) const
+{
+   std::istringstream ss(line);
+
+   std::string salt;
+   if(!(ss >> salt >> entry.size >> entry.digest))
+      return false;
+
+   //path is the rest of the line and may contain spaces
+   if(ss.get() != ' ')
+      return false;
+
+   std::getline(ss, entry.path);
+   if(entry.path.empty())
+      return false;
+
+   if(salt.size() != 8 || entry.digest.size() != 0x14 * 2)
+      return false;
+
+   try
+   {
+      entry.icv_salt = static_cast<std::uint32_t>(std::stoul(salt, nullptr, 16));
+   }
+   catch(std::exception&)
+   {
+      return false;
+   }
+
+   return true;
+}
+
+int PfsExtractManifest::load()
+{
+   m_entries.clear();
+   m_validSize = 0;
+
+   if(!psvpfs::exists(m_manifestPath))
+      return 0;
+
+   std::ifstream inputStream(m_manifestPath.generic_string().c_str(), std::ios::in | std::ios::binary);
+   if(!inputStream.is_open())
+   {
+      m_output << "Failed to open " << m_manifestPath.generic_string() << std::endl;
+      return -1;
+   }
+
+   std::string data((std::istreambuf_iterator<char>(inputStream)), std::istreambuf_iterator<char>());
+
+   //last line without terminator was interrupted while being written
+   std::size_t begin = 0;
+   for(std::size_t end = data.find('\n'); end != std::string::npos; begin = end + 1, end = data.find('\n', begin))
+   {
+      pfs_manifest_entry_t entry;
+      if(!parse_line(data.substr(begin, end - begin), entry))
+         continue;
+
+      //later entry of the same file wins
+      m_entries[to_uppercase_copy(entry.path)] = entry;
+   }
+
+   m_validSize = begin;
+
+   return 0;
+}
+
+int PfsExtractManifest::open()
+{
+   if(load() < 0)
+      return -1;
+
+   if(m_entries.size() > 0)
+      m_output << "Loaded " << m_entries.size() << " completed files from " << m_manifestPath.filename().generic_string() << std::endl;
+
+   if(psvpfs::exists(m_manifestPath))
+   {
+      //drop partial line so that new entries start on their own line
+      if(psvpfs::file_size(m_manifestPath) != m_validSize)
+         psvpfs::resize_file(m_manifestPath, m_validSize);
+   }
+   else
+   {
+      psvpfs::create_directories(m_destinationRoot);
+   }
+
+   m_journal.open(m_manifestPath.generic_string().c_str(), std::ios::out | std::ios::app | std::ios::binary);
+   if(!m_journal.is_open())
+   {
+      m_output << "Failed to open " << m_manifestPath.generic_string() << std::endl;
+      return -1;
+   }
+
+   return 0;
+}
+
+void PfsExtractManifest::set_verify(bool verify)
+{
+   m_verify = verify;
+}
+
+const pfs_manifest_entry_t* PfsExtractManifest::find(const psvpfs::path& outputPath) const
+{
+   auto it = m_entries.find(to_uppercase_copy(get_relative_path(outputPath)));
+   if(it == m_entries.end())
+      return 0;
+   return &it->second;
+}
+
+bool PfsExtractManifest::is_complete(const psvpfs::path& outputPath, std::uint32_t icv_salt) const
+{
+   const pfs_manifest_entry_t* found = find(outputPath);
+   if(!found)
+      return false;
+
+   const pfs_manifest_entry_t& entry = *found;
+
+   if(entry.icv_salt != icv_salt)
+      return false;
+
+   std::error_code ec;
+   if(!psvpfs::is_regular_file(outputPath, ec) || psvpfs::file_size(outputPath, ec) != entry.size || ec)
+      return false;
+
+   //output is only renamed to its final name when it is complete so size and salt are enough
+   //unless output could have been modified after it was committed
+   if(!m_verify)
+      return true;
+
+   std::string digest;
+   if(this->digest(outputPath, digest) < 0)
+      return false;
+
+   return digest == entry.digest;
+}
+
+int PfsExtractManifest::commit(const psvpfs::path& outputPath, std::uint32_t icv_salt, const std::string& digest)
+{
+   pfs_manifest_entry_t entry;
+   entry.path = get_relative_path(outputPath);
+   entry.icv_salt = icv_salt;
+   entry.size = psvpfs::file_size(outputPath);
+   entry.digest = digest;
+
+   return append(entry);
+}
+
+int PfsExtractManifest::append(const pfs_manifest_entry_t& entry)
+{
+   std::ostringstream line;
+   line << std::hex << std::setfill('0') << std::setw(8) << entry.icv_salt << std::dec << " " << entry.size << " " << entry.digest << " " << entry.path << "\n";
+
+   m_journal << line.str();
+   m_journal.flush();
+
+   if(!m_journal)
+   {
+      m_output << "Failed to write manifest entry for " << entry.path << std::endl;
+      return -1;
+   }
+
+   m_entries[to_uppercase_copy(entry.path)] = entry;
+
+   return 0;
+}
+
+int PfsExtractManifest::digest(const psvpfs::path& filepath, std::string& result) const
+{
+   MappedFile file;
+   if(!file.open(filepath))
+   {
+      m_output << "Failed to open " << filepath.generic_string() << std::endl;
+      return -1;
+   }
+
+   PfsChunkDigest digest(m_cryptops);
+   digest.update(file.data(), static_cast<std::size_t>(file.size()));
+
+   result = digest.finish();
+
+   return 0;
+}
+
+int PfsExtractManifest::digest(const psvpfs::path& filepath, std::uint64_t size, std::string& result) const
+{
+   MappedFile file;
+   if(!file.open(filepath))
+   {
+      m_output << "Failed to open " << filepath.generic_string() << std::endl;
+      return -1;
+   }
+
+   PfsChunkDigest digest(m_cryptops);
+
+   std::uint64_t dataSize = std::min<std::uint64_t>(size, file.size());
+   digest.update(file.data(), static_cast<std::size_t>(dataSize));
+
+   std::vector<std::uint8_t> zeros;
+   for(std::uint64_t left = size - dataSize; left > 0; )
+   {
+      std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(left, PFS_EXTRACT_DIGEST_CHUNK_SIZE));
+      zeros.resize(n);
+      digest.update(zeros.data(), n);
+      left -= n;
+   }
+
+   result = digest.finish();
+
+   return 0;
+}
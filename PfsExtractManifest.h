@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+#include "ICryptoOperations.h"
+#include "LocalFilesystem.h"
+
+//name of the manifest file in destination directory
+#define PFS_EXTRACT_MANIFEST_NAME ".psvpfsparser_manifest"
+
+//temporary name suffix of the file that is being written
+#define PFS_EXTRACT_PARTIAL_SUFFIX ".part"
+
+//size of the chunk that is hashed separately when computing output digest
+#define PFS_EXTRACT_DIGEST_CHUNK_SIZE 0x100000
+
+//digest of output that is computed from data as it is written
+//digest is sha1 over concatenated sha1 of every PFS_EXTRACT_DIGEST_CHUNK_SIZE chunk
+//whole chunks are hashed in place, only chunks that are split between calls of update are collected first
+class PfsChunkDigest
+{
+private:
+   std::shared_ptr<ICryptoOperations> m_cryptops;
+   std::vector<std::uint8_t> m_chunk; //start of chunk that is not complete yet
+   std::vector<std::uint8_t> m_chunkDigests;
+
+public:
+   PfsChunkDigest(std::shared_ptr<ICryptoOperations> cryptops);
+
+public:
+   void reset();
+
+   void update(const std::uint8_t* data, std::size_t size);
+
+   //returns hex string of digest of all data since reset and resets the digest
+   std::string finish();
+};
+
+struct pfs_manifest_entry_t
+{
+   std::string path;
+   std::uint32_t icv_salt;
+   std::uint64_t size;
+   std::string digest;
+};
+
+//journal of files that were completely extracted and verified
+//file is only committed after it was written under temporary name and renamed to its final name
+//every line is "<icv_salt hex> <size> <digest hex> <path relative to destination root>"
+//lines are appended and flushed one by one so interrupted extraction loses at most the last line
+//digest is computed by PfsChunkDigest while output is written. it is not read back unless verification is enabled
+class PfsExtractManifest
+{
+private:
+   std::shared_ptr<ICryptoOperations> m_cryptops;
+   std::ostream& m_output;
+   psvpfs::path m_destinationRoot;
+   psvpfs::path m_manifestPath;
+
+private:
+   std::map<std::string, pfs_manifest_entry_t> m_entries; //key is uppercase path
+   std::ofstream m_journal;
+   std::uint64_t m_validSize; //size of manifest without interrupted last line
+   bool m_verify;
+
+public:
+   PfsExtractManifest(std::shared_ptr<ICryptoOperations> cryptops, std::ostream& output, const psvpfs::path& destinationRoot,
+                      const std::string& name = PFS_EXTRACT_MANIFEST_NAME);
+
+private:
+   std::string get_relative_path(const psvpfs::path& outputPath) const;
+
+   bool parse_line(const std::string& line, pfs_manifest_entry_t& entry) const;
+
+public:
+   //loads entries without opening manifest for writing. missing manifest has no entries
+   int load();
+
+   //loads entries of previous run and opens manifest for writing
+   int open();
+
+   //outputs are read and checked against their digest by is_complete. disabled by default
+   void set_verify(bool verify);
+
+   //returns entry of the output or null
+   const pfs_manifest_entry_t* find(const psvpfs::path& outputPath) const;
+
+   //file is complete if it is in manifest with same salt and output on disk still has same size
+   //and if verification is enabled same digest
+   bool is_complete(const psvpfs::path& outputPath, std::uint32_t icv_salt) const;
+
+   //appends entry of output with digest that was computed while it was written
+   int commit(const psvpfs::path& outputPath, std::uint32_t icv_salt, const std::string& digest);
+
+   //appends entry with known digest to manifest
+   int append(const pfs_manifest_entry_t& entry);
+
+public:
+   int digest(const psvpfs::path& filepath, std::string& result) const;
+
+   //digest of first size bytes of the file. file that is shorter is extended with zeros
+   int digest(const psvpfs::path& filepath, std::uint64_t size, std::string& result) const;
+};
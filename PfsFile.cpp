@@ -1,13 +1,17 @@
 #include "PfsFile.h"
 
+#include "PfsFileReader.h"
+
+#include <algorithm>
+
 #include "MerkleTree.hpp"
-#include "PfsKeyGenerator.h"
 
-PfsFile::PfsFile(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, std::ostream& output,
+PfsFile::PfsFile(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, std::shared_ptr<PfsKeyRing> keyRing, std::ostream& output,
                  const unsigned char* klicensee, const psvpfs::path& titleIdPath,
                  const sce_ng_pfs_file_t& file, const sce_junction& filepath, const sce_ng_pfs_header_t& ngpfs, std::shared_ptr<sce_iftbl_base_t> table)
-   : m_cryptops(cryptops), m_iF00D(iF00D), m_output(output), m_titleIdPath(titleIdPath),
-     m_file(file), m_filepath(filepath), m_ngpfs(ngpfs), m_table(table)
+   : m_cryptops(cryptops), m_iF00D(iF00D), m_keyRing(keyRing), m_output(output), m_titleIdPath(titleIdPath),
+     m_file(file), m_filepath(filepath), m_ngpfs(ngpfs), m_table(table), m_kernel(pfs_decrypt), m_verifyOnly(false),
+     m_cacheMode(PfsCacheModes::buffered)
 {
    memcpy(m_klicensee, klicensee, 0x10);
 }
@@ -23,59 +27,19 @@ int collect_leaf(std::shared_ptr<merkle_tree_node<icv> > node, void* ctx)
    return 0;
 }
 
-int PfsFile::init_crypt_ctx(CryptEngineWorkCtx* work_ctx, sig_tbl_t& block, std::uint32_t sector_base, std::uint32_t tail_size, unsigned char* source) const
+//signatures of the block in order of sectors
+int PfsFile::build_signature_table(const sig_tbl_t& block, std::vector<std::uint8_t>& table) const
 {
-   memset(&m_data, 0, sizeof(CryptEngineData));
-   m_data.klicensee = m_klicensee;
-   m_data.files_salt = m_ngpfs.files_salt;
-   m_data.icv_salt = m_table->get_icv_salt();
-   m_data.mode_index = img_spec_to_mode_index(m_ngpfs.image_spec);
-   m_data.crypto_engine_flag = img_spec_to_crypto_engine_flag(m_ngpfs.image_spec) | CRYPTO_ENGINE_THROW_ERROR;
-   m_data.key_id = m_ngpfs.key_id;
-   m_data.fs_attr = m_file.file.m_info.get_original_type();
-   m_data.block_size = m_table->get_header()->get_fileSectorSize();
-
-   //--------------------------------
-
-   derive_keys_ctx drv_ctx;
-   memset(&drv_ctx, 0, sizeof(derive_keys_ctx));
-
-   drv_ctx.db_type = settings_to_db_type(m_data.mode_index, m_data.fs_attr);
-   drv_ctx.icv_version = m_table->get_header()->get_version();
-
-   if(is_gamedata(m_data.mode_index) && has_dbseed(drv_ctx.db_type, drv_ctx.icv_version))
-      memcpy(drv_ctx.dbseed, m_table->get_header()->get_dbseed(), 0x14);
-   else
-      memset(drv_ctx.dbseed, 0, 0x14);
-
-   setup_crypt_packet_keys(m_cryptops, m_iF00D, &m_data, &drv_ctx); //derive dec_key, tweak_enc_key, secret
-
-   //--------------------------------
-
-   memset(&m_sub_ctx, 0, sizeof(CryptEngineSubctx));
-   m_sub_ctx.opt_code = CRYPT_ENGINE_READ;
-   m_sub_ctx.data = &m_data;
-   m_sub_ctx.work_buffer_ofst = (unsigned char*)0;
-   m_sub_ctx.nBlocksOffset = 0;
-   m_sub_ctx.nBlocksTail = 0;
+   db_types db_type = settings_to_db_type(img_spec_to_mode_index(m_ngpfs.image_spec), m_file.file.m_info.get_original_type());
 
-   if(db_type_to_is_unicv(drv_ctx.db_type))
-      m_sub_ctx.nBlocks = block.get_header()->get_nSignatures(); //for unicv - number of hashes is equal to number of sectors, so can use get_nSignatures
-   else
-      m_sub_ctx.nBlocks = m_table->get_header()->get_numSectors(); //for icv - there are more hashes than sectors (because of merkle tree), so have to use get_numSectors
-
-   m_sub_ctx.sector_base = sector_base;
-   m_sub_ctx.dest_offset = 0;
-   m_sub_ctx.tail_size = tail_size;
-
-   if(db_type_to_is_unicv(drv_ctx.db_type))
+   if(db_type_to_is_unicv(db_type))
    {
-      m_signatureTable.clear();
-      m_signatureTable.resize(block.m_signatures.size() * block.get_header()->get_sigSize());
+      table.clear();
+      table.resize(block.m_signatures.size() * block.get_header()->get_sigSize());
       std::uint32_t signatureTableOffset = 0;
       for(auto& s :  block.m_signatures)
       {
-         memcpy(m_signatureTable.data() + signatureTableOffset, s.m_data.data(), block.get_header()->get_sigSize());
+         memcpy(table.data() + signatureTableOffset, s.m_data.data(), block.get_header()->get_sigSize());
          signatureTableOffset += block.get_header()->get_sigSize();
       }
    }
@@ -105,18 +69,99 @@ int PfsFile::init_crypt_ctx(CryptEngineWorkCtx* work_ctx, sig_tbl_t& block, std:
          naturalHashTable.insert(std::make_pair(leaves[j]->m_index, block.m_signatures[i]));
       }
 
-      m_signatureTable.clear();
-      m_signatureTable.resize(naturalHashTable.size() * block.get_header()->get_sigSize());
+      table.clear();
+      table.resize(naturalHashTable.size() * block.get_header()->get_sigSize());
 
       std::uint32_t signatureTableOffset = 0;
       for(auto& s :  naturalHashTable)
       {
-         memcpy(m_signatureTable.data() + signatureTableOffset, s.second.m_data.data(), block.get_header()->get_sigSize());
+         memcpy(table.data() + signatureTableOffset, s.second.m_data.data(), block.get_header()->get_sigSize());
          signatureTableOffset += block.get_header()->get_sigSize();
       }
    }
 
-   m_sub_ctx.signature_table = m_signatureTable.data();
+   return 0;
+}
+
+std::vector<std::uint8_t>* PfsFile::get_signature_table(std::uint32_t block_index) const
+{
+   auto it = m_signatureTables.find(block_index);
+   if(it != m_signatureTables.end())
+      return &it->second;
+
+   std::vector<std::uint8_t> table;
+   if(build_signature_table(m_table->get_blocks()[block_index], table) < 0)
+      return 0;
+
+   return &m_signatureTables.insert(std::make_pair(block_index, std::move(table))).first->second;
+}
+
+int PfsFile::init_crypt_ctx(CryptEngineWorkCtx* work_ctx, const sig_tbl_t& block, std::uint32_t sector_base, std::uint32_t tail_size, unsigned char* source) const
+{
+   db_types db_type = settings_to_db_type(img_spec_to_mode_index(m_ngpfs.image_spec), m_file.file.m_info.get_original_type());
+
+   std::uint32_t nSectors = 0;
+   if(db_type_to_is_unicv(db_type))
+      nSectors = block.get_header()->get_nSignatures(); //for unicv - number of hashes is equal to number of sectors, so can use get_nSignatures
+   else
+      nSectors = m_table->get_header()->get_numSectors(); //for icv - there are more hashes than sectors (because of merkle tree), so have to use get_numSectors
+
+   //blocks are decrypted one after another so table is not kept
+   if(build_signature_table(block, m_signatureTable) < 0)
+      return -1;
+
+   return init_crypt_ctx(work_ctx, block, m_signatureTable, sector_base, 0, nSectors, tail_size, source);
+}
+
+int PfsFile::init_crypt_ctx(CryptEngineWorkCtx* work_ctx, const sig_tbl_t& block, std::vector<std::uint8_t>& signatureTable, std::uint32_t sector_base, std::uint32_t sector_offset, std::uint32_t nSectors, std::uint32_t tail_size, unsigned char* source) const
+{
+   memset(&m_data, 0, sizeof(CryptEngineData));
+   m_data.klicensee = m_klicensee;
+   m_data.files_salt = m_ngpfs.files_salt;
+   m_data.icv_salt = m_table->get_icv_salt();
+   m_data.mode_index = img_spec_to_mode_index(m_ngpfs.image_spec);
+   m_data.crypto_engine_flag = img_spec_to_crypto_engine_flag(m_ngpfs.image_spec) | CRYPTO_ENGINE_THROW_ERROR;
+   m_data.key_id = m_ngpfs.key_id;
+   m_data.fs_attr = m_file.file.m_info.get_original_type();
+   m_data.block_size = m_table->get_header()->get_fileSectorSize();
+
+   //--------------------------------
+
+   derive_keys_ctx drv_ctx;
+   memset(&drv_ctx, 0, sizeof(derive_keys_ctx));
+
+   drv_ctx.db_type = settings_to_db_type(m_data.mode_index, m_data.fs_attr);
+   drv_ctx.icv_version = m_table->get_header()->get_version();
+
+   if(is_gamedata(m_data.mode_index) && has_dbseed(drv_ctx.db_type, drv_ctx.icv_version))
+      memcpy(drv_ctx.dbseed, m_table->get_header()->get_dbseed(), 0x14);
+   else
+      memset(drv_ctx.dbseed, 0, 0x14);
+
+   m_keyRing->setup_crypt_packet_keys(&m_data, &drv_ctx); //derive dec_key, tweak_enc_key, secret (memoized per mount)
+
+   //--------------------------------
+
+   memset(&m_sub_ctx, 0, sizeof(CryptEngineSubctx));
+   m_sub_ctx.opt_code = CRYPT_ENGINE_READ;
+   m_sub_ctx.data = &m_data;
+   m_sub_ctx.work_buffer_ofst = (unsigned char*)0;
+   m_sub_ctx.nBlocksOffset = 0;
+   m_sub_ctx.nBlocksTail = 0;
+
+   //only sectors starting from sector_offset within the block are processed
+   m_sub_ctx.nBlocks = nSectors;
+   m_sub_ctx.sector_base = sector_base + sector_offset;
+   m_sub_ctx.dest_offset = 0;
+   m_sub_ctx.tail_size = tail_size;
+
+   if((sector_offset + nSectors) * block.get_header()->get_sigSize() > signatureTable.size())
+   {
+      m_output << "Sector range is out of signature block" << std::endl;
+      return -1;
+   }
+
+   m_sub_ctx.signature_table = signatureTable.data() + sector_offset * block.get_header()->get_sigSize();
    m_sub_ctx.work_buffer0 = source;
    m_sub_ctx.work_buffer1 = source;
 
@@ -125,26 +170,28 @@ int PfsFile::init_crypt_ctx(CryptEngineWorkCtx* work_ctx, sig_tbl_t& block, std:
    work_ctx->subctx = &m_sub_ctx;
    work_ctx->error = 0;
 
+   //settings are known at this point - select specialized decryption kernel
+   if(m_verifyOnly)
+      m_kernel = pfs_select_verify_kernel(&m_sub_ctx, m_cryptops.get());
+   else
+      m_kernel = pfs_select_decrypt_kernel(&m_sub_ctx, m_cryptops.get());
+
    return 0;
 }
 
-int PfsFile::decrypt_icv_file(const psvpfs::path& destination_root) const
+int PfsFile::decrypt_icv_file(std::ostream& outputStream) const
 {
-   //create new file
-
-   std::ofstream outputStream;
-   if(!m_filepath.create_empty_file(m_titleIdPath, destination_root, outputStream))
-      return -1;
-
    //open encrypted file
 
-   std::ifstream inputStream;
-   if(!m_filepath.open(inputStream))
+   PfsFileReader reader(m_ioQueue, m_cacheMode);
+   if(reader.open(m_filepath.get_real()) < 0)
    {
       m_output << "Failed to open " << m_filepath << std::endl;
       return -1;
    }
 
+   std::istream inputStream(&reader);
+
    //do decryption
 
    // icv.db pfs files are padded to the nearest sector boundary
@@ -169,10 +216,10 @@ int PfsFile::decrypt_icv_file(const psvpfs::path& destination_root) const
          tail_size = m_table->get_header()->get_fileSectorSize();
 
       CryptEngineWorkCtx work_ctx;
-      if(init_crypt_ctx(&work_ctx, m_table->m_blocks.front(), 0, tail_size, buffer.data()) < 0)
+      if(init_crypt_ctx(&work_ctx, m_table->get_blocks().front(), 0, tail_size, buffer.data()) < 0)
          return -1;
 
-      pfs_decrypt(m_cryptops, m_iF00D, &work_ctx);
+      m_kernel(m_cryptops, m_iF00D, &work_ctx);
 
       if(work_ctx.error < 0)
       {
@@ -194,30 +241,24 @@ int PfsFile::decrypt_icv_file(const psvpfs::path& destination_root) const
       return -1;
    }
 
-   inputStream.close();
-
-   outputStream.close();
+   reader.close();
 
    return 0;
 }
 
-int PfsFile::decrypt_unicv_file(const psvpfs::path& destination_root) const
+int PfsFile::decrypt_unicv_file(std::ostream& outputStream) const
 {
-   //create new file
-
-   std::ofstream outputStream;
-   if(!m_filepath.create_empty_file(m_titleIdPath, destination_root, outputStream))
-      return -1;
-
    //open encrypted file
 
-   std::ifstream inputStream;
-   if(!m_filepath.open(inputStream))
+   PfsFileReader reader(m_ioQueue, m_cacheMode);
+   if(reader.open(m_filepath.get_real()) < 0)
    {
       m_output << "Failed to open " << m_filepath << std::endl;
       return -1;
    }
 
+   std::istream inputStream(&reader);
+
    //do decryption
 
    std::uintmax_t fileSize = m_filepath.file_size();
@@ -238,10 +279,10 @@ int PfsFile::decrypt_unicv_file(const psvpfs::path& destination_root) const
          tail_size = m_table->get_header()->get_fileSectorSize();
 
       CryptEngineWorkCtx work_ctx;
-      if(init_crypt_ctx(&work_ctx, m_table->m_blocks.front(), 0, tail_size, buffer.data()) < 0)
+      if(init_crypt_ctx(&work_ctx, m_table->get_blocks().front(), 0, tail_size, buffer.data()) < 0)
          return -1;
 
-      pfs_decrypt(m_cryptops, m_iF00D, &work_ctx);
+      m_kernel(m_cryptops, m_iF00D, &work_ctx);
 
       if(work_ctx.error < 0)
       {
@@ -261,7 +302,7 @@ int PfsFile::decrypt_unicv_file(const psvpfs::path& destination_root) const
       std::uint32_t sector_base = 0;
 
       //go through each block of sectors
-      for(auto& b : m_table->m_blocks)
+      for(auto& b : m_table->get_blocks())
       {
          //if number of sectors is less than number that fits into single signature page
          if(b.get_header()->get_nSignatures() < m_table->get_header()->get_binTreeNumMaxAvail())
@@ -285,7 +326,7 @@ int PfsFile::decrypt_unicv_file(const psvpfs::path& destination_root) const
             if(init_crypt_ctx(&work_ctx, b, sector_base, tail_size, buffer.data()) < 0)
                return -1;
 
-            pfs_decrypt(m_cryptops, m_iF00D, &work_ctx);
+            m_kernel(m_cryptops, m_iF00D, &work_ctx);
 
             if(work_ctx.error < 0)
             {
@@ -315,7 +356,7 @@ int PfsFile::decrypt_unicv_file(const psvpfs::path& destination_root) const
                if(init_crypt_ctx(&work_ctx, b, sector_base, tail_size, buffer.data()) < 0)
                   return -1;
 
-               pfs_decrypt(m_cryptops, m_iF00D, &work_ctx);
+               m_kernel(m_cryptops, m_iF00D, &work_ctx);
 
                if(work_ctx.error < 0)
                {
@@ -337,7 +378,7 @@ int PfsFile::decrypt_unicv_file(const psvpfs::path& destination_root) const
                if(init_crypt_ctx(&work_ctx, b, sector_base, m_table->get_header()->get_fileSectorSize(), buffer.data()) < 0)
                   return -1;
 
-               pfs_decrypt(m_cryptops, m_iF00D, &work_ctx);
+               m_kernel(m_cryptops, m_iF00D, &work_ctx);
 
                if(work_ctx.error < 0)
                {
@@ -356,17 +397,310 @@ int PfsFile::decrypt_unicv_file(const psvpfs::path& destination_root) const
       }
    }
 
-   inputStream.close();
+   reader.close();
+
+   return 0;
+}
+
+int PfsFile::decrypt_file(const psvpfs::path& destination_root, const std::string& suffix) const
+{
+   //create new file
+
+   std::ofstream outputStream;
+   if(!m_filepath.create_empty_file(m_titleIdPath, destination_root, outputStream, suffix))
+      return -1;
+
+   if(decrypt_file(outputStream) < 0)
+      return -1;
 
    outputStream.close();
 
    return 0;
 }
 
-int PfsFile::decrypt_file(const psvpfs::path& destination_root) const
+int PfsFile::decrypt_file(std::ostream& outputStream) const
 {
+   //signature blocks may not be loaded yet if unicv.db was parsed lazily
+   if(!m_table->load_blocks())
+      return -1;
+
+   int res = 0;
    if(img_spec_to_is_unicv(m_ngpfs.image_spec))
-      return decrypt_unicv_file(destination_root);
+      res = decrypt_unicv_file(outputStream);
    else
-      return decrypt_icv_file(destination_root);
-}
\ No newline at end of file
+      res = decrypt_icv_file(outputStream);
+
+   if(res < 0)
+      return -1;
+
+   if(!outputStream)
+   {
+      m_output << "Failed to write " << m_filepath << std::endl;
+      return -1;
+   }
+
+   return 0;
+}
+
+std::uint64_t PfsFile::size() const
+{
+   //icv.db pfs files are padded to the nearest sector boundary so real size is taken from files.db
+   if(img_spec_to_is_unicv(m_ngpfs.image_spec))
+      return m_filepath.file_size();
+   else
+      return m_file.file.m_info.header.size;
+}
+
+int PfsFile::open_input() const
+{
+   if(m_inputStream.is_open())
+      return 0;
+
+   if(!m_filepath.open(m_inputStream))
+   {
+      m_output << "Failed to open " << m_filepath << std::endl;
+      return -1;
+   }
+
+   return 0;
+}
+
+int PfsFile::read_sectors(std::uint32_t block_index, std::uint32_t sector_offset, std::uint32_t nSectors, std::uint64_t encryptedSize) const
+{
+   std::uint32_t sectorSize = m_table->get_header()->get_fileSectorSize();
+   std::uint32_t maxSectors = m_table->get_header()->get_binTreeNumMaxAvail();
+
+   //signature blocks of lazily parsed unicv.db are loaded up to the one that is needed
+   if(!m_table->load_blocks(block_index + 1))
+      return -1;
+
+   const sig_tbl_t& block = m_table->get_blocks()[block_index];
+
+   std::uint32_t sector_base = block_index * maxSectors;
+   std::uint64_t begin = static_cast<std::uint64_t>(sector_base + sector_offset) * sectorSize;
+   std::uint64_t end = begin + static_cast<std::uint64_t>(nSectors) * sectorSize;
+   if(end > encryptedSize)
+      end = encryptedSize;
+
+   if(begin >= end)
+   {
+      m_output << "Invalid sector range" << std::endl;
+      return -1;
+   }
+
+   //read only sectors that are needed
+
+   m_readBuffer.resize(static_cast<std::vector<std::uint8_t>::size_type>(end - begin));
+
+   m_inputStream.clear();
+   m_inputStream.seekg(begin);
+   m_inputStream.read((char*)m_readBuffer.data(), end - begin);
+   if(!m_inputStream)
+   {
+      m_output << "Failed to read " << m_filepath << std::endl;
+      return -1;
+   }
+
+   std::uint32_t tail_size = static_cast<std::uint32_t>((end - begin) - static_cast<std::uint64_t>(nSectors - 1) * sectorSize);
+
+   //random access reads come back to the same blocks so their signature tables are kept
+   //verification goes through every block once so table is not kept
+   std::vector<std::uint8_t>* signatureTable = &m_signatureTable;
+   if(m_verifyOnly)
+   {
+      if(build_signature_table(block, m_signatureTable) < 0)
+         return -1;
+   }
+   else
+   {
+      signatureTable = get_signature_table(block_index);
+      if(!signatureTable)
+         return -1;
+   }
+
+   CryptEngineWorkCtx work_ctx;
+   if(init_crypt_ctx(&work_ctx, block, *signatureTable, sector_base, sector_offset, nSectors, tail_size, m_readBuffer.data()) < 0)
+      return -1;
+
+   m_kernel(m_cryptops, m_iF00D, &work_ctx);
+
+   if(work_ctx.error < 0)
+   {
+      m_output << "Crypto Engine failed" << std::endl;
+      return -1;
+   }
+
+   return 0;
+}
+
+//copies part of decrypted data that starts at dataOffset in the file to the output that starts at offset
+//returns number of copied bytes
+std::uint32_t PfsFile::copy_sectors(std::uint64_t dataOffset, const unsigned char* data, std::size_t dataSize, std::uint64_t offset, std::uint32_t size, unsigned char* out) const
+{
+   std::uint64_t copyBegin = offset - dataOffset;
+   if(copyBegin >= dataSize)
+      return 0;
+
+   std::uint64_t copySize = dataSize - copyBegin;
+   if(copySize > size)
+      copySize = size;
+
+   memcpy(out, data + copyBegin, static_cast<std::size_t>(copySize));
+   return static_cast<std::uint32_t>(copySize);
+}
+
+void PfsFile::set_sector_cache(std::shared_ptr<PfsSectorCache> cache)
+{
+   std::lock_guard<std::mutex> guard(m_readMutex);
+   m_cache = cache;
+}
+
+void PfsFile::set_io_queue(std::shared_ptr<IPfsIoQueue> queue, PfsCacheModes mode)
+{
+   m_ioQueue = queue;
+   m_cacheMode = mode;
+}
+
+std::int64_t PfsFile::read(std::uint64_t offset, std::uint32_t size, unsigned char* out) const
+{
+   std::lock_guard<std::mutex> guard(m_readMutex);
+
+   std::uint64_t fileSize = this->size();
+   if(offset >= fileSize || size == 0)
+      return 0;
+
+   if(size > fileSize - offset)
+      size = static_cast<std::uint32_t>(fileSize - offset);
+
+   if(open_input() < 0)
+      return -1;
+
+   std::uint32_t sectorSize = m_table->get_header()->get_fileSectorSize();
+   std::uint32_t maxSectors = m_table->get_header()->get_binTreeNumMaxAvail();
+
+   std::uint64_t encryptedSize = m_filepath.file_size();
+
+   if(!img_spec_to_is_unicv(m_ngpfs.image_spec))
+   {
+      //icv file can only have single signature page (see decrypt_icv_file)
+      if(m_table->get_header()->get_numHashes() > maxSectors)
+      {
+         m_output << "Maximum number of hashes in icv file is exceeded" << std::endl;
+         return -1;
+      }
+   }
+
+   //map byte range to sectors and split sectors by signature blocks
+
+   std::uint64_t firstSector = offset / sectorSize;
+   std::uint64_t lastSector = (offset + size - 1) / sectorSize;
+
+   std::uint32_t nCopied = 0;
+
+   std::uint32_t icv_salt = m_table->get_icv_salt();
+
+   for(std::uint64_t sector = firstSector; sector <= lastSector; )
+   {
+      //take sector from the cache if it is there
+      if(m_cache)
+      {
+         PfsSectorCache::sector_t cached = m_cache->find(icv_salt, static_cast<std::uint32_t>(sector));
+         if(cached)
+         {
+            nCopied += copy_sectors(sector * sectorSize, cached->data(), cached->size(), offset + nCopied, size - nCopied, out + nCopied);
+            sector++;
+            continue;
+         }
+      }
+
+      std::uint32_t block_index = static_cast<std::uint32_t>(sector / maxSectors);
+      std::uint32_t sector_offset = static_cast<std::uint32_t>(sector % maxSectors);
+
+      std::uint64_t blockLastSector = static_cast<std::uint64_t>(block_index + 1) * maxSectors - 1;
+      std::uint64_t rangeLastSector = (lastSector < blockLastSector) ? lastSector : blockLastSector;
+
+      //process run of sectors that are not cached
+      if(m_cache)
+      {
+         for(std::uint64_t s = sector + 1; s <= rangeLastSector; s++)
+         {
+            if(m_cache->contains(icv_salt, static_cast<std::uint32_t>(s)))
+            {
+               rangeLastSector = s - 1;
+               break;
+            }
+         }
+      }
+
+      std::uint32_t nSectors = static_cast<std::uint32_t>(rangeLastSector - sector + 1);
+
+      if(read_sectors(block_index, sector_offset, nSectors, encryptedSize) < 0)
+         return -1;
+
+      //only verified sectors are cached
+      if(m_cache)
+      {
+         for(std::uint32_t i = 0; i < nSectors; i++)
+         {
+            std::size_t sectorBegin = static_cast<std::size_t>(i) * sectorSize;
+            std::size_t sectorEnd = std::min(sectorBegin + sectorSize, m_readBuffer.size());
+            m_cache->insert(icv_salt, static_cast<std::uint32_t>(sector + i), m_readBuffer.data() + sectorBegin, static_cast<std::uint32_t>(sectorEnd - sectorBegin));
+         }
+      }
+
+      nCopied += copy_sectors(sector * sectorSize, m_readBuffer.data(), m_readBuffer.size(), offset + nCopied, size - nCopied, out + nCopied);
+
+      sector = rangeLastSector + 1;
+   }
+
+   return nCopied;
+}
+
+bool PfsFile::has_icv() const
+{
+   return pfs_has_icv(m_file.file.m_info.get_original_type(), img_spec_to_crypto_engine_flag(m_ngpfs.image_spec));
+}
+
+int PfsFile::verify_file() const
+{
+   std::lock_guard<std::mutex> guard(m_readMutex);
+
+   if(open_input() < 0)
+      return -1;
+
+   std::uint32_t sectorSize = m_table->get_header()->get_fileSectorSize();
+   std::uint32_t maxSectors = m_table->get_header()->get_binTreeNumMaxAvail();
+
+   std::uint64_t encryptedSize = m_filepath.file_size();
+   std::uint64_t totalSectors = (encryptedSize + sectorSize - 1) / sectorSize;
+
+   if(!img_spec_to_is_unicv(m_ngpfs.image_spec))
+   {
+      //icv file can only have single signature page (see decrypt_icv_file)
+      if(m_table->get_header()->get_numHashes() > maxSectors)
+      {
+         m_output << "Maximum number of hashes in icv file is exceeded" << std::endl;
+         return -1;
+      }
+   }
+
+   //whole signature blocks are verified without decryption
+
+   m_verifyOnly = true;
+
+   int res = 0;
+   for(std::uint64_t sector = 0; sector < totalSectors; sector += maxSectors)
+   {
+      std::uint64_t nSectors = totalSectors - sector;
+      if(nSectors > maxSectors)
+         nSectors = maxSectors;
+
+      res = read_sectors(static_cast<std::uint32_t>(sector / maxSectors), 0, static_cast<std::uint32_t>(nSectors), encryptedSize);
+      if(res < 0)
+         break;
+   }
+
+   m_verifyOnly = false;
+
+   return res;
+}
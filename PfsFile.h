@@ -1,9 +1,14 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
+#include <fstream>
+#include <map>
+#include <vector>
 
 #include "IF00DKeyEncryptor.h"
 #include "ICryptoOperations.h"
+#include "PfsKeyRing.h"
 
 #include "Utils.h"
 
@@ -11,12 +16,16 @@
 #include "UnicvDbParser.h"
 
 #include "PfsCryptEngine.h"
+#include "PfsSectorCache.h"
+#include "IPfsIoQueue.h"
+#include "PfsCacheControl.h"
 
 class PfsFile
 {
 private:
    std::shared_ptr<ICryptoOperations> m_cryptops;
    std::shared_ptr<IF00DKeyEncryptor> m_iF00D;
+   std::shared_ptr<PfsKeyRing> m_keyRing;
    std::ostream& m_output;
    unsigned char m_klicensee[0x10];
    const psvpfs::path& m_titleIdPath;
@@ -30,20 +39,77 @@ private:
 private:
    mutable CryptEngineData m_data;
    mutable CryptEngineSubctx m_sub_ctx;
-   mutable std::vector<std::uint8_t> m_signatureTable;
+   mutable std::vector<std::uint8_t> m_signatureTable; //table of the block that is being decrypted sequentially
+   mutable std::map<std::uint32_t, std::vector<std::uint8_t> > m_signatureTables; //tables of blocks used by random access reads. guarded by m_readMutex
+   mutable pfs_crypt_kernel_t m_kernel;
+   mutable bool m_verifyOnly; //selects kernels that verify sectors without decryption
+
+private:
+   mutable std::mutex m_readMutex; //random access reads share crypt context and buffers
+   mutable std::ifstream m_inputStream;
+   mutable std::vector<std::uint8_t> m_readBuffer;
+   std::shared_ptr<PfsSectorCache> m_cache; //optional cache of decrypted sectors for random access reads
+
+private:
+   std::shared_ptr<IPfsIoQueue> m_ioQueue; //optional queue for sequential reads of decrypt_file
+   PfsCacheModes m_cacheMode;
 
 public:
-   PfsFile(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, std::ostream& output,
+   PfsFile(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, std::shared_ptr<PfsKeyRing> keyRing, std::ostream& output,
            const unsigned char* klicensee, const psvpfs::path& titleIdPath,
            const sce_ng_pfs_file_t& file, const sce_junction& filepath, const sce_ng_pfs_header_t& ngpfs, std::shared_ptr<sce_iftbl_base_t> table);
 
 private:
-   int init_crypt_ctx(CryptEngineWorkCtx* work_ctx, sig_tbl_t& block, std::uint32_t sector_base, std::uint32_t tail_size, unsigned char* source) const;
+   int init_crypt_ctx(CryptEngineWorkCtx* work_ctx, const sig_tbl_t& block, std::uint32_t sector_base, std::uint32_t tail_size, unsigned char* source) const;
+
+   //initializes context for nSectors sectors of the block starting from sector_offset
+   //signatureTable is the table of the whole block
+   int init_crypt_ctx(CryptEngineWorkCtx* work_ctx, const sig_tbl_t& block, std::vector<std::uint8_t>& signatureTable, std::uint32_t sector_base, std::uint32_t sector_offset, std::uint32_t nSectors, std::uint32_t tail_size, unsigned char* source) const;
+
+   //copies signatures of the block in order of sectors. icv.db keeps them in merkle tree order
+   int build_signature_table(const sig_tbl_t& block, std::vector<std::uint8_t>& table) const;
+
+   //cached table of the block. m_readMutex has to be held. returns null on error
+   std::vector<std::uint8_t>* get_signature_table(std::uint32_t block_index) const;
+
+   int open_input() const;
+
+   //reads, verifies and decrypts sectors of single signature block into m_readBuffer
+   int read_sectors(std::uint32_t block_index, std::uint32_t sector_offset, std::uint32_t nSectors, std::uint64_t encryptedSize) const;
 
-   int decrypt_icv_file(const psvpfs::path& destination_root) const;
+   std::uint32_t copy_sectors(std::uint64_t dataOffset, const unsigned char* data, std::size_t dataSize, std::uint64_t offset, std::uint32_t size, unsigned char* out) const;
 
-   int decrypt_unicv_file(const psvpfs::path& destination_root) const;
+   int decrypt_icv_file(std::ostream& outputStream) const;
+
+   int decrypt_unicv_file(std::ostream& outputStream) const;
 
 public:
-   int decrypt_file(const psvpfs::path& destination_root) const;
+   //suffix is appended to name of the output file
+   int decrypt_file(const psvpfs::path& destination_root, const std::string& suffix = std::string()) const;
+
+   //writes decrypted data to the stream. exactly size() bytes are written
+   int decrypt_file(std::ostream& outputStream) const;
+
+public:
+   //cache can be shared between files of the same title
+   void set_sector_cache(std::shared_ptr<PfsSectorCache> cache);
+
+   //queue is used for read ahead of encrypted data in decrypt_file
+   //files that are decrypted one after another by the same thread can share it
+   void set_io_queue(std::shared_ptr<IPfsIoQueue> queue, PfsCacheModes mode = PfsCacheModes::buffered);
+
+   //size of decrypted file
+   std::uint64_t size() const;
+
+   //random access read of decrypted data
+   //only sectors that cover requested range are read, verified and decrypted
+   //returns number of bytes copied to out (less than size at the end of file) or -1 on error
+   std::int64_t read(std::uint64_t offset, std::uint32_t size, unsigned char* out) const;
+
+   //verifies icv of every sector of the file without decryption and without writing anything
+   //for file without icv only signature blocks are read and nothing is checked
+   int verify_file() const;
+
+   //false if file has no sector icv that verify_file could check
+   bool has_icv() const;
 };
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "PfsFileReader.h"
+
+#include "PfsIoQueueFactory.h"
+
+#include <algorithm>
+
+PfsFileReader::PfsFileReader(std::shared_ptr<IPfsIoQueue> queue, PfsCacheModes mode)
+   : m_queue(queue), m_mode(mode), m_fd(-1), m_tailFd(-1), m_size(0), m_nextOffset(0), m_current(-1), m_nInFlight(0), m_failed(false)
+{
+   if(!m_queue)
+      m_queue = PfsIoQueueFactory::create(PfsIoQueueTypes::sync, 1, PFS_READER_BUFFER_SIZE);
+
+   m_complete.assign(m_queue->depth(), false);
+   m_results.assign(m_queue->depth(), 0);
+   m_offsets.assign(m_queue->depth(), 0);
+}
+
+PfsFileReader::~PfsFileReader()
+{
+   close();
+}
+
+int PfsFileReader::open(const psvpfs::path& filepath)
+{
+   close();
+
+   std::error_code ec;
+   m_size = psvpfs::file_size(filepath, ec);
+   if(ec)
+      return -1;
+
+   //direct io needs aligned buffers of aligned size
+   if(m_mode == PfsCacheModes::direct && m_queue->buffer_size() % PFS_IO_BUFFER_ALIGNMENT == 0)
+   {
+      m_fd = pfs_open_input(filepath, true);
+      if(m_fd >= 0)
+      {
+         m_tailFd = pfs_open_input(filepath);
+         if(m_tailFd < 0)
+         {
+            pfs_close(m_fd);
+            m_fd = -1;
+            return -1;
+         }
+      }
+   }
+
+   //filesystem may not support direct io. then pages are dropped after use
+   if(m_fd < 0)
+      m_fd = pfs_open_input(filepath);
+   if(m_fd < 0)
+      return -1;
+
+   if(m_mode != PfsCacheModes::buffered)
+      pfs_advise_sequential(m_tailFd >= 0 ? m_tailFd : m_fd);
+
+   m_nextOffset = 0;
+   m_current = -1;
+   m_failed = false;
+
+   //whole pool is filled at once
+   for(std::uint32_t i = 0; i < m_queue->depth() && m_nextOffset < m_size; i++)
+   {
+      if(queue_read(i) < 0)
+         return -1;
+   }
+
+   if(m_queue->submit() < 0)
+   {
+      m_failed = true;
+      return -1;
+   }
+
+   return 0;
+}
+
+void PfsFileReader::close()
+{
+   if(m_fd < 0)
+      return;
+
+   //buffers can not be reused while kernel writes to them
+   while(m_nInFlight > 0)
+   {
+      std::uint32_t index;
+      std::int64_t result;
+      if(m_queue->wait(index, result) < 0)
+         break;
+      m_nInFlight--;
+   }
+
+   m_nInFlight = 0;
+   m_order.clear();
+   m_current = -1;
+
+   if(m_mode != PfsCacheModes::buffered)
+      pfs_drop_cache(m_tailFd >= 0 ? m_tailFd : m_fd, 0, 0);
+
+   if(m_tailFd >= 0)
+      pfs_close(m_tailFd);
+   m_tailFd = -1;
+
+   pfs_close(m_fd);
+   m_fd = -1;
+
+   setg(0, 0, 0);
+}
+
+int PfsFileReader::queue_read(std::uint32_t index)
+{
+   std::size_t size = static_cast<std::size_t>(std::min<std::uint64_t>(m_queue->buffer_size(), m_size - m_nextOffset));
+
+   //chunks are aligned since buffer size is. only last one can have unaligned size
+   int fd = m_fd;
+   if(m_tailFd >= 0 && size % PFS_IO_BUFFER_ALIGNMENT != 0)
+      fd = m_tailFd;
+
+   if(m_queue->prep_read(fd, index, m_nextOffset, size) < 0)
+   {
+      m_failed = true;
+      return -1;
+   }
+
+   m_order.push_back(index);
+   m_complete[index] = false;
+   m_offsets[index] = m_nextOffset;
+   m_nextOffset += size;
+   m_nInFlight++;
+
+   return 0;
+}
+
+//reads complete in any order so completions of other buffers are remembered
+int PfsFileReader::wait_read(std::uint32_t index)
+{
+   while(!m_complete[index])
+   {
+      std::uint32_t completed;
+      std::int64_t result;
+      if(m_queue->wait(completed, result) < 0)
+      {
+         m_failed = true;
+         return -1;
+      }
+
+      m_complete[completed] = true;
+      m_results[completed] = result;
+      m_nInFlight--;
+   }
+
+   return 0;
+}
+
+PfsFileReader::int_type PfsFileReader::underflow()
+{
+   if(gptr() < egptr())
+      return traits_type::to_int_type(*gptr());
+
+   if(m_fd < 0 || m_failed)
+      return traits_type::eof();
+
+   //consumed buffer reads next chunk
+   if(m_current >= 0)
+   {
+      std::uint32_t consumed = static_cast<std::uint32_t>(m_current);
+      m_current = -1;
+
+      //pages of consumed chunk are not needed anymore. direct reads do not use page cache
+      if(m_mode != PfsCacheModes::buffered && m_tailFd < 0)
+         pfs_drop_cache(m_fd, m_offsets[consumed], m_queue->buffer_size());
+
+      if(m_nextOffset < m_size)
+      {
+         if(queue_read(consumed) < 0 || m_queue->submit() < 0)
+         {
+            m_failed = true;
+            return traits_type::eof();
+         }
+      }
+   }
+
+   if(m_order.empty())
+      return traits_type::eof();
+
+   std::uint32_t index = m_order.front();
+   m_order.pop_front();
+
+   if(wait_read(index) < 0)
+      return traits_type::eof();
+
+   std::int64_t result = m_results[index];
+   if(result < 0)
+      m_failed = true;
+   if(result <= 0)
+      return traits_type::eof();
+
+   m_current = index;
+
+   char* data = reinterpret_cast<char*>(m_queue->buffer(index));
+   setg(data, data, data + result);
+
+   return traits_type::to_int_type(*gptr());
+}
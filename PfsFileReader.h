@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <streambuf>
+
+#include "LocalFilesystem.h"
+#include "IPfsIoQueue.h"
+#include "PfsCacheControl.h"
+
+//size of read buffer when reader has no queue of its own
+#define PFS_READER_BUFFER_SIZE 0x10000
+
+//sequential reader of single input file
+//reads ahead with every buffer of the queue so that next chunks are read while current one is decrypted
+//queue can be shared by readers that are used one after another
+//in direct mode every chunk but the last one is read with direct io at aligned offset
+//last chunk of unaligned size is read through page cache with second descriptor
+class PfsFileReader : public std::streambuf
+{
+private:
+   std::shared_ptr<IPfsIoQueue> m_queue;
+   PfsCacheModes m_mode;
+   int m_fd;
+   int m_tailFd; //buffered descriptor for unaligned tail in direct mode. -1 otherwise
+   std::uint64_t m_size;
+   std::uint64_t m_nextOffset; //offset of next read that is queued
+   std::deque<std::uint32_t> m_order; //buffers with queued reads in file order
+   std::vector<bool> m_complete;
+   std::vector<std::int64_t> m_results;
+   std::vector<std::uint64_t> m_offsets; //offset of chunk of every buffer
+   std::int64_t m_current; //buffer that is being consumed or -1
+   std::uint32_t m_nInFlight;
+   bool m_failed;
+
+public:
+   PfsFileReader(std::shared_ptr<IPfsIoQueue> queue = std::shared_ptr<IPfsIoQueue>(), PfsCacheModes mode = PfsCacheModes::buffered);
+
+   PfsFileReader(const PfsFileReader&) = delete;
+
+   PfsFileReader& operator=(const PfsFileReader&) = delete;
+
+   ~PfsFileReader();
+
+public:
+   int open(const psvpfs::path& filepath);
+
+   //waits for reads that are still in flight and closes the file
+   void close();
+
+   bool is_open() const
+   {
+      return m_fd >= 0;
+   }
+
+   bool failed() const
+   {
+      return m_failed;
+   }
+
+private:
+   int queue_read(std::uint32_t index);
+
+   int wait_read(std::uint32_t index);
+
+protected:
+   int_type underflow() override;
+};
@@ -1,20 +1,56 @@
 #include "PfsFilesystem.h"
 
 #include "PfsFile.h"
+#include "PfsExtractManifest.h"
+#include "PfsShard.h"
+#include "PfsDestinationWriter.h"
+#include "PfsFileReader.h"
+#include "WorkerPool.h"
+#include "CryptoOperationsFactory.h"
 
 #include <cstring>
+#include <atomic>
+#include <sstream>
 
 PfsFilesystem::PfsFilesystem(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, std::ostream& output,
-                 const unsigned char* klicensee, const psvpfs::path& titleIdPath)
-   : m_cryptops(cryptops), m_iF00D(iF00D), m_output(output), m_titleIdPath(titleIdPath)
+                 const unsigned char* klicensee, const psvpfs::path& titleIdPath, bool lazy)
+   : m_cryptops(cryptops), m_iF00D(iF00D), m_output(output), m_titleIdPath(titleIdPath), m_shardIndex(0), m_shardCount(1), m_ioType(PfsIoQueueTypes::sync), m_cacheMode(PfsCacheModes::buffered), m_verifyOutputs(false)
 {
    memcpy(m_klicensee, klicensee, 0x10);
 
+   m_keyRing = std::make_shared<PfsKeyRing>(cryptops, iF00D, klicensee);
+
    m_filesDbParser = std::unique_ptr<FilesDbParser>(new FilesDbParser(cryptops, iF00D, output, klicensee, titleIdPath));
 
-   m_unicvDbParser = std::unique_ptr<UnicvDbParser>(new UnicvDbParser(titleIdPath, output));
+   m_unicvDbParser = std::unique_ptr<UnicvDbParser>(new UnicvDbParser(titleIdPath, output, lazy));
+
+   m_pageMapper = std::unique_ptr<PfsPageMapper>(new PfsPageMapper(cryptops, iF00D, m_keyRing, output, klicensee, titleIdPath));
+}
 
-   m_pageMapper = std::unique_ptr<PfsPageMapper>(new PfsPageMapper(cryptops, iF00D, output, klicensee, titleIdPath));
+void PfsFilesystem::set_path_filter(std::shared_ptr<PfsPathFilter> filter)
+{
+   m_filter = filter;
+}
+
+void PfsFilesystem::set_shard(std::uint32_t index, std::uint32_t count)
+{
+   m_shardIndex = index;
+   m_shardCount = count;
+}
+
+void PfsFilesystem::set_io_queue_type(PfsIoQueueTypes type)
+{
+   m_ioType = type;
+}
+
+void PfsFilesystem::set_cache_mode(PfsCacheModes mode)
+{
+   m_cacheMode = mode;
+}
+
+void PfsFilesystem::set_verify_outputs(bool verify)
+{
+   m_verifyOutputs = verify;
 }
 
 int PfsFilesystem::mount()
@@ -25,7 +61,7 @@ int PfsFilesystem::mount()
    if(m_unicvDbParser->parse() < 0)
       return -1;
 
-   if(m_pageMapper->bruteforce_map(m_filesDbParser, m_unicvDbParser) < 0)
+   if(m_pageMapper->bruteforce_map(m_filesDbParser, m_unicvDbParser, m_filter) < 0)
       return -1;
 
    return 0;
@@ -35,15 +71,120 @@ static void to_uppercase(std::string &str) {
    std::transform(str.begin(), str.end(), str.begin(), static_cast<int (*)(int)>(std::toupper));
 }
 
-int PfsFilesystem::decrypt_files(const psvpfs::path& destTitleIdPath) const
+int PfsFilesystem::get_mapped_files(std::vector<pfs_mapped_file_t>& items) const
 {
-   const sce_ng_pfs_header_t& ngpfs = m_filesDbParser->get_header();
    const std::vector<sce_ng_pfs_file_t>& files = m_filesDbParser->get_files();
-   const std::vector<sce_ng_pfs_dir_t>& dirs = m_filesDbParser->get_dirs();
 
    const std::unique_ptr<sce_idb_base_t>& unicv = m_unicvDbParser->get_idatabase();
 
    const std::map<std::uint32_t, sce_junction>& pageMap = m_pageMapper->get_pageMap();
+
+   std::map<std::string, const sce_ng_pfs_file_t *> file_map;
+   for (const auto &file : files) {
+      std::string path = file.path().get_value().string();
+      to_uppercase(path);
+
+      file_map[path] = &file;
+   }
+
+   for(auto& t : unicv->m_tables)
+   {
+      //skip empty files and directories
+      if(t->get_header()->get_numSectors() == 0)
+         continue;
+
+      //find filepath by salt (filename for icv.db or page for unicv.db)
+      auto map_entry = pageMap.find(t->get_icv_salt());
+      if(map_entry == pageMap.end())
+      {
+         //tables of files that are filtered out are not mapped
+         if(is_filtered())
+            continue;
+
+         m_output << "failed to find page " << t->get_icv_salt() << " in map" << std::endl;
+         return -1;
+      }
+
+      //find file in files.db by filepath
+      const sce_junction& filepath = map_entry->second;
+      std::string path = filepath.get_value().string();
+      to_uppercase(path);
+      auto file_ptr = file_map.find(path);
+      if (file_ptr == file_map.end())
+      {
+         m_output << "failed to find file " << filepath << " in flat file list" << std::endl;
+         return -1;
+      }
+
+      pfs_mapped_file_t item;
+      item.table = t;
+      item.filepath = &filepath;
+      item.file = file_ptr->second;
+      items.push_back(item);
+   }
+
+   return 0;
+}
+
+void PfsFilesystem::select_shard(std::vector<pfs_mapped_file_t>& items) const
+{
+   if(!is_sharded())
+      return;
+
+   //salt is unique within the title so it is used as stable key
+   std::vector<pfs_shard_item_t> shardItems;
+   for(auto& i : items)
+   {
+      pfs_shard_item_t si;
+      si.key = i.table->get_icv_salt();
+      si.size = i.file->file.m_info.header.size;
+      shardItems.push_back(si);
+   }
+
+   std::vector<std::uint32_t> shards = assign_shards(shardItems, m_shardCount);
+
+   std::vector<pfs_mapped_file_t> selected;
+   for(std::size_t i = 0; i < items.size(); i++)
+   {
+      if(shards[i] == m_shardIndex)
+         selected.push_back(items[i]);
+   }
+
+   items.swap(selected);
+}
+
+std::string PfsFilesystem::get_relative_path(const sce_junction& junction) const
+{
+   std::string value = junction.get_value().generic_string();
+   std::string root = m_titleIdPath.generic_string();
+
+   std::string upperValue = value.substr(0, root.size());
+   to_uppercase(upperValue);
+   to_uppercase(root);
+
+   if(upperValue == root)
+      value = value.substr(root.size());
+
+   while(value.size() > 0 && value.front() == '/')
+      value.erase(value.begin());
+
+   return value;
+}
+
+std::string PfsFilesystem::get_manifest_name(std::uint32_t index, std::uint32_t count)
+{
+   if(count <= 1)
+      return PFS_EXTRACT_MANIFEST_NAME;
+
+   return std::string(PFS_EXTRACT_MANIFEST_NAME) + "." + std::to_string(index) + "of" + std::to_string(count);
+}
+
+int PfsFilesystem::decrypt_files(const psvpfs::path& destTitleIdPath) const
+{
+   const sce_ng_pfs_header_t& ngpfs = m_filesDbParser->get_header();
+   const std::vector<sce_ng_pfs_file_t>& files = m_filesDbParser->get_files();
+   const std::vector<sce_ng_pfs_dir_t>& dirs = m_filesDbParser->get_dirs();
+
    const std::set<sce_junction>& emptyFiles = m_pageMapper->get_emptyFiles();
 
    std::map<std::string, const sce_ng_pfs_file_t *> file_map;
@@ -54,11 +195,21 @@ int PfsFilesystem::decrypt_files(const psvpfs::path& destTitleIdPath) const
       file_map[path] = &file;
    }
 
+   //remembers created directories and writes files in big preallocated chunks
+   //input and output have their own queues so that reads of next sectors and writes of decrypted ones overlap
+   PfsDestinationWriter writer(m_output, m_cacheMode);
+   PfsFileWriter fileWriter(PfsIoQueueFactory::create(m_ioType), m_cacheMode);
+   std::shared_ptr<IPfsIoQueue> readQueue = PfsIoQueueFactory::create(m_ioType);
+
    m_output << "Creating directories..." << std::endl;
 
    for(auto& d : dirs)
    {
-      if(!d.path().create_empty_directory(m_titleIdPath, destTitleIdPath))
+      //directories of selected files are created together with files
+      if(is_filtered() && !m_filter->match(m_titleIdPath, d.path().get_value()))
+         continue;
+
+      if(writer.create_directories(d.path().get_dest_path(m_titleIdPath, destTitleIdPath)) < 0)
       {
          m_output << "Failed to create: " << d.path() << std::endl;
          return -1;
@@ -69,58 +220,70 @@ int PfsFilesystem::decrypt_files(const psvpfs::path& destTitleIdPath) const
       }
    }
 
-   m_output << "Creating empty files..." << std::endl;
-
-   for(auto& f : emptyFiles)
+   //empty files belong to first shard
+   if(m_shardIndex == 0)
    {
-      std::string path = f.get_value().string();
-      to_uppercase(path);
-      auto file = file_map.find(path);
-      if (file == file_map.end())
-      {
-         m_output << "Ignored: " << f << std::endl;
-      }
-      else
+      m_output << "Creating empty files..." << std::endl;
+
+      for(auto& f : emptyFiles)
       {
-         if(!f.create_empty_file(m_titleIdPath, destTitleIdPath))
+         std::string path = f.get_value().string();
+         to_uppercase(path);
+         auto file = file_map.find(path);
+         if (file == file_map.end())
          {
-            m_output << "Failed to create: " << f << std::endl;
-            return -1;
+            m_output << "Ignored: " << f << std::endl;
          }
          else
          {
-            m_output << "Created: " << f << std::endl;
+            if(writer.open_file(f.get_dest_path(m_titleIdPath, destTitleIdPath), 0, fileWriter) < 0 || fileWriter.close() < 0)
+            {
+               m_output << "Failed to create: " << f << std::endl;
+               return -1;
+            }
+            else
+            {
+               m_output << "Created: " << f << std::endl;
+            }
          }
       }
    }
 
+   std::vector<pfs_mapped_file_t> items;
+   if(get_mapped_files(items) < 0)
+      return -1;
+
+   select_shard(items);
+
+   //files that were completed by previous run are skipped
+   //every shard has its own manifest since shards may run at the same time
+   PfsExtractManifest manifest(m_cryptops, m_output, destTitleIdPath, get_manifest_name(m_shardIndex, m_shardCount));
+   manifest.set_verify(m_verifyOutputs);
+   if(manifest.open() < 0)
+      return -1;
+
+   //digest of decrypted file is computed while it is written
+   std::shared_ptr<PfsChunkDigest> digest = std::make_shared<PfsChunkDigest>(m_cryptops);
+
    m_output << "Decrypting files..." << std::endl;
 
-   for(auto& t : unicv->m_tables)
+   for(auto& item : items)
    {
-      //skip empty files and directories
-      if(t->get_header()->get_numSectors() == 0)
-         continue;
+      std::shared_ptr<sce_iftbl_base_t> t = item.table;
+      const sce_junction& filepath = *item.filepath;
+      const sce_ng_pfs_file_t* file = item.file;
 
-      //find filepath by salt (filename for icv.db or page for unicv.db)
-      auto map_entry = pageMap.find(t->get_icv_salt());
-      if(map_entry == pageMap.end())
-      {
-         m_output << "failed to find page " << t->get_icv_salt() << " in map" << std::endl;
-         return -1;
-      }
+      psvpfs::path outputPath = filepath.get_dest_path(m_titleIdPath, destTitleIdPath);
+      psvpfs::path partialPath = outputPath;
+      partialPath += PFS_EXTRACT_PARTIAL_SUFFIX;
 
-      //find file in files.db by filepath
-      sce_junction filepath = map_entry->second;
-      std::string path = filepath.get_value().string();
-      to_uppercase(path);
-      auto file_ptr = file_map.find(path);
-      if (file_ptr == file_map.end())
+      if(manifest.is_complete(outputPath, t->get_icv_salt()))
       {
-         m_output << "failed to find file " << filepath << " in flat file list" << std::endl;
-         return -1;
+         m_output << "Skipped: " << filepath << std::endl;
+         continue;
       }
-      auto &file = file_ptr->second;
+
+      std::string outputDigest;
 
       //directory and unexisting file are unexpected
       if(is_directory(file->file.m_info.header.type) || is_unexisting(file->file.m_info.header.type))
@@ -129,26 +292,46 @@ int PfsFilesystem::decrypt_files(const psvpfs::path& destTitleIdPath) const
          return -1;
       }
       //copy unencrypted files
+      //data of the copy may not pass through this process at all so digest is computed from the source
       else if(is_unencrypted(file->file.m_info.header.type))
       {
-         if(!filepath.copy_existing_file(m_titleIdPath, destTitleIdPath, file->file.m_info.header.size))
+         if(writer.copy_file(filepath.get_real(), partialPath, file->file.m_info.header.size) < 0 ||
+            manifest.digest(filepath.get_real(), file->file.m_info.header.size, outputDigest) < 0)
          {
             m_output << "Failed to copy: " << filepath << std::endl;
             return -1;
          }
          else
          {
+            //digest maps the source
+            if(m_cacheMode != PfsCacheModes::buffered)
+               pfs_drop_cache(filepath.get_real());
+
             m_output << "Copied: " << filepath << std::endl;
          }
       }
       //decrypt encrypted files
       else if(is_encrypted(file->file.m_info.header.type))
       {
-         PfsFile pfsFile(m_cryptops, m_iF00D, m_output, m_klicensee, m_titleIdPath, *file, filepath, ngpfs, t);
+         PfsFile pfsFile(m_cryptops, m_iF00D, m_keyRing, m_output, m_klicensee, m_titleIdPath, *file, filepath, ngpfs, t);
+         pfsFile.set_io_queue(readQueue, m_cacheMode);
 
-         if(pfsFile.decrypt_file(destTitleIdPath) < 0)
+         std::ostream outputStream(&fileWriter);
+
+         fileWriter.set_digest(digest);
+
+         bool decrypted = writer.open_file(partialPath, pfsFile.size(), fileWriter) >= 0 && pfsFile.decrypt_file(outputStream) >= 0;
+         bool closed = fileWriter.close() >= 0;
+
+         fileWriter.set_digest(std::shared_ptr<PfsChunkDigest>());
+         outputDigest = digest->finish();
+
+         if(!closed || !decrypted)
          {
             m_output << "Failed to decrypt: " << filepath << std::endl;
+
+            std::error_code ec;
+            psvpfs::remove(partialPath, ec);
             return -1;
          }
          else
@@ -161,7 +344,387 @@ int PfsFilesystem::decrypt_files(const psvpfs::path& destTitleIdPath) const
          m_output << "Unexpected file type" << std::endl;
          return -1;
       }
+
+      //output gets its final name only when it is complete
+      std::error_code ec;
+      psvpfs::rename(partialPath, outputPath, ec);
+      if(ec)
+      {
+         m_output << "Failed to rename: " << partialPath.generic_string() << " to " << outputPath.generic_string() << std::endl;
+         return -1;
+      }
+
+      if(manifest.commit(outputPath, t->get_icv_salt(), outputDigest) < 0)
+         return -1;
    }
 
    return 0;
-}
\ No newline at end of file
+}
+
+int PfsFilesystem::extract_files(std::shared_ptr<IPfsOutputSink> sink) const
+{
+   const sce_ng_pfs_header_t& ngpfs = m_filesDbParser->get_header();
+   const std::vector<sce_ng_pfs_file_t>& files = m_filesDbParser->get_files();
+   const std::vector<sce_ng_pfs_dir_t>& dirs = m_filesDbParser->get_dirs();
+
+   std::vector<pfs_mapped_file_t> items;
+   if(get_mapped_files(items) < 0)
+      return -1;
+
+   std::vector<pfs_mapped_file_t> selected = items;
+   select_shard(selected);
+
+   //files of other shards are mapped but not selected
+   std::map<std::string, const pfs_mapped_file_t*> mapped;
+   for(auto& i : items)
+   {
+      std::string path = i.filepath->get_value().string();
+      to_uppercase(path);
+      mapped[path] = 0;
+   }
+
+   for(auto& i : selected)
+   {
+      std::string path = i.filepath->get_value().string();
+      to_uppercase(path);
+      mapped[path] = &i;
+   }
+
+   m_output << "Creating directories..." << std::endl;
+
+   for(auto& d : dirs)
+   {
+      if(is_filtered() && !m_filter->match(m_titleIdPath, d.path().get_value()))
+         continue;
+
+      if(sink->create_directory(get_relative_path(d.path())) < 0)
+      {
+         m_output << "Failed to create: " << d.path() << std::endl;
+         return -1;
+      }
+   }
+
+   m_output << "Writing files..." << std::endl;
+
+   std::vector<char> buffer;
+   std::shared_ptr<IPfsIoQueue> readQueue = PfsIoQueueFactory::create(m_ioType);
+
+   for(auto& f : files)
+   {
+      if(is_directory(f.file.m_info.header.type) || is_unexisting(f.file.m_info.header.type))
+         continue;
+
+      if(is_filtered() && !m_filter->match(m_titleIdPath, f.path().get_value()))
+         continue;
+
+      std::string path = f.path().get_value().string();
+      to_uppercase(path);
+
+      auto map_entry = mapped.find(path);
+      if(map_entry == mapped.end())
+      {
+         //empty files have no data and belong to first shard
+         if(f.file.m_info.header.size != 0)
+         {
+            m_output << "failed to find file " << f.path() << " in page map" << std::endl;
+            return -1;
+         }
+
+         if(m_shardIndex != 0)
+            continue;
+
+         if(!sink->begin_file(get_relative_path(f.path()), 0) || sink->end_file() < 0)
+         {
+            m_output << "Failed to create: " << f.path() << std::endl;
+            return -1;
+         }
+
+         m_output << "Created: " << f.path() << std::endl;
+         continue;
+      }
+
+      //file of another shard
+      if(!map_entry->second)
+         continue;
+
+      const pfs_mapped_file_t& item = *map_entry->second;
+      const sce_junction& filepath = *item.filepath;
+
+      if(is_unencrypted(f.file.m_info.header.type))
+      {
+         std::uint64_t size = f.file.m_info.header.size;
+
+         PfsFileReader reader(readQueue, m_cacheMode);
+         if(reader.open(filepath.get_real()) < 0)
+         {
+            m_output << "Failed to open " << filepath << std::endl;
+            return -1;
+         }
+
+         std::istream inputStream(&reader);
+
+         std::ostream* outputStream = sink->begin_file(get_relative_path(f.path()), size);
+         if(!outputStream)
+         {
+            m_output << "Failed to copy: " << filepath << std::endl;
+            return -1;
+         }
+
+         buffer.resize(0x100000);
+
+         for(std::uint64_t left = size; left > 0; )
+         {
+            std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(left, buffer.size()));
+
+            inputStream.read(buffer.data(), chunk);
+            if(static_cast<std::size_t>(inputStream.gcount()) != chunk)
+            {
+               m_output << "Failed to read " << filepath << std::endl;
+               return -1;
+            }
+
+            outputStream->write(buffer.data(), chunk);
+            left -= chunk;
+         }
+
+         if(!*outputStream || sink->end_file() < 0)
+         {
+            m_output << "Failed to copy: " << filepath << std::endl;
+            return -1;
+         }
+
+         m_output << "Copied: " << filepath << std::endl;
+      }
+      else if(is_encrypted(f.file.m_info.header.type))
+      {
+         PfsFile pfsFile(m_cryptops, m_iF00D, m_keyRing, m_output, m_klicensee, m_titleIdPath, f, filepath, ngpfs, item.table);
+         pfsFile.set_io_queue(readQueue, m_cacheMode);
+
+         std::ostream* outputStream = sink->begin_file(get_relative_path(f.path()), pfsFile.size());
+         if(!outputStream || pfsFile.decrypt_file(*outputStream) < 0 || sink->end_file() < 0)
+         {
+            m_output << "Failed to decrypt: " << filepath << std::endl;
+            return -1;
+         }
+
+         m_output << "Decrypted: " << filepath << std::endl;
+      }
+      else
+      {
+         m_output << "Unexpected file type" << std::endl;
+         return -1;
+      }
+   }
+
+   return sink->finish();
+}
+
+int PfsFilesystem::merge_shards(const psvpfs::path& destTitleIdPath, std::uint32_t count) const
+{
+   const std::vector<sce_ng_pfs_file_t>& files = m_filesDbParser->get_files();
+   const std::set<sce_junction>& emptyFiles = m_pageMapper->get_emptyFiles();
+
+   //all files regardless of shard
+   std::vector<pfs_mapped_file_t> items;
+   if(get_mapped_files(items) < 0)
+      return -1;
+
+   std::vector<std::unique_ptr<PfsExtractManifest> > shards;
+   for(std::uint32_t i = 0; i < count; i++)
+   {
+      std::unique_ptr<PfsExtractManifest> shard(new PfsExtractManifest(m_cryptops, m_output, destTitleIdPath, get_manifest_name(i, count)));
+      shard->set_verify(true);
+      if(shard->load() < 0)
+         return -1;
+      shards.push_back(std::move(shard));
+   }
+
+   PfsExtractManifest manifest(m_cryptops, m_output, destTitleIdPath);
+   manifest.set_verify(m_verifyOutputs);
+   if(manifest.open() < 0)
+      return -1;
+
+   m_output << "Merging shards..." << std::endl;
+
+   int nMissing = 0;
+   std::size_t nFiles = items.size();
+
+   for(auto& item : items)
+   {
+      const sce_junction& filepath = *item.filepath;
+      std::uint32_t icv_salt = item.table->get_icv_salt();
+
+      psvpfs::path outputPath = filepath.get_dest_path(m_titleIdPath, destTitleIdPath);
+
+      //merged by previous run
+      if(manifest.is_complete(outputPath, icv_salt))
+         continue;
+
+      //output is checked against digest written by the shard
+      bool found = false;
+      for(auto& shard : shards)
+      {
+         if(shard->is_complete(outputPath, icv_salt))
+         {
+            if(manifest.append(*shard->find(outputPath)) < 0)
+               return -1;
+
+            found = true;
+            break;
+         }
+      }
+
+      if(!found)
+      {
+         m_output << "Missing: " << filepath << std::endl;
+         nMissing++;
+      }
+   }
+
+   std::set<std::string> file_set;
+   for (const auto &file : files) {
+      std::string path = file.path().get_value().string();
+      to_uppercase(path);
+
+      file_set.insert(path);
+   }
+
+   for(auto& f : emptyFiles)
+   {
+      std::string path = f.get_value().string();
+      to_uppercase(path);
+      if(file_set.find(path) == file_set.end())
+         continue;
+
+      nFiles++;
+
+      if(!psvpfs::is_regular_file(f.get_dest_path(m_titleIdPath, destTitleIdPath)))
+      {
+         m_output << "Missing: " << f << std::endl;
+         nMissing++;
+      }
+   }
+
+   if(nMissing > 0)
+   {
+      m_output << "Shards do not cover " << nMissing << " files" << std::endl;
+      return -1;
+   }
+
+   m_output << "All " << nFiles << " files are present" << std::endl;
+
+   return 0;
+}
+
+int PfsFilesystem::verify_files(std::vector<pfs_verify_result_t>& report, std::size_t nThreads) const
+{
+   const sce_ng_pfs_header_t& ngpfs = m_filesDbParser->get_header();
+
+   //collect files that have data - same as in decrypt_files
+
+   std::vector<pfs_mapped_file_t> items;
+   if(get_mapped_files(items) < 0)
+      return -1;
+
+   report.assign(items.size(), pfs_verify_result_t());
+
+   //one lane per thread takes next file from shared counter so that big files do not stall the others
+   //each lane has its own crypto operations since they keep internal contexts
+   if(nThreads == 0)
+      nThreads = WorkerPool::default_concurrency();
+
+   //generic kernel that is used with cmac also decrypts and uses F00D which is not thread safe
+   if(img_spec_to_crypto_engine_flag(ngpfs.image_spec) & CRYPTO_ENGINE_CRYPTO_USE_CMAC)
+      nThreads = 1;
+
+   if(nThreads > items.size())
+      nThreads = items.size();
+
+   std::atomic<std::size_t> next(0);
+
+   auto lane = [&](std::size_t)
+   {
+      std::shared_ptr<ICryptoOperations> cryptops = CryptoOperationsFactory::create(CryptoOperationsTypes::openssl);
+
+      for(std::size_t i = next.fetch_add(1); i < items.size(); i = next.fetch_add(1))
+      {
+         std::shared_ptr<sce_iftbl_base_t> t = items[i].table;
+         const sce_junction& filepath = *items[i].filepath;
+         const sce_ng_pfs_file_t& file = *items[i].file;
+
+         pfs_verify_result_t& result = report[i];
+         result.path = filepath.get_value().generic_string();
+         result.icv_salt = t->get_icv_salt();
+         result.size = file.file.m_info.header.size;
+         result.verified = false;
+         result.ok = false;
+
+         std::ostringstream output;
+
+         if(is_directory(file.file.m_info.header.type) || is_unexisting(file.file.m_info.header.type))
+         {
+            result.error = "Unexpected file type";
+         }
+         //unencrypted files are copied as is by decrypt_files
+         else if(is_unencrypted(file.file.m_info.header.type))
+         {
+            result.ok = true;
+         }
+         else if(is_encrypted(file.file.m_info.header.type))
+         {
+            try
+            {
+               PfsFile pfsFile(cryptops, m_iF00D, m_keyRing, output, m_klicensee, m_titleIdPath, file, filepath, ngpfs, t);
+
+               //sectors of file without icv are still read so that missing or short data is reported
+               result.verified = pfsFile.has_icv();
+               result.ok = pfsFile.verify_file() >= 0;
+            }
+            catch(std::exception& e)
+            {
+               output << e.what() << std::endl;
+            }
+
+            result.error = output.str();
+            while(!result.error.empty() && result.error.back() == '\n')
+               result.error.pop_back();
+         }
+         else
+         {
+            result.error = "Unexpected file type";
+         }
+      }
+   };
+
+   if(nThreads > 1)
+   {
+      WorkerPool pool(nThreads - 1);
+      pool.parallel_for(nThreads, lane);
+   }
+   else
+   {
+      lane(0);
+   }
+
+   int res = 0;
+   for(std::size_t i = 0; i < report.size(); i++)
+   {
+      const pfs_verify_result_t& r = report[i];
+      if(r.ok)
+      {
+         if(r.verified)
+            m_output << "Verified: " << r.path << std::endl;
+         else if(is_unencrypted(items[i].file->file.m_info.header.type))
+            m_output << "Not encrypted: " << r.path << std::endl;
+         else
+            m_output << "Not verified (no icv): " << r.path << std::endl;
+      }
+      else
+      {
+         m_output << "Failed to verify: " << r.path << " (" << r.error << ")" << std::endl;
+         res = -1;
+      }
+   }
+
+   return res;
+}
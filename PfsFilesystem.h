@@ -1,19 +1,40 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "IF00DKeyEncryptor.h"
 #include "ICryptoOperations.h"
+#include "PfsKeyRing.h"
 
 #include "FilesDbParser.h"
 #include "UnicvDbParser.h"
 #include "PfsPageMapper.h"
+#include "PfsPathFilter.h"
+#include "IPfsOutputSink.h"
+#include "PfsIoQueueFactory.h"
+#include "PfsCacheControl.h"
+
+//result of verification of single file
+struct pfs_verify_result_t
+{
+   std::string path;
+   std::uint32_t icv_salt;
+   std::uint64_t size;
+   bool verified; //false for files that are copied as is and for files that have no sector icv to check
+   bool ok;
+   std::string error;
+};
 
 class PfsFilesystem
 {
+   friend class PfsVirtualFilesystem;
+
 private:
    std::shared_ptr<ICryptoOperations> m_cryptops;
    std::shared_ptr<IF00DKeyEncryptor> m_iF00D;
+   std::shared_ptr<PfsKeyRing> m_keyRing;
    std::ostream& m_output;
    unsigned char m_klicensee[0x10];
    const psvpfs::path& m_titleIdPath;
@@ -23,12 +44,88 @@ private:
    std::unique_ptr<UnicvDbParser> m_unicvDbParser;
    std::unique_ptr<PfsPageMapper> m_pageMapper;
 
+private:
+   std::shared_ptr<PfsPathFilter> m_filter;
+
+   std::uint32_t m_shardIndex;
+   std::uint32_t m_shardCount;
+
+   PfsIoQueueTypes m_ioType;
+   PfsCacheModes m_cacheMode;
+   bool m_verifyOutputs;
+
+private:
+   //file that has data and is mapped to real file
+   struct pfs_mapped_file_t
+   {
+      std::shared_ptr<sce_iftbl_base_t> table;
+      const sce_junction* filepath;
+      const sce_ng_pfs_file_t* file;
+   };
+
 public:
    PfsFilesystem(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, std::ostream& output,
-                 const unsigned char* klicensee, const psvpfs::path& titleIdPath);
+                 const unsigned char* klicensee, const psvpfs::path& titleIdPath, bool lazy = false);
+
+public:
+   //filter has to be set before mount. only matching files are mapped, decrypted and verified
+   void set_path_filter(std::shared_ptr<PfsPathFilter> filter);
+
+   bool is_filtered() const
+   {
+      return m_filter && !m_filter->empty();
+   }
+
+   //only files of shard index out of count are decrypted. files are split by size so that shards get about the same amount of data
+   //split does not depend on anything but the title so processes on different machines agree on it without coordination
+   //first shard also creates empty files. every shard keeps its own manifest in destination
+   void set_shard(std::uint32_t index, std::uint32_t count);
+
+   bool is_sharded() const
+   {
+      return m_shardCount > 1;
+   }
+
+   //selects how input is read and output is written by decrypt_files and extract_files
+   //io_uring keeps several reads and writes in flight. it falls back to blocking io if kernel does not support it
+   void set_io_queue_type(PfsIoQueueTypes type);
+
+   //selects how extraction uses page cache for input files and output files
+   //direct mode relies on sector size of pfs files being multiple of PFS_IO_BUFFER_ALIGNMENT so only file tails go through page cache
+   void set_cache_mode(PfsCacheModes mode);
+
+   //outputs completed by previous run are read and checked against their digest before they are skipped
+   //by default only salt and size of the output are checked
+   void set_verify_outputs(bool verify);
+
+private:
+   int get_mapped_files(std::vector<pfs_mapped_file_t>& items) const;
+
+   //leaves only files of current shard
+   void select_shard(std::vector<pfs_mapped_file_t>& items) const;
+
+   static std::string get_manifest_name(std::uint32_t index, std::uint32_t count);
+
+   //path of the file relative to title root with '/' separators
+   std::string get_relative_path(const sce_junction& junction) const;
 
 public:
    int mount();
 
    int decrypt_files(const psvpfs::path& destTitleIdPath) const;
+
+   //writes directories and then files in files.db order to the sink. data is written strictly sequentially
+   //path filter and shard are applied same as in decrypt_files. there is no resume since sink may be a stream
+   int extract_files(std::shared_ptr<IPfsOutputSink> sink) const;
+
+   //checks that shards together produced every file of the title and that outputs match digests in shard manifests
+   //entries of all shards are merged into main manifest
+   //count 1 checks that main manifest of unsharded extraction covers the title
+   int merge_shards(const psvpfs::path& destTitleIdPath, std::uint32_t count) const;
+
+   //verifies icv of every sector of every file without decryption and without writing anything
+   //files.db hash tree and icv.db merkle trees are already validated by mount
+   //files are processed in parallel. 0 threads means number of hardware threads
+   //returns -1 if any file failed verification. report has one entry per file
+   int verify_files(std::vector<pfs_verify_result_t>& report, std::size_t nThreads = 0) const;
 };
@@ -0,0 +1,24 @@
+#include <stdexcept>
+
+#include "PfsIoQueueFactory.h"
+#include "PfsSyncIoQueue.h"
+#include "PfsUringIoQueue.h"
+
+std::shared_ptr<IPfsIoQueue> PfsIoQueueFactory::create(PfsIoQueueTypes type, std::uint32_t depth, std::size_t bufferSize)
+{
+   switch(type)
+   {
+   case PfsIoQueueTypes::sync:
+      return std::make_shared<PfsSyncIoQueue>(depth, bufferSize);
+   case PfsIoQueueTypes::uring:
+      {
+         //kernel may be too old or io_uring may be disabled by seccomp or sysctl
+         std::shared_ptr<PfsUringIoQueue> queue = std::make_shared<PfsUringIoQueue>(depth, bufferSize);
+         if(queue->setup() < 0)
+            return std::make_shared<PfsSyncIoQueue>(depth, bufferSize);
+         return queue;
+      }
+   default:
+      throw std::runtime_error("unexpected PfsIoQueueTypes value");
+   }
+}
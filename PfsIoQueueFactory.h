@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "IPfsIoQueue.h"
+
+//number of requests in flight
+#define PFS_IO_QUEUE_DEPTH 4
+
+//size of every pool buffer
+#define PFS_IO_BUFFER_SIZE 0x100000
+
+enum class PfsIoQueueTypes
+{
+   sync,
+   uring //falls back to sync if io_uring is not available
+};
+
+class PfsIoQueueFactory
+{
+public:
+   static std::shared_ptr<IPfsIoQueue> create(PfsIoQueueTypes type, std::uint32_t depth = PFS_IO_QUEUE_DEPTH, std::size_t bufferSize = PFS_IO_BUFFER_SIZE);
+};
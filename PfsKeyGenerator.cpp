@@ -121,8 +121,8 @@ int scePfsUtilGetGDKeys2(std::shared_ptr<ICryptoOperations> cryptops, unsigned c
 //---------------------
 
 //[TESTED]
-//this function is used to derive keys for gamedata and savedata
-int setup_crypt_packet_keys(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, CryptEngineData* data, const derive_keys_ctx* drv_ctx)
+//this function is used to derive dec_key and tweak_enc_key for gamedata and savedata
+int derive_crypt_packet_keys(std::shared_ptr<ICryptoOperations> cryptops, CryptEngineData* data, const derive_keys_ctx* drv_ctx)
 {
    if(is_gamedata(data->mode_index))
    {
@@ -141,5 +141,14 @@ int setup_crypt_packet_keys(std::shared_ptr<ICryptoOperations> cryptops, std::sh
       scePfsUtilGetSDKeys(cryptops, data->dec_key, data->tweak_enc_key, data->klicensee, data->files_salt, data->icv_salt);
    }
 
+   return 0;
+}
+
+//[TESTED]
+//this function is used to derive keys for gamedata and savedata
+int setup_crypt_packet_keys(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, CryptEngineData* data, const derive_keys_ctx* drv_ctx)
+{
+   derive_crypt_packet_keys(cryptops, data, drv_ctx);
+
    return scePfsUtilGetSecret(cryptops, iF00D, data->secret, data->klicensee, data->files_salt, data->crypto_engine_flag, data->icv_salt, data->key_id);
 }
\ No newline at end of file
@@ -8,4 +8,6 @@
 struct CryptEngineData;
 struct derive_keys_ctx;
 
+int derive_crypt_packet_keys(std::shared_ptr<ICryptoOperations> cryptops, CryptEngineData* data, const derive_keys_ctx* drv_ctx);
+
 int setup_crypt_packet_keys(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, CryptEngineData* data, const derive_keys_ctx* drv_ctx);
\ No newline at end of file
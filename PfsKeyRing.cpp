@@ -0,0 +1,72 @@
+#include "PfsKeyRing.h"
+
+#include <cstring>
+
+#include "PfsCryptEngine.h"
+#include "PfsKeyGenerator.h"
+#include "SecretGenerator.h"
+#include "FlagOperations.h"
+
+//only these flags have effect on key derivation
+//other flags (like CRYPTO_ENGINE_THROW_ERROR) are ignored so that all stages share same entries
+#define KEY_RING_FLAG_MASK (CRYPTO_ENGINE_CRYPTO_USE_CMAC | CRYPTO_ENGINE_CRYPTO_USE_KEYGEN)
+
+PfsKeyRing::PfsKeyRing(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, const unsigned char* klicensee)
+   : m_cryptops(cryptops), m_iF00D(iF00D)
+{
+   memcpy(m_klicensee, klicensee, 0x10);
+}
+
+int PfsKeyRing::get_secret(unsigned char* secret, std::uint32_t files_salt, std::uint16_t crypto_engine_flag, std::uint32_t icv_salt, std::uint16_t key_id)
+{
+   secret_key_t key(files_salt, crypto_engine_flag & KEY_RING_FLAG_MASK, icv_salt, key_id);
+
+   std::lock_guard<std::mutex> guard(m_mutex);
+
+   auto it = m_secrets.find(key);
+   if(it == m_secrets.end())
+   {
+      std::array<std::uint8_t, 0x14> value;
+      int res = scePfsUtilGetSecret(m_cryptops, m_iF00D, value.data(), m_klicensee, files_salt, crypto_engine_flag, icv_salt, key_id);
+      if(res < 0)
+         return res;
+
+      it = m_secrets.insert(std::make_pair(key, value)).first;
+   }
+
+   memcpy(secret, it->second.data(), 0x14);
+
+   return 0;
+}
+
+int PfsKeyRing::setup_crypt_packet_keys(CryptEngineData* data, const derive_keys_ctx* drv_ctx)
+{
+   std::array<std::uint8_t, 0x14> dbseed;
+   memcpy(dbseed.data(), drv_ctx->dbseed, 0x14);
+
+   packet_key_t key(data->files_salt, data->crypto_engine_flag & KEY_RING_FLAG_MASK, data->icv_salt, data->mode_index, (int)drv_ctx->db_type, drv_ctx->icv_version, dbseed);
+
+   {
+      std::lock_guard<std::mutex> guard(m_mutex);
+
+      auto it = m_packetKeys.find(key);
+      if(it == m_packetKeys.end())
+      {
+         packet_keys_t value;
+
+         int res = derive_crypt_packet_keys(m_cryptops, data, drv_ctx);
+         if(res < 0)
+            return res;
+
+         memcpy(value.dec_key, data->dec_key, 0x10);
+         memcpy(value.tweak_enc_key, data->tweak_enc_key, 0x10);
+
+         it = m_packetKeys.insert(std::make_pair(key, value)).first;
+      }
+
+      memcpy(data->dec_key, it->second.dec_key, 0x10);
+      memcpy(data->tweak_enc_key, it->second.tweak_enc_key, 0x10);
+   }
+
+   return get_secret(data->secret, data->files_salt, data->crypto_engine_flag, data->icv_salt, data->key_id);
+}
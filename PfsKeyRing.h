@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <array>
+
+#include "IF00DKeyEncryptor.h"
+#include "ICryptoOperations.h"
+
+struct CryptEngineData;
+struct derive_keys_ctx;
+
+//per mount storage of derived key material
+//secret, dec_key and tweak_enc_key are derived once per table and then reused
+//by page mapper, merkle tree validation and file decryption
+//klicensee is fixed for the whole mount so it is not part of the lookup keys
+class PfsKeyRing
+{
+private:
+   //files_salt, crypto engine flags, icv_salt, key_id
+   typedef std::tuple<std::uint32_t, std::uint16_t, std::uint32_t, std::uint16_t> secret_key_t;
+
+   //files_salt, crypto engine flags, icv_salt, mode_index, db_type, icv_version, dbseed
+   typedef std::tuple<std::uint32_t, std::uint16_t, std::uint32_t, std::uint16_t, int, std::uint32_t, std::array<std::uint8_t, 0x14> > packet_key_t;
+
+   struct packet_keys_t
+   {
+      unsigned char dec_key[0x10];
+      unsigned char tweak_enc_key[0x10];
+   };
+
+private:
+   std::shared_ptr<ICryptoOperations> m_cryptops;
+   std::shared_ptr<IF00DKeyEncryptor> m_iF00D;
+   unsigned char m_klicensee[0x10];
+
+private:
+   std::mutex m_mutex;
+   std::map<secret_key_t, std::array<std::uint8_t, 0x14> > m_secrets;
+   std::map<packet_key_t, packet_keys_t> m_packetKeys;
+
+public:
+   PfsKeyRing(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, const unsigned char* klicensee);
+
+   PfsKeyRing(const PfsKeyRing&) = delete;
+
+   PfsKeyRing& operator=(const PfsKeyRing&) = delete;
+
+public:
+   //memoized version of scePfsUtilGetSecret
+   int get_secret(unsigned char* secret, std::uint32_t files_salt, std::uint16_t crypto_engine_flag, std::uint32_t icv_salt, std::uint16_t key_id);
+
+   //memoized version of setup_crypt_packet_keys
+   int setup_crypt_packet_keys(CryptEngineData* data, const derive_keys_ctx* drv_ctx);
+};
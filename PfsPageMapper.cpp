@@ -1,11 +1,10 @@
 #include "PfsPageMapper.h"
 
-#include "SecretGenerator.h"
 #include "UnicvDbParser.h"
 #include "FilesDbParser.h"
 
-PfsPageMapper::PfsPageMapper(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, std::ostream& output, const unsigned char* klicensee, const psvpfs::path& titleIdPath)
-   : m_cryptops(cryptops), m_iF00D(iF00D), m_output(output), m_titleIdPath(titleIdPath)
+PfsPageMapper::PfsPageMapper(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, std::shared_ptr<PfsKeyRing> keyRing, std::ostream& output, const unsigned char* klicensee, const psvpfs::path& titleIdPath)
+   : m_cryptops(cryptops), m_iF00D(iF00D), m_keyRing(keyRing), m_output(output), m_titleIdPath(titleIdPath)
 {
    memcpy(m_klicensee, klicensee, 0x10);
 }
@@ -151,7 +150,7 @@ int PfsPageMapper::validate_merkle_trees(const std::unique_ptr<FilesDbParser>& f
 
       //calculate secret
       unsigned char secret[0x14];
-      scePfsUtilGetSecret(m_cryptops, m_iF00D, secret, m_klicensee, ngpfs.files_salt, img_spec_to_crypto_engine_flag(ngpfs.image_spec), table->get_icv_salt(), 0);
+      m_keyRing->get_secret(secret, ngpfs.files_salt, img_spec_to_crypto_engine_flag(ngpfs.image_spec), table->get_icv_salt(), 0);
 
       //find junction
       auto junctionIt = m_pageMap.find(table->get_icv_salt());
@@ -215,7 +214,7 @@ int PfsPageMapper::validate_merkle_trees(const std::unique_ptr<FilesDbParser>& f
          walk_tree(mkt, collect_hash, &hashTable);
 
          //compare tables
-         if(compare_hash_tables(hashTable, table->m_blocks.front().m_signatures) < 0)
+         if(compare_hash_tables(hashTable, table->get_blocks().front().m_signatures) < 0)
          {
             m_output << "Merkle tree is invalid in file " << junction << std::endl;
             return -1;
@@ -238,7 +237,7 @@ int PfsPageMapper::validate_merkle_trees(const std::unique_ptr<FilesDbParser>& f
 //initialized with parse method externally prior to calling bruteforce_map
 //having filesDbParser and unicvDbParser as constructor arguments will
 //introduce ambiguity in usage of PfsPageMapper
-int PfsPageMapper::bruteforce_map(const std::unique_ptr<FilesDbParser>& filesDbParser, const std::unique_ptr<UnicvDbParser>& unicvDbParser)
+int PfsPageMapper::bruteforce_map(const std::unique_ptr<FilesDbParser>& filesDbParser, const std::unique_ptr<UnicvDbParser>& unicvDbParser, std::shared_ptr<PfsPathFilter> filter)
 {
    const sce_ng_pfs_header_t& ngpfs = filesDbParser->get_header();
    const std::unique_ptr<sce_idb_base_t>& unicv = unicvDbParser->get_idatabase();
@@ -255,7 +254,7 @@ int PfsPageMapper::bruteforce_map(const std::unique_ptr<FilesDbParser>& filesDbP
    for(auto& t : unicv->m_tables)
    {
       //skip SCEINULL blocks
-      if(t->m_blocks.size() > 0)
+      if(t->get_num_blocks() > 0)
          fileSectorSizes.insert(t->get_header()->get_fileSectorSize());
    }
 
@@ -272,6 +271,20 @@ int PfsPageMapper::bruteforce_map(const std::unique_ptr<FilesDbParser>& filesDbP
    std::set<psvpfs::path> directories;
    getFileListNoPfs(root, files, directories);
 
+   //files that do not match the filter are never read
+   if(filter && !filter->empty())
+   {
+      for(auto it = files.begin(); it != files.end(); )
+      {
+         if(filter->match(root, *it))
+            ++it;
+         else
+            it = files.erase(it);
+      }
+   }
+
+   bool partial = filter && !filter->empty();
+
    //pre read all the files once
    std::map<sce_junction, std::vector<std::uint8_t>> fileDatas;
    for(auto& real_file : files)
@@ -314,19 +327,27 @@ int PfsPageMapper::bruteforce_map(const std::unique_ptr<FilesDbParser>& filesDbP
    //brutforce each sce_iftbl_t record
    for(auto& t : unicv->m_tables)
    {
+      //with filter - stop as soon as all selected files are mapped
+      if(partial && fileDatas.empty())
+         break;
+
       //process only files that are not empty
       if(t->get_header()->get_numSectors() > 0)
       {
+         //only first signature block is required for mapping
+         if(!t->load_blocks(1))
+            return -1;
+
          //generate secret - one secret per unicv.db page is required
          unsigned char secret[0x14];
-         scePfsUtilGetSecret(m_cryptops, m_iF00D, secret, m_klicensee, ngpfs.files_salt, img_spec_to_crypto_engine_flag(ngpfs.image_spec), t->get_icv_salt(), 0);
+         m_keyRing->get_secret(secret, ngpfs.files_salt, img_spec_to_crypto_engine_flag(ngpfs.image_spec), t->get_icv_salt(), 0);
 
          std::shared_ptr<sce_junction> found_path;
 
          if(img_spec_to_is_unicv(ngpfs.image_spec))
          {
             //in unicv - hash table has same order as sectors in a file
-            const unsigned char* zeroSectorIcv = t->m_blocks.front().m_signatures.front().m_data.data();
+            const unsigned char* zeroSectorIcv = t->get_blocks().front().m_signatures.front().m_data.data();
 
             //try to find match by hash of zero sector
             found_path = brutforce_hashes(filesDbParser, fileDatas, secret, zeroSectorIcv);
@@ -339,19 +360,20 @@ int PfsPageMapper::bruteforce_map(const std::unique_ptr<FilesDbParser>& filesDbP
                std::shared_ptr<merkle_tree<icv> > mkt = generate_merkle_tree<icv>(t->get_header()->get_numSectors());
                index_merkle_tree(mkt);
 
-               //save merkle tree
-               merkleTrees.push_back(std::make_pair(t, mkt));
-
                //use merkle tree to find index of zero sector in hash table
                std::pair<std::uint32_t, std::uint32_t> ctx;
                walk_tree(mkt, find_zero_sector_index, &ctx);
 
                //in icv - hash table is ordered according to merkle tree structure
                //that is why it is required to walk through the tree to find zero sector hash in hash table
-               const unsigned char* zeroSectorIcv = t->m_blocks.front().m_signatures.at(ctx.second).m_data.data();
+               const unsigned char* zeroSectorIcv = t->get_blocks().front().m_signatures.at(ctx.second).m_data.data();
 
                //try to find match by hash of zero sector
                found_path = brutforce_hashes(filesDbParser, fileDatas, secret, zeroSectorIcv);
+
+               //save merkle tree - only mapped tables are validated
+               if(found_path)
+                  merkleTrees.push_back(std::make_pair(t, mkt));
             }
             catch(std::runtime_error& e)
             {
@@ -365,6 +387,11 @@ int PfsPageMapper::bruteforce_map(const std::unique_ptr<FilesDbParser>& filesDbP
             m_output << "Match found: " << std::hex << t->get_icv_salt() << " " << *found_path << std::endl;
             m_pageMap.insert(std::make_pair(t->get_icv_salt(), *found_path));
          }
+         else if(partial)
+         {
+            //table belongs to file that is filtered out
+            continue;
+         }
          else
          {
             m_output << "Match not found: " << std::hex << t->get_icv_salt() << std::endl;
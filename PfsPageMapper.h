@@ -9,9 +9,11 @@
 
 #include "IF00DKeyEncryptor.h"
 #include "ICryptoOperations.h"
+#include "PfsKeyRing.h"
 
 #include "Utils.h"
 #include "MerkleTree.hpp"
+#include "PfsPathFilter.h"
 
 class FilesDbParser;
 class UnicvDbParser;
@@ -28,12 +30,13 @@ private:
 private:
    std::shared_ptr<ICryptoOperations> m_cryptops;
    std::shared_ptr<IF00DKeyEncryptor> m_iF00D;
+   std::shared_ptr<PfsKeyRing> m_keyRing;
    std::ostream& m_output;
    unsigned char m_klicensee[0x10];
    const psvpfs::path& m_titleIdPath;
 
 public:
-   PfsPageMapper(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, std::ostream& output, const unsigned char* klicensee, const psvpfs::path& titleIdPath);
+   PfsPageMapper(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, std::shared_ptr<PfsKeyRing> keyRing, std::ostream& output, const unsigned char* klicensee, const psvpfs::path& titleIdPath);
 
 private:
    std::shared_ptr<sce_junction> brutforce_hashes(const std::unique_ptr<FilesDbParser>& filesDbParser, std::map<sce_junction, std::vector<std::uint8_t>>& fileDatas, const unsigned char* secret, const unsigned char* signature) const;
@@ -43,7 +46,8 @@ private:
    int validate_merkle_trees(const std::unique_ptr<FilesDbParser>& filesDbParser, std::vector<std::pair<std::shared_ptr<sce_iftbl_base_t>, std::shared_ptr<merkle_tree<icv> > > >& merkleTrees);
 
 public:
-   int bruteforce_map(const std::unique_ptr<FilesDbParser>& filesDbParser, const std::unique_ptr<UnicvDbParser>& unicvDbParser);
+   //if filter is set only files that match it are read and mapped. tables of other files are left unmapped
+   int bruteforce_map(const std::unique_ptr<FilesDbParser>& filesDbParser, const std::unique_ptr<UnicvDbParser>& unicvDbParser, std::shared_ptr<PfsPathFilter> filter = nullptr);
 
    int load_page_map(const psvpfs::path& filepath, std::map<std::uint32_t, std::string>& pageMap) const;
 
@@ -0,0 +1,159 @@
+#include "PfsPathFilter.h"
+
+#include <algorithm>
+#include <cctype>
+
+static std::string normalize_path(const std::string& path)
+{
+   std::string result = path;
+
+   std::replace(result.begin(), result.end(), '\\', '/');
+   std::transform(result.begin(), result.end(), result.begin(), static_cast<int (*)(int)>(std::toupper));
+
+   //paths are relative to title root
+   while(result.size() > 0 && result.front() == '/')
+      result.erase(result.begin());
+
+   if(result.size() > 1 && result.compare(0, 2, "./") == 0)
+      result.erase(0, 2);
+
+   return result;
+}
+
+std::string PfsPathFilter::normalize_pattern(const std::string& pattern)
+{
+   std::string result = normalize_path(pattern);
+
+   //directory pattern selects everything inside
+   if(result.size() > 0 && result.back() == '/')
+      result += "**";
+
+   return result;
+}
+
+void PfsPathFilter::add_include(const std::string& pattern)
+{
+   m_includes.push_back(normalize_pattern(pattern));
+}
+
+void PfsPathFilter::add_exclude(const std::string& pattern)
+{
+   m_excludes.push_back(normalize_pattern(pattern));
+}
+
+bool PfsPathFilter::glob_match(const char* pattern, const char* path)
+{
+   while(*pattern)
+   {
+      if(pattern[0] == '*' && pattern[1] == '*')
+      {
+         pattern += 2;
+
+         //"**/" also matches zero directories
+         if(*pattern == '/' && glob_match(pattern + 1, path))
+            return true;
+
+         for(;; path++)
+         {
+            if(glob_match(pattern, path))
+               return true;
+            if(*path == 0)
+               return false;
+         }
+      }
+      else if(*pattern == '*')
+      {
+         pattern++;
+
+         for(;; path++)
+         {
+            if(glob_match(pattern, path))
+               return true;
+            if(*path == 0 || *path == '/')
+               return false;
+         }
+      }
+      else if(*pattern == '?')
+      {
+         if(*path == 0 || *path == '/')
+            return false;
+
+         pattern++;
+         path++;
+      }
+      else
+      {
+         if(*pattern != *path)
+            return false;
+
+         pattern++;
+         path++;
+      }
+   }
+
+   return *path == 0;
+}
+
+//both pattern and path have to be normalized
+bool PfsPathFilter::match_pattern(const std::string& pattern, const std::string& path)
+{
+   //pattern without separator is matched against file name only
+   if(pattern.find('/') == std::string::npos)
+   {
+      std::size_t pos = path.rfind('/');
+      std::string name = (pos == std::string::npos) ? path : path.substr(pos + 1);
+      return glob_match(pattern.c_str(), name.c_str());
+   }
+
+   if(glob_match(pattern.c_str(), path.c_str()))
+      return true;
+
+   //"dir/**" also matches "dir"
+   if(pattern.size() > 3 && pattern.compare(pattern.size() - 3, 3, "/**") == 0)
+      return glob_match(pattern.substr(0, pattern.size() - 3).c_str(), path.c_str());
+
+   return false;
+}
+
+bool PfsPathFilter::match(const std::string& path) const
+{
+   std::string p = normalize_path(path);
+
+   if(m_includes.size() > 0)
+   {
+      bool included = false;
+      for(auto& i : m_includes)
+      {
+         if(match_pattern(i, p))
+         {
+            included = true;
+            break;
+         }
+      }
+
+      if(!included)
+         return false;
+   }
+
+   for(auto& e : m_excludes)
+   {
+      if(match_pattern(e, p))
+         return false;
+   }
+
+   return true;
+}
+
+bool PfsPathFilter::match(const psvpfs::path& root, const psvpfs::path& path) const
+{
+   std::string r = normalize_path(root.generic_string());
+   std::string p = normalize_path(path.generic_string());
+
+   while(r.size() > 0 && r.back() == '/')
+      r.pop_back();
+
+   if(r.size() > 0 && p.compare(0, r.size(), r) == 0 && (p.size() == r.size() || p[r.size()] == '/'))
+      p = p.substr(r.size());
+
+   return match(p);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "LocalFilesystem.h"
+
+//include/exclude filter of paths inside the title
+//paths are relative to title root, use '/' as separator and are compared case insensitive
+//glob syntax:
+//  *  - any sequence of characters except '/'
+//  ?  - any single character except '/'
+//  ** - any sequence of characters including '/'. "dir/**" also matches "dir" itself
+//pattern that ends with '/' matches directory and everything inside, like "sce_sys/"
+//pattern without '/' matches name of the file in any directory, like "*.suprx"
+//path is selected if it matches any include pattern (or there are no include patterns) and does not match any exclude pattern
+class PfsPathFilter
+{
+private:
+   std::vector<std::string> m_includes;
+   std::vector<std::string> m_excludes;
+
+public:
+   void add_include(const std::string& pattern);
+
+   void add_exclude(const std::string& pattern);
+
+   bool empty() const
+   {
+      return m_includes.empty() && m_excludes.empty();
+   }
+
+public:
+   bool match(const std::string& path) const;
+
+   //converts path in real filesystem or virtual path from files.db to path relative to root and matches it
+   bool match(const psvpfs::path& root, const psvpfs::path& path) const;
+
+public:
+   static std::string normalize_pattern(const std::string& pattern);
+
+   static bool glob_match(const char* pattern, const char* path);
+
+   static bool match_pattern(const std::string& pattern, const std::string& path);
+};
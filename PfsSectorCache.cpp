@@ -0,0 +1,116 @@
+#include "PfsSectorCache.h"
+
+PfsSectorCache::PfsSectorCache(std::size_t budget, std::size_t nShards)
+   : m_budget(budget),
+     m_hits(0),
+     m_misses(0)
+{
+   if(nShards == 0)
+      nShards = 1;
+
+   for(std::size_t i = 0; i < nShards; i++)
+      m_shards.push_back(std::unique_ptr<shard_t>(new shard_t()));
+
+   m_shardBudget = budget / nShards;
+}
+
+std::uint64_t PfsSectorCache::make_key(std::uint32_t icv_salt, std::uint32_t sector)
+{
+   return (static_cast<std::uint64_t>(icv_salt) << 32) | sector;
+}
+
+PfsSectorCache::shard_t& PfsSectorCache::get_shard(std::uint64_t key) const
+{
+   //neighbour sectors of the same file should go to different shards
+   std::uint64_t h = key;
+   h ^= h >> 33;
+   h *= 0xFF51AFD7ED558CCDULL;
+   h ^= h >> 33;
+   return *m_shards[static_cast<std::size_t>(h % m_shards.size())];
+}
+
+PfsSectorCache::sector_t PfsSectorCache::find(std::uint32_t icv_salt, std::uint32_t sector)
+{
+   std::uint64_t key = make_key(icv_salt, sector);
+   shard_t& shard = get_shard(key);
+
+   std::lock_guard<std::mutex> guard(shard.mutex);
+
+   auto it = shard.index.find(key);
+   if(it == shard.index.end())
+   {
+      m_misses.fetch_add(1, std::memory_order_relaxed);
+      return sector_t();
+   }
+
+   //move to front
+   shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+
+   m_hits.fetch_add(1, std::memory_order_relaxed);
+   return it->second->second;
+}
+
+bool PfsSectorCache::contains(std::uint32_t icv_salt, std::uint32_t sector) const
+{
+   std::uint64_t key = make_key(icv_salt, sector);
+   shard_t& shard = get_shard(key);
+
+   std::lock_guard<std::mutex> guard(shard.mutex);
+
+   return shard.index.find(key) != shard.index.end();
+}
+
+void PfsSectorCache::insert(std::uint32_t icv_salt, std::uint32_t sector, const unsigned char* data, std::uint32_t size)
+{
+   //sector that does not fit into shard is never cached
+   if(size == 0 || size > m_shardBudget)
+      return;
+
+   //copy is made before taking the lock
+   sector_t value = std::make_shared<const std::vector<std::uint8_t> >(data, data + size);
+
+   std::uint64_t key = make_key(icv_salt, sector);
+   shard_t& shard = get_shard(key);
+
+   std::lock_guard<std::mutex> guard(shard.mutex);
+
+   //another reader could have inserted same sector
+   if(shard.index.find(key) != shard.index.end())
+      return;
+
+   while(shard.bytes + size > m_shardBudget && !shard.lru.empty())
+   {
+      shard.bytes -= shard.lru.back().second->size();
+      shard.index.erase(shard.lru.back().first);
+      shard.lru.pop_back();
+   }
+
+   shard.lru.push_front(std::make_pair(key, value));
+   shard.index.insert(std::make_pair(key, shard.lru.begin()));
+   shard.bytes += size;
+}
+
+void PfsSectorCache::clear()
+{
+   for(auto& s : m_shards)
+   {
+      std::lock_guard<std::mutex> guard(s->mutex);
+
+      s->lru.clear();
+      s->index.clear();
+      s->bytes = 0;
+   }
+}
+
+std::size_t PfsSectorCache::size() const
+{
+   std::size_t total = 0;
+
+   for(auto& s : m_shards)
+   {
+      std::lock_guard<std::mutex> guard(s->mutex);
+      total += s->bytes;
+   }
+
+   return total;
+}
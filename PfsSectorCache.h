@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+//default number of independently locked shards
+#define PFS_SECTOR_CACHE_DEFAULT_SHARDS 16
+
+//concurrent cache of verified and decrypted sectors
+//sectors are identified by icv_salt of the file (page in unicv.db or filename salt in icv.db) and sector index in the file
+//cache is split into shards with separate locks and separate lru lists. each shard gets equal part of the byte budget
+class PfsSectorCache
+{
+public:
+   typedef std::shared_ptr<const std::vector<std::uint8_t> > sector_t;
+
+private:
+   struct shard_t
+   {
+      std::mutex mutex;
+      std::list<std::pair<std::uint64_t, sector_t> > lru; //most recently used entries are at the front
+      std::unordered_map<std::uint64_t, std::list<std::pair<std::uint64_t, sector_t> >::iterator> index;
+      std::size_t bytes;
+
+      shard_t()
+         : bytes(0)
+      {
+      }
+   };
+
+private:
+   std::vector<std::unique_ptr<shard_t> > m_shards;
+   std::size_t m_budget;
+   std::size_t m_shardBudget;
+
+   std::atomic<std::uint64_t> m_hits;
+   std::atomic<std::uint64_t> m_misses;
+
+public:
+   //budget is total number of bytes of sector data that can be kept in the cache
+   PfsSectorCache(std::size_t budget, std::size_t nShards = PFS_SECTOR_CACHE_DEFAULT_SHARDS);
+
+   PfsSectorCache(const PfsSectorCache&) = delete;
+
+   PfsSectorCache& operator=(const PfsSectorCache&) = delete;
+
+private:
+   static std::uint64_t make_key(std::uint32_t icv_salt, std::uint32_t sector);
+
+   shard_t& get_shard(std::uint64_t key) const;
+
+public:
+   //returns cached sector or empty pointer. updates hit and miss counters
+   sector_t find(std::uint32_t icv_salt, std::uint32_t sector);
+
+   //checks presence of sector without updating counters or lru order
+   bool contains(std::uint32_t icv_salt, std::uint32_t sector) const;
+
+   //inserts copy of sector data. least recently used sectors of the shard are evicted to stay within the budget
+   void insert(std::uint32_t icv_salt, std::uint32_t sector, const unsigned char* data, std::uint32_t size);
+
+   void clear();
+
+public:
+   std::uint64_t hits() const
+   {
+      return m_hits.load(std::memory_order_relaxed);
+   }
+
+   std::uint64_t misses() const
+   {
+      return m_misses.load(std::memory_order_relaxed);
+   }
+
+   std::size_t budget() const
+   {
+      return m_budget;
+   }
+
+   //number of bytes of sector data that are currently cached
+   std::size_t size() const;
+};
@@ -0,0 +1,92 @@
+#include "PfsShard.h"
+
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <functional>
+
+std::vector<std::uint32_t> assign_shards(const std::vector<pfs_shard_item_t>& items, std::uint32_t nShards)
+{
+   std::vector<std::uint32_t> result(items.size(), 0);
+
+   if(nShards <= 1)
+      return result;
+
+   //biggest first. same size items are ordered by key and then by position so order never depends on sort implementation
+   std::vector<std::size_t> order(items.size());
+   std::iota(order.begin(), order.end(), 0);
+
+   std::sort(order.begin(), order.end(), [&items](std::size_t l, std::size_t r)
+   {
+      if(items[l].size != items[r].size)
+         return items[l].size > items[r].size;
+      if(items[l].key != items[r].key)
+         return items[l].key < items[r].key;
+      return l < r;
+   });
+
+   //least loaded shard on top. shards with same load are taken by index
+   typedef std::pair<std::uint64_t, std::uint32_t> load_t;
+   std::priority_queue<load_t, std::vector<load_t>, std::greater<load_t> > loads;
+
+   for(std::uint32_t i = 0; i < nShards; i++)
+      loads.push(load_t(0, i));
+
+   for(std::size_t i : order)
+   {
+      load_t shard = loads.top();
+      loads.pop();
+
+      result[i] = shard.second;
+
+      //empty items still count so that they are spread too
+      shard.first += std::max<std::uint64_t>(items[i].size, 1);
+      loads.push(shard);
+   }
+
+   return result;
+}
+
+int parse_shard(const std::string& str, std::uint32_t& index, std::uint32_t& count)
+{
+   std::size_t pos = str.find('/');
+   if(pos == std::string::npos || pos == 0 || pos == str.size() - 1)
+      return -1;
+
+   std::string indexStr = str.substr(0, pos);
+   std::string countStr = str.substr(pos + 1);
+
+   if(indexStr.find_first_not_of("0123456789") != std::string::npos || countStr.find_first_not_of("0123456789") != std::string::npos)
+      return -1;
+
+   try
+   {
+      unsigned long i = std::stoul(indexStr);
+      unsigned long n = std::stoul(countStr);
+
+      if(n == 0 || i >= n || n > 0xFFFFFFFF)
+         return -1;
+
+      index = static_cast<std::uint32_t>(i);
+      count = static_cast<std::uint32_t>(n);
+   }
+   catch(std::exception&)
+   {
+      return -1;
+   }
+
+   return 0;
+}
+
+std::uint64_t shard_key(const std::string& str)
+{
+   std::uint64_t h = 0xCBF29CE484222325ULL;
+
+   for(char c : str)
+   {
+      h ^= static_cast<std::uint8_t>(c);
+      h *= 0x100000001B3ULL;
+   }
+
+   return h;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//item that is distributed between shards
+//key has to be stable between runs (like icv_salt or hash of the path) since it breaks ties between items of same size
+struct pfs_shard_item_t
+{
+   std::uint64_t key;
+   std::uint64_t size;
+};
+
+//splits items between nShards shards so that every process computes same assignment without coordination
+//items are balanced by size with longest processing time first rule: biggest item goes to least loaded shard
+//returns shard index for every item in the same order as input
+std::vector<std::uint32_t> assign_shards(const std::vector<pfs_shard_item_t>& items, std::uint32_t nShards);
+
+//parses "i/N" where 0 <= i < N
+int parse_shard(const std::string& str, std::uint32_t& index, std::uint32_t& count);
+
+//stable 64 bit hash of the string (FNV-1a) to be used as shard key
+std::uint64_t shard_key(const std::string& str);
@@ -0,0 +1,115 @@
+#include "PfsSyncIoQueue.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+//transfers part of the range. returns number of bytes, 0 at the end of file or -1 on error
+static std::int64_t fd_pread(int fd, std::uint8_t* data, std::size_t size, std::uint64_t offset)
+{
+#ifdef _WIN32
+   if(_lseeki64(fd, offset, SEEK_SET) < 0)
+      return -1;
+   return _read(fd, data, static_cast<unsigned int>(std::min<std::size_t>(size, 0x40000000)));
+#else
+   return ::pread(fd, data, size, static_cast<off_t>(offset));
+#endif
+}
+
+static std::int64_t fd_pwrite(int fd, const std::uint8_t* data, std::size_t size, std::uint64_t offset)
+{
+#ifdef _WIN32
+   if(_lseeki64(fd, offset, SEEK_SET) < 0)
+      return -1;
+   return _write(fd, data, static_cast<unsigned int>(std::min<std::size_t>(size, 0x40000000)));
+#else
+   return ::pwrite(fd, data, size, static_cast<off_t>(offset));
+#endif
+}
+
+PfsSyncIoQueue::PfsSyncIoQueue(std::uint32_t depth, std::size_t bufferSize)
+   : m_depth(depth), m_bufferSize(bufferSize)
+{
+   m_stride = (bufferSize + PFS_IO_BUFFER_ALIGNMENT - 1) & ~static_cast<std::size_t>(PFS_IO_BUFFER_ALIGNMENT - 1);
+   m_storage.resize(static_cast<std::size_t>(depth) * m_stride + PFS_IO_BUFFER_ALIGNMENT);
+
+   std::uintptr_t address = reinterpret_cast<std::uintptr_t>(m_storage.data());
+   m_pool = m_storage.data() + ((PFS_IO_BUFFER_ALIGNMENT - address % PFS_IO_BUFFER_ALIGNMENT) % PFS_IO_BUFFER_ALIGNMENT);
+}
+
+std::uint8_t* PfsSyncIoQueue::buffer(std::uint32_t index)
+{
+   return m_pool + static_cast<std::size_t>(index) * m_stride;
+}
+
+int PfsSyncIoQueue::prep_read(int fd, std::uint32_t index, std::uint64_t offset, std::size_t size)
+{
+   if(index >= m_depth || size > m_bufferSize)
+      return -1;
+
+   io_request_t request = {false, fd, index, offset, size};
+   m_requests.push_back(request);
+   return 0;
+}
+
+int PfsSyncIoQueue::prep_write(int fd, std::uint32_t index, std::uint64_t offset, std::size_t size)
+{
+   if(index >= m_depth || size > m_bufferSize)
+      return -1;
+
+   io_request_t request = {true, fd, index, offset, size};
+   m_requests.push_back(request);
+   return 0;
+}
+
+int PfsSyncIoQueue::submit()
+{
+   //requests are executed when their completion is requested
+   return 0;
+}
+
+int PfsSyncIoQueue::wait(std::uint32_t& index, std::int64_t& result)
+{
+   if(m_requests.empty())
+      return -1;
+
+   io_request_t request = m_requests.front();
+   m_requests.pop_front();
+
+   index = request.index;
+   result = execute(request);
+   return 0;
+}
+
+std::int64_t PfsSyncIoQueue::execute(const io_request_t& request)
+{
+   std::uint8_t* data = buffer(request.index);
+   std::size_t done = 0;
+
+   while(done < request.size)
+   {
+      std::int64_t res = request.write ? fd_pwrite(request.fd, data + done, request.size - done, request.offset + done)
+                                       : fd_pread(request.fd, data + done, request.size - done, request.offset + done);
+      if(res < 0)
+      {
+#ifndef _WIN32
+         if(errno == EINTR)
+            continue;
+#endif
+         return -1;
+      }
+
+      //end of file
+      if(res == 0)
+         break;
+
+      done += static_cast<std::size_t>(res);
+   }
+
+   return static_cast<std::int64_t>(done);
+}
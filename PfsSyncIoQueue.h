@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "IPfsIoQueue.h"
+
+//portable queue that does blocking pread / pwrite
+//requests are executed one by one in wait() in the order they were queued
+class PfsSyncIoQueue : public IPfsIoQueue
+{
+private:
+   struct io_request_t
+   {
+      bool write;
+      int fd;
+      std::uint32_t index;
+      std::uint64_t offset;
+      std::size_t size;
+   };
+
+private:
+   std::uint32_t m_depth;
+   std::size_t m_bufferSize;
+   std::size_t m_stride; //distance between buffers. keeps every buffer aligned
+   std::vector<std::uint8_t> m_storage;
+   std::uint8_t* m_pool; //aligned start of storage
+   std::deque<io_request_t> m_requests;
+
+public:
+   PfsSyncIoQueue(std::uint32_t depth, std::size_t bufferSize);
+
+public:
+   std::uint32_t depth() const override
+   {
+      return m_depth;
+   }
+
+   std::size_t buffer_size() const override
+   {
+      return m_bufferSize;
+   }
+
+   std::uint8_t* buffer(std::uint32_t index) override;
+
+public:
+   int prep_read(int fd, std::uint32_t index, std::uint64_t offset, std::size_t size) override;
+
+   int prep_write(int fd, std::uint32_t index, std::uint64_t offset, std::size_t size) override;
+
+   int submit() override;
+
+   int wait(std::uint32_t& index, std::int64_t& result) override;
+
+private:
+   std::int64_t execute(const io_request_t& request);
+};
@@ -0,0 +1,260 @@
+#include "PfsTarSink.h"
+
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+//offsets of ustar header fields
+#define TAR_NAME_OFFSET 0
+#define TAR_NAME_SIZE 100
+#define TAR_MODE_OFFSET 100
+#define TAR_UID_OFFSET 108
+#define TAR_GID_OFFSET 116
+#define TAR_SIZE_OFFSET 124
+#define TAR_MTIME_OFFSET 136
+#define TAR_CHKSUM_OFFSET 148
+#define TAR_TYPEFLAG_OFFSET 156
+#define TAR_MAGIC_OFFSET 257
+#define TAR_VERSION_OFFSET 263
+#define TAR_PREFIX_OFFSET 345
+#define TAR_PREFIX_SIZE 155
+
+#define TAR_TYPE_FILE '0'
+#define TAR_TYPE_DIRECTORY '5'
+#define TAR_TYPE_GNU_LONGNAME 'L'
+
+//largest size that fits into 11 octal digits
+#define TAR_MAX_OCTAL_SIZE 077777777777ULL
+
+PfsTarSink::entry_buf_t::entry_buf_t()
+   : m_target(0), m_left(0)
+{
+}
+
+void PfsTarSink::entry_buf_t::reset(std::ostream* target, std::uint64_t size)
+{
+   m_target = target;
+   m_left = size;
+}
+
+std::streamsize PfsTarSink::entry_buf_t::xsputn(const char* s, std::streamsize n)
+{
+   //entry can not grow after its header was written
+   if(!m_target || static_cast<std::uint64_t>(n) > m_left)
+      return 0;
+
+   m_target->write(s, n);
+   if(!*m_target)
+      return 0;
+
+   m_left -= n;
+   return n;
+}
+
+PfsTarSink::entry_buf_t::int_type PfsTarSink::entry_buf_t::overflow(int_type c)
+{
+   if(traits_type::eq_int_type(c, traits_type::eof()))
+      return traits_type::not_eof(c);
+
+   char ch = traits_type::to_char_type(c);
+   if(xsputn(&ch, 1) != 1)
+      return traits_type::eof();
+
+   return c;
+}
+
+PfsTarSink::PfsTarSink(const psvpfs::path& filepath, std::ostream& output)
+   : m_output(output), m_target(&m_file), m_entryStream(&m_entryBuf), m_entrySize(0), m_inEntry(false)
+{
+   m_file.open(filepath.generic_string().c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+   if(!m_file.is_open())
+      m_output << "Failed to open " << filepath.generic_string() << std::endl;
+}
+
+PfsTarSink::PfsTarSink(std::ostream& target, std::ostream& output)
+   : m_output(output), m_target(&target), m_entryStream(&m_entryBuf), m_entrySize(0), m_inEntry(false)
+{
+}
+
+//digits are zero padded and followed by terminator. fails if value does not fit into the field
+static int write_octal(char* field, std::size_t fieldSize, std::uint64_t value)
+{
+   field[fieldSize - 1] = 0;
+
+   for(std::size_t i = fieldSize - 1; i > 0; i--, value >>= 3)
+      field[i - 1] = static_cast<char>('0' + (value & 7));
+
+   return value == 0 ? 0 : -1;
+}
+
+int PfsTarSink::write_header(const std::string& name, std::uint64_t size, char type)
+{
+   char header[PFS_TAR_BLOCK_SIZE];
+   memset(header, 0, sizeof(header));
+
+   //name is either short or split at separator into prefix and name by write_entry_header
+   std::size_t pos = std::string::npos;
+   if(name.size() > TAR_NAME_SIZE)
+      pos = name.find('/', name.size() - TAR_NAME_SIZE - 1);
+
+   if(pos == std::string::npos)
+   {
+      memcpy(header + TAR_NAME_OFFSET, name.data(), std::min<std::size_t>(name.size(), TAR_NAME_SIZE));
+   }
+   else
+   {
+      memcpy(header + TAR_PREFIX_OFFSET, name.data(), std::min<std::size_t>(pos, TAR_PREFIX_SIZE));
+      memcpy(header + TAR_NAME_OFFSET, name.data() + pos + 1, name.size() - pos - 1);
+   }
+
+   write_octal(header + TAR_MODE_OFFSET, 8, type == TAR_TYPE_DIRECTORY ? 0755 : 0644);
+   write_octal(header + TAR_UID_OFFSET, 8, 0);
+   write_octal(header + TAR_GID_OFFSET, 8, 0);
+   write_octal(header + TAR_MTIME_OFFSET, 12, 0);
+
+   if(size <= TAR_MAX_OCTAL_SIZE)
+   {
+      if(write_octal(header + TAR_SIZE_OFFSET, 12, size) < 0)
+      {
+         m_output << "Invalid size of archive entry " << name << std::endl;
+         return -1;
+      }
+   }
+   else
+   {
+      //base-256 big endian with high bit set in first byte
+      header[TAR_SIZE_OFFSET] = (char)0x80;
+      for(int i = 11; i > 0; i--, size >>= 8)
+         header[TAR_SIZE_OFFSET + i] = (char)(size & 0xFF);
+   }
+
+   header[TAR_TYPEFLAG_OFFSET] = type;
+   memcpy(header + TAR_MAGIC_OFFSET, "ustar", 6);
+   memcpy(header + TAR_VERSION_OFFSET, "00", 2);
+
+   //checksum is computed with checksum field filled with spaces
+   memset(header + TAR_CHKSUM_OFFSET, ' ', 8);
+
+   std::uint32_t checksum = 0;
+   for(std::size_t i = 0; i < sizeof(header); i++)
+      checksum += static_cast<std::uint8_t>(header[i]);
+
+   //sum of 512 bytes always fits into 6 digits
+   write_octal(header + TAR_CHKSUM_OFFSET, 7, checksum);
+   header[TAR_CHKSUM_OFFSET + 7] = ' ';
+
+   m_target->write(header, sizeof(header));
+   if(!*m_target)
+   {
+      m_output << "Failed to write archive" << std::endl;
+      return -1;
+   }
+
+   return 0;
+}
+
+int PfsTarSink::write_entry_header(const std::string& path, std::uint64_t size, char type)
+{
+   std::string name = path;
+   if(type == TAR_TYPE_DIRECTORY)
+      name += "/";
+
+   //ustar can keep up to 100 characters of name and 155 characters of directory prefix
+   bool fits = name.size() <= TAR_NAME_SIZE;
+   if(!fits && name.size() <= TAR_PREFIX_SIZE + 1 + TAR_NAME_SIZE)
+   {
+      std::size_t pos = name.find('/', name.size() - TAR_NAME_SIZE - 1);
+      fits = pos != std::string::npos && pos <= TAR_PREFIX_SIZE && pos + 1 < name.size();
+   }
+
+   if(!fits)
+   {
+      //gnu extension: name is stored as data of preceding entry
+      if(write_header("././@LongLink", name.size() + 1, TAR_TYPE_GNU_LONGNAME) < 0)
+         return -1;
+
+      m_target->write(name.c_str(), name.size() + 1);
+
+      if(write_padding(name.size() + 1) < 0)
+         return -1;
+
+      name = name.substr(0, TAR_NAME_SIZE);
+   }
+
+   return write_header(name, size, type);
+}
+
+int PfsTarSink::write_padding(std::uint64_t size)
+{
+   static const char zeros[PFS_TAR_BLOCK_SIZE] = {0};
+
+   std::uint64_t tail = size % PFS_TAR_BLOCK_SIZE;
+   if(tail != 0)
+      m_target->write(zeros, PFS_TAR_BLOCK_SIZE - tail);
+
+   if(!*m_target)
+   {
+      m_output << "Failed to write archive" << std::endl;
+      return -1;
+   }
+
+   return 0;
+}
+
+int PfsTarSink::create_directory(const std::string& path)
+{
+   if(m_inEntry)
+      return -1;
+
+   return write_entry_header(path, 0, TAR_TYPE_DIRECTORY);
+}
+
+std::ostream* PfsTarSink::begin_file(const std::string& path, std::uint64_t size)
+{
+   if(m_inEntry)
+      return 0;
+
+   if(write_entry_header(path, size, TAR_TYPE_FILE) < 0)
+      return 0;
+
+   m_entryBuf.reset(m_target, size);
+   m_entryStream.clear();
+   m_entrySize = size;
+   m_inEntry = true;
+
+   return &m_entryStream;
+}
+
+int PfsTarSink::end_file()
+{
+   if(!m_inEntry)
+      return -1;
+
+   m_inEntry = false;
+
+   //archive is broken if entry is shorter than its header says
+   if(!m_entryStream || m_entryBuf.left() != 0)
+   {
+      m_output << "Size of archive entry does not match size of the file" << std::endl;
+      return -1;
+   }
+
+   return write_padding(m_entrySize);
+}
+
+int PfsTarSink::finish()
+{
+   //end of archive is marked with two zero blocks
+   static const char zeros[PFS_TAR_BLOCK_SIZE * 2] = {0};
+
+   m_target->write(zeros, sizeof(zeros));
+   m_target->flush();
+
+   if(!*m_target)
+   {
+      m_output << "Failed to write archive" << std::endl;
+      return -1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <fstream>
+#include <streambuf>
+
+#include "IPfsOutputSink.h"
+#include "LocalFilesystem.h"
+
+#define PFS_TAR_BLOCK_SIZE 0x200
+
+//writes title as ustar archive to a file or to any stream (like stdout)
+//archive is written strictly sequentially so it can be piped. size of every file has to be known before its data
+//names longer than ustar allows are stored with gnu long name records, files of 8 GB and more use base-256 size
+//timestamps and owners are zero so same title always gives same archive
+class PfsTarSink : public IPfsOutputSink
+{
+private:
+   //passes data of current entry to the archive and makes sure that it does not exceed entry size
+   class entry_buf_t : public std::streambuf
+   {
+   private:
+      std::ostream* m_target;
+      std::uint64_t m_left;
+
+   public:
+      entry_buf_t();
+
+   public:
+      void reset(std::ostream* target, std::uint64_t size);
+
+      std::uint64_t left() const
+      {
+         return m_left;
+      }
+
+   protected:
+      std::streamsize xsputn(const char* s, std::streamsize n) override;
+
+      int_type overflow(int_type c) override;
+   };
+
+private:
+   std::ostream& m_output;
+
+   std::ofstream m_file;
+   std::ostream* m_target;
+
+   entry_buf_t m_entryBuf;
+   std::ostream m_entryStream;
+
+   std::uint64_t m_entrySize;
+   bool m_inEntry;
+
+public:
+   //archive is written to the file
+   PfsTarSink(const psvpfs::path& filepath, std::ostream& output);
+
+   //archive is written to the stream that has to outlive the sink
+   PfsTarSink(std::ostream& target, std::ostream& output);
+
+private:
+   int write_header(const std::string& name, std::uint64_t size, char type);
+
+   int write_entry_header(const std::string& path, std::uint64_t size, char type);
+
+   int write_padding(std::uint64_t size);
+
+public:
+   int create_directory(const std::string& path) override;
+
+   std::ostream* begin_file(const std::string& path, std::uint64_t size) override;
+
+   int end_file() override;
+
+   int finish() override;
+};
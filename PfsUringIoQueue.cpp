@@ -0,0 +1,355 @@
+#include "PfsUringIoQueue.h"
+
+#include <cstring>
+#include <algorithm>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define PFS_HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+PfsUringIoQueue::PfsUringIoQueue(std::uint32_t depth, std::size_t bufferSize)
+   : m_depth(depth), m_bufferSize(bufferSize),
+     m_stride((bufferSize + PFS_IO_BUFFER_ALIGNMENT - 1) & ~static_cast<std::size_t>(PFS_IO_BUFFER_ALIGNMENT - 1)), m_pool(0), m_requests(depth), m_iovecs(0),
+     m_ringFd(-1), m_fixedBuffers(false), m_nPrepared(0), m_nInFlight(0),
+     m_sqRing(0), m_sqRingSize(0), m_cqRing(0), m_cqRingSize(0), m_sqes(0), m_sqesSize(0),
+     m_sqHead(0), m_sqTail(0), m_sqMask(0), m_sqEntries(0), m_sqArray(0),
+     m_cqHead(0), m_cqTail(0), m_cqMask(0), m_cqes(0)
+{
+}
+
+PfsUringIoQueue::~PfsUringIoQueue()
+{
+   //kernel may still write to the pool so requests are completed before it is unmapped
+   std::uint32_t index;
+   std::int64_t result;
+   while(m_ringFd >= 0 && (m_nInFlight > 0 || m_nPrepared > 0) && wait(index, result) == 0);
+
+   release();
+}
+
+bool PfsUringIoQueue::is_supported()
+{
+#ifdef PFS_HAVE_IO_URING
+   return true;
+#else
+   return false;
+#endif
+}
+
+int PfsUringIoQueue::setup()
+{
+#ifdef PFS_HAVE_IO_URING
+   if(m_ringFd >= 0)
+      return 0;
+
+   io_uring_params params;
+   memset(&params, 0, sizeof(io_uring_params));
+
+   int fd = static_cast<int>(syscall(__NR_io_uring_setup, m_depth, &params));
+   if(fd < 0)
+      return -1;
+
+   m_ringFd = fd;
+
+   //map submission queue, completion queue and array of submission entries
+
+   m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+   m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+   bool singleMap = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+   singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+#endif
+
+   if(singleMap)
+      m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+
+   m_sqRing = mmap(0, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQ_RING);
+   if(m_sqRing == MAP_FAILED)
+   {
+      m_sqRing = 0;
+      release();
+      return -1;
+   }
+
+   if(singleMap)
+   {
+      m_cqRing = m_sqRing;
+   }
+   else
+   {
+      m_cqRing = mmap(0, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_CQ_RING);
+      if(m_cqRing == MAP_FAILED)
+      {
+         m_cqRing = 0;
+         release();
+         return -1;
+      }
+   }
+
+   m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+   m_sqes = mmap(0, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQES);
+   if(m_sqes == MAP_FAILED)
+   {
+      m_sqes = 0;
+      release();
+      return -1;
+   }
+
+   std::uint8_t* sq = static_cast<std::uint8_t*>(m_sqRing);
+   m_sqHead = reinterpret_cast<std::uint32_t*>(sq + params.sq_off.head);
+   m_sqTail = reinterpret_cast<std::uint32_t*>(sq + params.sq_off.tail);
+   m_sqMask = *reinterpret_cast<std::uint32_t*>(sq + params.sq_off.ring_mask);
+   m_sqEntries = *reinterpret_cast<std::uint32_t*>(sq + params.sq_off.ring_entries);
+   m_sqArray = reinterpret_cast<std::uint32_t*>(sq + params.sq_off.array);
+
+   std::uint8_t* cq = static_cast<std::uint8_t*>(m_cqRing);
+   m_cqHead = reinterpret_cast<std::uint32_t*>(cq + params.cq_off.head);
+   m_cqTail = reinterpret_cast<std::uint32_t*>(cq + params.cq_off.tail);
+   m_cqMask = *reinterpret_cast<std::uint32_t*>(cq + params.cq_off.ring_mask);
+   m_cqes = cq + params.cq_off.cqes;
+
+   //pool is mapped so that every buffer is page aligned
+
+   m_pool = static_cast<std::uint8_t*>(mmap(0, static_cast<std::size_t>(m_depth) * m_stride, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+   if(m_pool == MAP_FAILED)
+   {
+      m_pool = 0;
+      release();
+      return -1;
+   }
+
+   iovec* iovecs = new iovec[m_depth];
+   for(std::uint32_t i = 0; i < m_depth; i++)
+   {
+      iovecs[i].iov_base = buffer(i);
+      iovecs[i].iov_len = m_bufferSize;
+   }
+   m_iovecs = iovecs;
+
+   //registration pins the pool. it fails if pool is over memlock limit and then buffers are passed with every request
+   m_fixedBuffers = syscall(__NR_io_uring_register, m_ringFd, IORING_REGISTER_BUFFERS, iovecs, m_depth) == 0;
+
+   return 0;
+#else
+   return -1;
+#endif
+}
+
+void PfsUringIoQueue::release()
+{
+#ifdef PFS_HAVE_IO_URING
+   if(m_pool)
+      munmap(m_pool, static_cast<std::size_t>(m_depth) * m_stride);
+   if(m_sqes)
+      munmap(m_sqes, m_sqesSize);
+   if(m_cqRing && m_cqRing != m_sqRing)
+      munmap(m_cqRing, m_cqRingSize);
+   if(m_sqRing)
+      munmap(m_sqRing, m_sqRingSize);
+   if(m_ringFd >= 0)
+      close(m_ringFd);
+
+   delete[] static_cast<iovec*>(m_iovecs);
+#endif
+
+   m_pool = 0;
+   m_iovecs = 0;
+   m_sqes = 0;
+   m_cqRing = 0;
+   m_sqRing = 0;
+   m_ringFd = -1;
+}
+
+std::uint8_t* PfsUringIoQueue::buffer(std::uint32_t index)
+{
+   return m_pool + static_cast<std::size_t>(index) * m_stride;
+}
+
+int PfsUringIoQueue::prep_read(int fd, std::uint32_t index, std::uint64_t offset, std::size_t size)
+{
+   if(index >= m_depth || size > m_bufferSize)
+      return -1;
+
+   io_request_t& request = m_requests[index];
+   request.write = false;
+   request.fd = fd;
+   request.offset = offset;
+   request.size = size;
+   request.done = 0;
+
+   return prep(index);
+}
+
+int PfsUringIoQueue::prep_write(int fd, std::uint32_t index, std::uint64_t offset, std::size_t size)
+{
+   if(index >= m_depth || size > m_bufferSize)
+      return -1;
+
+   io_request_t& request = m_requests[index];
+   request.write = true;
+   request.fd = fd;
+   request.offset = offset;
+   request.size = size;
+   request.done = 0;
+
+   return prep(index);
+}
+
+//puts remaining part of the request of buffer index to submission queue
+int PfsUringIoQueue::prep(std::uint32_t index)
+{
+#ifdef PFS_HAVE_IO_URING
+   if(m_ringFd < 0)
+      return -1;
+
+   const io_request_t& request = m_requests[index];
+
+   //only this thread moves the tail. head is moved by the kernel
+   std::uint32_t tail = *m_sqTail;
+   std::uint32_t head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+   if(tail - head >= m_sqEntries)
+      return -1;
+
+   std::uint32_t slot = tail & m_sqMask;
+   io_uring_sqe* sqe = static_cast<io_uring_sqe*>(m_sqes) + slot;
+   memset(sqe, 0, sizeof(io_uring_sqe));
+
+   std::uint8_t* data = buffer(index) + request.done;
+   std::size_t size = request.size - request.done;
+
+   if(m_fixedBuffers)
+   {
+      sqe->opcode = request.write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+      sqe->addr = reinterpret_cast<std::uint64_t>(data);
+      sqe->len = static_cast<std::uint32_t>(size);
+      sqe->buf_index = static_cast<std::uint16_t>(index);
+   }
+   else
+   {
+      iovec* iov = static_cast<iovec*>(m_iovecs) + index;
+      iov->iov_base = data;
+      iov->iov_len = size;
+
+      sqe->opcode = request.write ? IORING_OP_WRITEV : IORING_OP_READV;
+      sqe->addr = reinterpret_cast<std::uint64_t>(iov);
+      sqe->len = 1;
+   }
+
+   sqe->fd = request.fd;
+   sqe->off = request.offset + request.done;
+   sqe->user_data = index;
+
+   m_sqArray[slot] = slot;
+   __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+
+   m_nPrepared++;
+
+   return 0;
+#else
+   (void)index;
+   return -1;
+#endif
+}
+
+int PfsUringIoQueue::enter(std::uint32_t toSubmit, std::uint32_t minComplete)
+{
+#ifdef PFS_HAVE_IO_URING
+   while(true)
+   {
+      long res = syscall(__NR_io_uring_enter, m_ringFd, toSubmit, minComplete, minComplete > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+      if(res < 0)
+      {
+         if(errno == EINTR)
+            continue;
+         return -1;
+      }
+
+      m_nPrepared -= static_cast<std::uint32_t>(res);
+      m_nInFlight += static_cast<std::uint32_t>(res);
+      return 0;
+   }
+#else
+   (void)toSubmit;
+   (void)minComplete;
+   return -1;
+#endif
+}
+
+int PfsUringIoQueue::submit()
+{
+   if(m_nPrepared == 0)
+      return 0;
+
+   return enter(m_nPrepared, 0);
+}
+
+int PfsUringIoQueue::wait(std::uint32_t& index, std::int64_t& result)
+{
+#ifdef PFS_HAVE_IO_URING
+   while(true)
+   {
+      if(m_nInFlight == 0 && m_nPrepared == 0)
+         return -1;
+
+      //only this thread moves the head. tail is moved by the kernel
+      std::uint32_t head = *m_cqHead;
+      std::uint32_t tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+      if(head == tail)
+      {
+         //prepared requests are submitted in the same call
+         if(enter(m_nPrepared, 1) < 0)
+            return -1;
+         continue;
+      }
+
+      const io_uring_cqe* cqe = static_cast<const io_uring_cqe*>(m_cqes) + (head & m_cqMask);
+      std::uint32_t completed = static_cast<std::uint32_t>(cqe->user_data);
+      std::int32_t res = cqe->res;
+
+      __atomic_store_n(m_cqHead, head + 1, __ATOMIC_RELEASE);
+      m_nInFlight--;
+
+      io_request_t& request = m_requests[completed];
+
+      //interrupted requests are restarted
+      if(res == -EINTR || res == -EAGAIN)
+      {
+         if(prep(completed) < 0)
+            return -1;
+         continue;
+      }
+
+      if(res > 0)
+      {
+         request.done += res;
+
+         //rest of short transfer
+         if(request.done < request.size)
+         {
+            if(prep(completed) < 0)
+               return -1;
+            continue;
+         }
+      }
+
+      index = completed;
+      result = res < 0 ? res : static_cast<std::int64_t>(request.done);
+      return 0;
+   }
+#else
+   (void)index;
+   (void)result;
+   return -1;
+#endif
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "IPfsIoQueue.h"
+
+//linux io_uring queue driven by raw system calls (no liburing dependency)
+//all requests prepared before submit() are started with single system call and run concurrently
+//pool buffers are registered with the kernel when memlock limit allows it so that they are not mapped on every request
+//short transfers are continued internally so completion always covers whole request or reaches end of file
+class PfsUringIoQueue : public IPfsIoQueue
+{
+private:
+   //state of request of one buffer
+   struct io_request_t
+   {
+      bool write;
+      int fd;
+      std::uint64_t offset;
+      std::size_t size;
+      std::size_t done;
+   };
+
+private:
+   std::uint32_t m_depth;
+   std::size_t m_bufferSize;
+   std::size_t m_stride; //distance between buffers. keeps every buffer aligned
+   std::uint8_t* m_pool; //page aligned
+   std::vector<io_request_t> m_requests;
+   void* m_iovecs; //iovec of every buffer
+
+private:
+   int m_ringFd;
+   bool m_fixedBuffers;
+   std::uint32_t m_nPrepared;
+   std::uint32_t m_nInFlight;
+
+   void* m_sqRing;
+   std::size_t m_sqRingSize;
+   void* m_cqRing;
+   std::size_t m_cqRingSize;
+   void* m_sqes;
+   std::size_t m_sqesSize;
+
+   std::uint32_t* m_sqHead;
+   std::uint32_t* m_sqTail;
+   std::uint32_t m_sqMask;
+   std::uint32_t m_sqEntries;
+   std::uint32_t* m_sqArray;
+
+   std::uint32_t* m_cqHead;
+   std::uint32_t* m_cqTail;
+   std::uint32_t m_cqMask;
+   void* m_cqes;
+
+public:
+   PfsUringIoQueue(std::uint32_t depth, std::size_t bufferSize);
+
+   PfsUringIoQueue(const PfsUringIoQueue&) = delete;
+
+   PfsUringIoQueue& operator=(const PfsUringIoQueue&) = delete;
+
+   ~PfsUringIoQueue();
+
+public:
+   //creates the ring. fails if kernel does not support io_uring or it is blocked
+   int setup();
+
+   //true if io_uring can be used on this platform at all
+   static bool is_supported();
+
+public:
+   std::uint32_t depth() const override
+   {
+      return m_depth;
+   }
+
+   std::size_t buffer_size() const override
+   {
+      return m_bufferSize;
+   }
+
+   std::uint8_t* buffer(std::uint32_t index) override;
+
+public:
+   int prep_read(int fd, std::uint32_t index, std::uint64_t offset, std::size_t size) override;
+
+   int prep_write(int fd, std::uint32_t index, std::uint64_t offset, std::size_t size) override;
+
+   int submit() override;
+
+   int wait(std::uint32_t& index, std::int64_t& result) override;
+
+private:
+   int prep(std::uint32_t index);
+
+   int enter(std::uint32_t toSubmit, std::uint32_t minComplete);
+
+   void release();
+};
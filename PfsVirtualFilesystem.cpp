@@ -0,0 +1,298 @@
+#include "PfsVirtualFilesystem.h"
+
+#include "CryptoOperationsFactory.h"
+#include "F00DKeyEncryptorFactory.h"
+
+#include <algorithm>
+#include <cctype>
+
+static std::string to_uppercase_copy(const std::string& str)
+{
+   std::string result = str;
+   std::transform(result.begin(), result.end(), result.begin(), static_cast<int (*)(int)>(std::toupper));
+   return result;
+}
+
+PfsVirtualFilesystem::PfsVirtualFilesystem(const PfsFilesystem& fs, std::shared_ptr<PfsSectorCache> cache)
+   : m_fs(fs), m_output(fs.m_output), m_cache(cache), m_nextHandle(0)
+{
+}
+
+//converts path to form "/dir/file" that is used as a key
+std::string PfsVirtualFilesystem::normalize_path(const std::string& path) const
+{
+   std::string result;
+   result.reserve(path.size() + 1);
+
+   for(char c : path)
+   {
+      if(c == '\\')
+         c = '/';
+
+      //skip duplicate separators
+      if(c == '/' && !result.empty() && result.back() == '/')
+         continue;
+
+      result.push_back(c);
+   }
+
+   if(result.empty() || result.front() != '/')
+      result.insert(result.begin(), '/');
+
+   if(result.size() > 1 && result.back() == '/')
+      result.pop_back();
+
+   return result;
+}
+
+//converts virtual path from files.db to path relative to title root
+std::string PfsVirtualFilesystem::junction_to_path(const sce_junction& junction) const
+{
+   std::string value = junction.get_value().generic_string();
+   std::string root = m_fs.m_titleIdPath.generic_string();
+
+   if(value.size() >= root.size() && to_uppercase_copy(value.substr(0, root.size())) == to_uppercase_copy(root))
+      value = value.substr(root.size());
+
+   return normalize_path(value);
+}
+
+//adds node with all parent directories that do not exist yet. path has to be normalized
+PfsVirtualFilesystem::vfs_node_t* PfsVirtualFilesystem::add_node(const std::string& path, bool is_directory)
+{
+   std::string key = to_uppercase_copy(path);
+
+   auto it = m_nodes.find(key);
+   if(it != m_nodes.end())
+      return it->second.get();
+
+   if(path == "/")
+   {
+      vfs_node_t* root = new vfs_node_t(std::string(), true);
+      m_nodes.insert(std::make_pair(key, std::unique_ptr<vfs_node_t>(root)));
+      return root;
+   }
+
+   std::size_t pos = path.rfind('/');
+   std::string parentPath = (pos == 0) ? std::string("/") : path.substr(0, pos);
+   std::string name = path.substr(pos + 1);
+
+   vfs_node_t* parent = add_node(parentPath, true);
+   if(!parent->is_directory)
+   {
+      m_output << "Parent of " << path << " is not a directory" << std::endl;
+      return 0;
+   }
+
+   parent->children.push_back(name);
+
+   vfs_node_t* node = new vfs_node_t(name, is_directory);
+   m_nodes.insert(std::make_pair(key, std::unique_ptr<vfs_node_t>(node)));
+   return node;
+}
+
+PfsVirtualFilesystem::vfs_node_t* PfsVirtualFilesystem::find_node(const std::string& path) const
+{
+   auto it = m_nodes.find(to_uppercase_copy(normalize_path(path)));
+   if(it == m_nodes.end())
+      return 0;
+   return it->second.get();
+}
+
+PfsVirtualFilesystem::vfs_node_t* PfsVirtualFilesystem::find_handle(int handle) const
+{
+   std::lock_guard<std::mutex> guard(m_handleMutex);
+
+   auto it = m_handles.find(handle);
+   if(it == m_handles.end())
+      return 0;
+   return it->second;
+}
+
+int PfsVirtualFilesystem::mount()
+{
+   const sce_ng_pfs_header_t& ngpfs = m_fs.m_filesDbParser->get_header();
+   const std::vector<sce_ng_pfs_file_t>& files = m_fs.m_filesDbParser->get_files();
+   const std::vector<sce_ng_pfs_dir_t>& dirs = m_fs.m_filesDbParser->get_dirs();
+
+   const std::unique_ptr<sce_idb_base_t>& unicv = m_fs.m_unicvDbParser->get_idatabase();
+
+   const std::map<std::uint32_t, sce_junction>& pageMap = m_fs.m_pageMapper->get_pageMap();
+
+   m_nodes.clear();
+
+   //files are read concurrently and every encrypted sector goes through F00D
+   m_iF00D = m_fs.m_iF00D;
+   if(!m_iF00D->is_thread_safe())
+      m_iF00D = F00DKeyEncryptorFactory::create(F00DEncryptorTypes::native_concurrent, CryptoOperationsTypes::openssl);
+
+   add_node("/", true);
+
+   //build directory tree
+
+   for(auto& d : dirs)
+   {
+      if(m_fs.is_filtered() && !m_fs.m_filter->match(m_fs.m_titleIdPath, d.path().get_value()))
+         continue;
+
+      if(!add_node(junction_to_path(d.path()), true))
+         return -1;
+   }
+
+   for(auto& f : files)
+   {
+      if(is_directory(f.file.m_info.header.type) || is_unexisting(f.file.m_info.header.type))
+         continue;
+
+      if(m_fs.is_filtered() && !m_fs.m_filter->match(m_fs.m_titleIdPath, f.path().get_value()))
+         continue;
+
+      vfs_node_t* node = add_node(junction_to_path(f.path()), false);
+      if(!node || node->is_directory)
+      {
+         m_output << "Failed to add file " << f.path() << std::endl;
+         return -1;
+      }
+
+      node->file = &f;
+      node->size = f.file.m_info.header.size;
+   }
+
+   //link files that have data with real files
+
+   for(auto& t : unicv->m_tables)
+   {
+      //skip empty files and directories
+      if(t->get_header()->get_numSectors() == 0)
+         continue;
+
+      //find filepath by salt (filename for icv.db or page for unicv.db)
+      auto map_entry = pageMap.find(t->get_icv_salt());
+      if(map_entry == pageMap.end())
+      {
+         //tables of files that are filtered out are not mapped
+         if(m_fs.is_filtered())
+            continue;
+
+         m_output << "failed to find page " << t->get_icv_salt() << " in map" << std::endl;
+         return -1;
+      }
+
+      const sce_junction& filepath = map_entry->second;
+
+      vfs_node_t* node = find_node(junction_to_path(filepath));
+      if(!node || node->is_directory || !node->file)
+      {
+         m_output << "failed to find file " << filepath << " in flat file list" << std::endl;
+         return -1;
+      }
+
+      node->filepath = &filepath;
+
+      if(is_unencrypted(node->file->file.m_info.header.type))
+      {
+         node->size = node->file->file.m_info.header.size;
+      }
+      else if(is_encrypted(node->file->file.m_info.header.type))
+      {
+         //crypto operations keep internal contexts and can not be shared between files that are read concurrently
+         std::shared_ptr<ICryptoOperations> cryptops = CryptoOperationsFactory::create(CryptoOperationsTypes::openssl);
+
+         node->pfsFile = std::unique_ptr<PfsFile>(new PfsFile(cryptops, m_iF00D, m_fs.m_keyRing, m_output, m_fs.m_klicensee, m_fs.m_titleIdPath, *node->file, filepath, ngpfs, t));
+         node->pfsFile->set_sector_cache(m_cache);
+         node->size = node->pfsFile->size();
+      }
+      else
+      {
+         m_output << "Unexpected file type" << std::endl;
+         return -1;
+      }
+   }
+
+   return 0;
+}
+
+int PfsVirtualFilesystem::stat(const std::string& path, pfs_vfs_stat_t& st) const
+{
+   vfs_node_t* node = find_node(path);
+   if(!node)
+      return -1;
+
+   st.is_directory = node->is_directory;
+   st.size = node->size;
+   return 0;
+}
+
+int PfsVirtualFilesystem::readdir(const std::string& path, std::vector<std::string>& entries) const
+{
+   vfs_node_t* node = find_node(path);
+   if(!node || !node->is_directory)
+      return -1;
+
+   entries = node->children;
+   return 0;
+}
+
+int PfsVirtualFilesystem::open(const std::string& path) const
+{
+   vfs_node_t* node = find_node(path);
+   if(!node || node->is_directory)
+      return -1;
+
+   std::lock_guard<std::mutex> guard(m_handleMutex);
+
+   int handle = m_nextHandle++;
+   m_handles.insert(std::make_pair(handle, node));
+   return handle;
+}
+
+int PfsVirtualFilesystem::close(int handle) const
+{
+   std::lock_guard<std::mutex> guard(m_handleMutex);
+
+   if(m_handles.erase(handle) == 0)
+      return -1;
+   return 0;
+}
+
+std::int64_t PfsVirtualFilesystem::pread(int handle, unsigned char* buffer, std::uint32_t size, std::uint64_t offset) const
+{
+   vfs_node_t* node = find_handle(handle);
+   if(!node)
+      return -1;
+
+   if(offset >= node->size || size == 0)
+      return 0;
+
+   if(size > node->size - offset)
+      size = static_cast<std::uint32_t>(node->size - offset);
+
+   //encrypted files are decrypted on demand sector by sector
+   if(node->pfsFile)
+      return node->pfsFile->read(offset, size, buffer);
+
+   //file has size but is not linked to real file
+   if(!node->filepath)
+   {
+      m_output << "File is not mapped" << std::endl;
+      return -1;
+   }
+
+   //unencrypted files are read directly
+   std::lock_guard<std::mutex> guard(node->streamMutex);
+
+   if(!node->stream.is_open())
+   {
+      if(!node->filepath->open(node->stream))
+      {
+         m_output << "Failed to open " << *node->filepath << std::endl;
+         return -1;
+      }
+   }
+
+   node->stream.clear();
+   node->stream.seekg(offset);
+   node->stream.read((char*)buffer, size);
+
+   return node->stream.gcount();
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+
+#include <memory>
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "PfsFilesystem.h"
+#include "PfsFile.h"
+#include "PfsSectorCache.h"
+
+struct pfs_vfs_stat_t
+{
+   bool is_directory;
+   std::uint64_t size;
+};
+
+//read only view of mounted PfsFilesystem
+//paths are relative to title root, use '/' as separator and are case insensitive (same as in decrypt_files)
+//all public methods are safe to call from multiple threads after mount
+class PfsVirtualFilesystem
+{
+private:
+   struct vfs_node_t
+   {
+      std::string name; //original name of the entry as it is in files.db
+      bool is_directory;
+      std::uint64_t size;
+      std::vector<std::string> children; //original names of child entries
+
+      const sce_ng_pfs_file_t* file;
+      const sce_junction* filepath; //junction linked to real file
+      std::unique_ptr<PfsFile> pfsFile; //only for encrypted files
+
+      std::mutex streamMutex; //only for unencrypted files
+      std::ifstream stream;
+
+      vfs_node_t(const std::string& n, bool dir)
+         : name(n), is_directory(dir), size(0), file(0), filepath(0)
+      {
+      }
+   };
+
+private:
+   const PfsFilesystem& m_fs;
+   std::ostream& m_output;
+   std::shared_ptr<IF00DKeyEncryptor> m_iF00D; //encryptor of the file system or its thread safe replacement
+   std::shared_ptr<PfsSectorCache> m_cache;
+
+private:
+   std::map<std::string, std::unique_ptr<vfs_node_t> > m_nodes; //key is normalized path
+
+private:
+   mutable std::mutex m_handleMutex;
+   mutable std::map<int, vfs_node_t*> m_handles;
+   mutable int m_nextHandle;
+
+public:
+   //file system has to be mounted and stay alive while this object is used
+   //cache is optional and is shared by all encrypted files of the title
+   PfsVirtualFilesystem(const PfsFilesystem& fs, std::shared_ptr<PfsSectorCache> cache = nullptr);
+
+private:
+   std::string normalize_path(const std::string& path) const;
+
+   std::string junction_to_path(const sce_junction& junction) const;
+
+   vfs_node_t* add_node(const std::string& path, bool is_directory);
+
+   vfs_node_t* find_node(const std::string& path) const;
+
+   vfs_node_t* find_handle(int handle) const;
+
+public:
+   //builds directory tree from files.db
+   //encryptor of the file system is replaced with thread safe one if it does not support concurrent calls
+   int mount();
+
+public:
+   int stat(const std::string& path, pfs_vfs_stat_t& st) const;
+
+   int readdir(const std::string& path, std::vector<std::string>& entries) const;
+
+   //returns handle of opened file or -1 on error. directories can not be opened
+   int open(const std::string& path) const;
+
+   int close(int handle) const;
+
+   //returns number of bytes read (0 at the end of file) or -1 on error
+   std::int64_t pread(int handle, unsigned char* buffer, std::uint32_t size, std::uint64_t offset) const;
+};
@@ -3,6 +3,11 @@
 #include <fstream>
 #include <stdio.h>
 #include <iomanip>
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <atomic>
+#include <mutex>
 
 #include <zRIF/rif.h>
 #include <zRIF/licdec.h>
@@ -10,47 +15,132 @@
 #include "PfsFilesystem.h"
 
 #include "F00DKeyEncryptorFactory.h"
+#include "F00DFileKeyEncryptor.h"
 #include "CryptoOperationsFactory.h"
 #include "PsvPfsParserConfig.h"
 #include "LocalKeyGenerator.h"
+#include "WorkerPool.h"
+#include "PfsTarSink.h"
 
-int execute(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, const unsigned char *klicensee, const psvpfs::path& titleIdPath, const psvpfs::path& destTitleIdPath) {
-    PfsFilesystem pfs(cryptops, iF00D, std::cout, klicensee, titleIdPath);
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+//destination that means tar archive written to stdout
+#define STDOUT_DESTINATION "-"
+
+static bool is_stdout_destination(const psvpfs::path &destTitleIdPath) {
+    return destTitleIdPath.generic_string() == STDOUT_DESTINATION;
+}
+
+static bool is_tar_destination(const psvpfs::path &destTitleIdPath) {
+    if (is_stdout_destination(destTitleIdPath))
+        return true;
+
+    std::string extension = destTitleIdPath.extension().generic_string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), static_cast<int (*)(int)>(std::tolower));
+    return extension == ".tar";
+}
+
+static int execute_title(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, const unsigned char *klicensee, const psvpfs::path& titleIdPath, const psvpfs::path& destTitleIdPath, std::ostream &output, PfsIoQueueTypes ioType, PfsCacheModes cacheMode,
+                         std::uint32_t shardIndex, std::uint32_t shardCount, bool verifyOutputs, bool merge) {
+    PfsFilesystem pfs(cryptops, iF00D, output, klicensee, titleIdPath);
+    pfs.set_io_queue_type(ioType);
+    pfs.set_cache_mode(cacheMode);
+    pfs.set_verify_outputs(verifyOutputs);
+    pfs.set_shard(shardIndex, shardCount);
 
     if (pfs.mount() < 0)
         return -1;
 
+    //nothing is extracted. manifests of all shards together have to cover every file of the title
+    if (merge) {
+        if (is_tar_destination(destTitleIdPath)) {
+            output << "Archive can not be merged" << std::endl;
+            return -1;
+        }
+
+        if (pfs.merge_shards(destTitleIdPath, shardCount) < 0)
+            return -1;
+
+        output << "keystone sanity check..." << std::endl;
+
+        return get_keystone(cryptops, destTitleIdPath, output) < 0 ? -1 : 0;
+    }
+
+    //archive is written sequentially in files.db order
+    if (is_tar_destination(destTitleIdPath)) {
+        if (pfs.is_sharded()) {
+            output << "Archive can not be split between shards" << std::endl;
+            return -1;
+        }
+
+        std::shared_ptr<IPfsOutputSink> sink;
+        if (is_stdout_destination(destTitleIdPath))
+            sink = std::make_shared<PfsTarSink>(std::cout, output);
+        else
+            sink = std::make_shared<PfsTarSink>(destTitleIdPath, output);
+
+        if (pfs.extract_files(sink) < 0)
+            return -1;
+
+        output << "keystone sanity check is skipped for archive" << std::endl;
+        return 0;
+    }
+
     if (pfs.decrypt_files(destTitleIdPath) < 0)
         return -1;
 
-    std::cout << "keystone sanity check..." << std::endl;
+    //keystone may be written by other shard
+    if (pfs.is_sharded()) {
+        output << "keystone sanity check is done by merge of shards" << std::endl;
+        return 0;
+    }
+
+    output << "keystone sanity check..." << std::endl;
 
-    if (get_keystone(cryptops, destTitleIdPath) < 0)
+    if (get_keystone(cryptops, destTitleIdPath, output) < 0)
         return -1;
 
-    std::cout << "F00D cache:" << std::endl;
-    iF00D->print_cache(std::cout);
+    return 0;
+}
+
+int execute(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, const unsigned char *klicensee, const psvpfs::path& titleIdPath, const psvpfs::path& destTitleIdPath, PfsIoQueueTypes ioType, PfsCacheModes cacheMode, bool verifyOutputs) {
+    //stdout carries archive so log goes to stderr
+    std::ostream &output = is_stdout_destination(destTitleIdPath) ? std::cerr : std::cout;
+
+#ifdef _WIN32
+    if (is_stdout_destination(destTitleIdPath))
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    if (execute_title(cryptops, iF00D, klicensee, titleIdPath, destTitleIdPath, output, ioType, cacheMode, 0, 1, verifyOutputs, false) < 0)
+        return -1;
+
+    output << "F00D cache:" << std::endl;
+    iF00D->print_cache(output);
 
     return 0;
 }
 
-int extract_klicensee(const PsvPfsParserConfig &cfg, std::shared_ptr<ICryptoOperations> cryptops, unsigned char *klicensee) {
+int extract_klicensee(const PsvPfsParserConfig &cfg, std::shared_ptr<ICryptoOperations> cryptops, unsigned char *klicensee, std::ostream &output) {
     if (cfg.klicensee.length() > 0) {
         if (string_to_byte_array(cfg.klicensee, 0x10, klicensee) < 0) {
-            std::cout << "Failed to parse klicensee" << std::endl;
+            output << "Failed to parse klicensee" << std::endl;
             return -1;
         }
     } else if (cfg.zRIF.length() > 0) {
         std::shared_ptr<SceNpDrmLicense> lic = decode_license_np(cfg.zRIF);
         if (!lic) {
-            std::cout << "Failed to decode zRIF string" << std::endl;
+            output << "Failed to decode zRIF string" << std::endl;
             return -1;
         }
         memcpy(klicensee, lic->key, 0x10);
     } else {
-        std::cout << "using sealedkey..." << std::endl;
+        output << "using sealedkey..." << std::endl;
 
-        if (get_sealedkey(cryptops, cfg.title_id_src, klicensee) < 0)
+        if (get_sealedkey(cryptops, cfg.title_id_src, klicensee, output) < 0)
             return -1;
     }
 
@@ -67,6 +157,9 @@ std::shared_ptr<IF00DKeyEncryptor> create_F00D_encryptor(const PsvPfsParserConfi
     case F00DEncryptorTypes::native:
         iF00D = F00DKeyEncryptorFactory::create(cfg.f00d_enc_type, cryptops);
         break;
+    case F00DEncryptorTypes::native_concurrent:
+        iF00D = F00DKeyEncryptorFactory::create(cfg.f00d_enc_type, CryptoOperationsTypes::openssl);
+        break;
     default:
         throw std::runtime_error("unexpected F00DEncryptorTypes value");
     }
@@ -74,7 +167,25 @@ std::shared_ptr<IF00DKeyEncryptor> create_F00D_encryptor(const PsvPfsParserConfi
     return iF00D;
 }
 
-int execute(std::string &zrif, std::string &title_src, std::string &title_dst, F00DEncryptorTypes type, std::string &f00d_arg) {
+int convert_F00D_cache(const std::string &f00d_cache, const std::string &binary_cache) {
+    if (psvpfs::path(binary_cache).extension() != ".bin") {
+        std::cout << "Binary F00D cache has to have .bin extension to be recognized: " << binary_cache << std::endl;
+        return -1;
+    }
+
+    F00DFileKeyEncryptor iF00D(f00d_cache);
+    if (iF00D.save_binary_cache(binary_cache) < 0) {
+        std::cout << "Failed to convert F00D cache " << f00d_cache << " to " << binary_cache << std::endl;
+        return -1;
+    }
+
+    std::cout << "F00D cache " << f00d_cache << " is saved to " << binary_cache << std::endl;
+    iF00D.print_cache(std::cout);
+
+    return 0;
+}
+
+int execute(std::string &zrif, std::string &title_src, std::string &title_dst, F00DEncryptorTypes type, std::string &f00d_arg, PfsIoQueueTypes ioType, PfsCacheModes cacheMode, bool verifyOutputs) {
     PsvPfsParserConfig cfg;
 
     cfg.zRIF = zrif;
@@ -82,12 +193,170 @@ int execute(std::string &zrif, std::string &title_src, std::string &title_dst, F
     cfg.title_id_dst = title_dst;
     cfg.f00d_enc_type = type;
     cfg.f00d_arg = f00d_arg;
+    cfg.io_type = ioType;
+    cfg.cache_mode = cacheMode;
+    cfg.verify_outputs = verifyOutputs;
+
+    return execute(cfg);
+}
+
+int execute(const PsvPfsParserConfig &cfg) {
     std::shared_ptr<ICryptoOperations> cryptops = CryptoOperationsFactory::create(CryptoOperationsTypes::openssl);
     std::shared_ptr<IF00DKeyEncryptor> iF00D = create_F00D_encryptor(cfg, cryptops);
 
+    //stdout carries archive so log goes to stderr
+    std::ostream &output = is_stdout_destination(cfg.title_id_dst) ? std::cerr : std::cout;
+
     unsigned char klicensee[0x10] = { 0 };
-    if (extract_klicensee(cfg, cryptops, klicensee) < 0)
+    if (extract_klicensee(cfg, cryptops, klicensee, output) < 0)
         return -1;
 
-    return execute(cryptops, iF00D, klicensee, psvpfs::path{cfg.title_id_src}, psvpfs::path{cfg.title_id_dst});
+    return execute(cryptops, iF00D, klicensee, psvpfs::path{cfg.title_id_src}, psvpfs::path{cfg.title_id_dst}, cfg.io_type, cfg.cache_mode, cfg.verify_outputs);
+}
+
+static bool is_klicensee_string(const std::string &str) {
+    if (str.length() != 0x20)
+        return false;
+
+    for (char c : str) {
+        if (!isxdigit(static_cast<unsigned char>(c)))
+            return false;
+    }
+
+    return true;
+}
+
+int load_batch_file(const std::string &filepath, std::vector<PsvPfsParserConfig> &jobs) {
+    std::ifstream inputStream(filepath.c_str());
+    if (!inputStream.is_open()) {
+        std::cout << "Failed to open " << filepath << std::endl;
+        return -1;
+    }
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(inputStream, line); lineNumber++) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        std::vector<std::string> fields;
+        if (line.find('\t') != std::string::npos) {
+            //paths may contain spaces
+            std::istringstream ss(line);
+            std::string field;
+            while (std::getline(ss, field, '\t')) {
+                if (!field.empty())
+                    fields.push_back(field);
+            }
+        } else {
+            std::istringstream ss(line);
+            std::string field;
+            while (ss >> field)
+                fields.push_back(field);
+        }
+
+        if (fields.empty() || fields[0][0] == '#')
+            continue;
+
+        if (fields.size() < 2 || fields.size() > 3) {
+            std::cout << "Invalid job at line " << lineNumber << " of " << filepath << std::endl;
+            return -1;
+        }
+
+        PsvPfsParserConfig cfg;
+        cfg.title_id_src = fields[0];
+        cfg.title_id_dst = fields[1];
+
+        //sealedkey is used if there is no key
+        if (fields.size() > 2) {
+            if (is_klicensee_string(fields[2]))
+                cfg.klicensee = fields[2];
+            else
+                cfg.zRIF = fields[2];
+        }
+
+        jobs.push_back(cfg);
+    }
+
+    return 0;
+}
+
+int execute_batch(const std::vector<PsvPfsParserConfig> &jobs, F00DEncryptorTypes type, const std::string &f00d_arg, std::size_t nThreads,
+                  std::uint32_t shardIndex, std::uint32_t shardCount, PfsIoQueueTypes ioType, PfsCacheModes cacheMode, bool verifyOutputs, bool merge) {
+    //every title is split by its own files.db so every process computes the same split
+    if (shardCount > 1 && !merge)
+        std::cout << "Extracting shard " << shardIndex << "/" << shardCount << " of every title" << std::endl;
+
+    if (jobs.empty())
+        return 0;
+
+    //titles are processed concurrently and native encryptor is not thread safe
+    if (type == F00DEncryptorTypes::native)
+        type = F00DEncryptorTypes::native_concurrent;
+
+    PsvPfsParserConfig f00dCfg;
+    f00dCfg.f00d_enc_type = type;
+    f00dCfg.f00d_arg = f00d_arg;
+
+    std::shared_ptr<IF00DKeyEncryptor> iF00D = create_F00D_encryptor(f00dCfg, CryptoOperationsFactory::create(CryptoOperationsTypes::openssl));
+
+    if (nThreads == 0)
+        nThreads = WorkerPool::default_concurrency();
+
+    if (nThreads > jobs.size())
+        nThreads = jobs.size();
+
+    std::atomic<std::size_t> next(0);
+    std::atomic<int> nFailed(0);
+    std::mutex outputMutex;
+
+    //each lane takes next title when it is done with previous one
+    auto lane = [&](std::size_t) {
+        //crypto operations keep internal contexts so they are not shared between lanes
+        std::shared_ptr<ICryptoOperations> cryptops = CryptoOperationsFactory::create(CryptoOperationsTypes::openssl);
+
+        for (std::size_t i = next.fetch_add(1); i < jobs.size(); i = next.fetch_add(1)) {
+            const PsvPfsParserConfig &job = jobs[i];
+
+            //output of the title is printed at once so that titles do not interleave
+            std::ostringstream output;
+
+            int res = -1;
+            try {
+                unsigned char klicensee[0x10] = { 0 };
+                if (is_stdout_destination(job.title_id_dst)) {
+                    output << "Archive can not be written to stdout in batch mode" << std::endl;
+                } else if (extract_klicensee(job, cryptops, klicensee, output) >= 0) {
+                    psvpfs::path titleIdPath(job.title_id_src);
+                    psvpfs::path destTitleIdPath(job.title_id_dst);
+
+                    res = execute_title(cryptops, iF00D, klicensee, titleIdPath, destTitleIdPath, output, ioType, cacheMode, shardIndex, shardCount, verifyOutputs, merge);
+                }
+            } catch (std::exception &e) {
+                output << e.what() << std::endl;
+            }
+
+            if (res < 0)
+                nFailed++;
+
+            std::lock_guard<std::mutex> guard(outputMutex);
+
+            std::cout << "[" << (i + 1) << "/" << jobs.size() << "] " << job.title_id_src << " -> " << job.title_id_dst << std::endl;
+            std::cout << output.str();
+            std::cout << "[" << (i + 1) << "/" << jobs.size() << "] " << (res < 0 ? "Failed: " : "Done: ") << job.title_id_src << std::endl;
+        }
+    };
+
+    if (nThreads > 1) {
+        WorkerPool pool(nThreads - 1);
+        pool.parallel_for(nThreads, lane);
+    } else {
+        lane(0);
+    }
+
+    std::cout << (merge ? "Checked " : "Processed ") << jobs.size() << " titles, " << nFailed << " failed" << std::endl;
+
+    std::cout << "F00D cache:" << std::endl;
+    iF00D->print_cache(std::cout);
+
+    return nFailed;
 }
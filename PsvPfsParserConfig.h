@@ -1,8 +1,13 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <ostream>
+#include <vector>
 
 #include "F00DKeyEncryptorFactory.h"
+#include "PfsIoQueueFactory.h"
+#include "PfsCacheControl.h"
 
 struct PsvPfsParserConfig {
     std::string title_id_src;
@@ -11,6 +16,42 @@ struct PsvPfsParserConfig {
     std::string zRIF;
     F00DEncryptorTypes f00d_enc_type;
     std::string f00d_arg;
+    std::string batch_file; //list of jobs for batch mode
+    std::size_t threads = 0; //number of titles processed at once in batch mode. 0 means number of hardware threads
+    std::uint32_t shard_index = 0; //only files of this shard are extracted from every title in batch mode
+    std::uint32_t shard_count = 1;
+    PfsIoQueueTypes io_type = PfsIoQueueTypes::sync; //how files are read and written
+    PfsCacheModes cache_mode = PfsCacheModes::buffered; //how page cache is used for files of the title
+    bool verify_outputs = false; //files completed by previous run are rehashed on resume instead of trusting size and salt
+    bool merge = false; //manifests of shard_count shards are merged and checked instead of extraction in batch mode
+    std::string f00d_cache_bin; //F00D cache is converted to binary cache at this path instead of extraction
 };
 
-int execute(std::string &zrif, std::string &title_src, std::string &title_dst, F00DEncryptorTypes type, std::string &f00d_arg);
+int extract_klicensee(const PsvPfsParserConfig &cfg, std::shared_ptr<ICryptoOperations> cryptops, unsigned char *klicensee, std::ostream &output);
+
+std::shared_ptr<IF00DKeyEncryptor> create_F00D_encryptor(const PsvPfsParserConfig &cfg, std::shared_ptr<ICryptoOperations> cryptops);
+
+//loads F00D cache in any supported format and saves it as binary (.bin) cache that is mapped in place on load
+int convert_F00D_cache(const std::string &f00d_cache, const std::string &binary_cache);
+
+int execute(std::string &zrif, std::string &title_src, std::string &title_dst, F00DEncryptorTypes type, std::string &f00d_arg, PfsIoQueueTypes ioType = PfsIoQueueTypes::sync,
+            PfsCacheModes cacheMode = PfsCacheModes::buffered, bool verifyOutputs = false);
+
+//extracts single title. key is taken from klicensee, zRIF or sealedkey in this order
+int execute(const PsvPfsParserConfig &cfg);
+
+//reads list of jobs for batch mode. one job per line: "<title_id_src> <title_id_dst> [klicensee or zRIF]"
+//fields are separated by tabs if line has any, otherwise by spaces. empty lines and lines starting with # are ignored
+int load_batch_file(const std::string &filepath, std::vector<PsvPfsParserConfig> &jobs);
+
+//extracts all titles in one process. titles are processed concurrently by shared worker pool
+//so that mount of one title overlaps with decryption of another
+//F00D encryptor (and its cache) is shared by all titles, crypto operations are created once per worker
+//0 threads means number of hardware threads. returns number of titles that failed
+//files of every title are split between shardCount processes (see PfsFilesystem::set_shard) and only files of shardIndex are extracted
+//keystone is checked and archives are only written when titles are not sharded
+//merge extracts nothing. it checks that shardCount shards together cover all files of every title and merges their manifests
+//it is run once after all shards are done
+int execute_batch(const std::vector<PsvPfsParserConfig> &jobs, F00DEncryptorTypes type, const std::string &f00d_arg, std::size_t nThreads = 0,
+                  std::uint32_t shardIndex = 0, std::uint32_t shardCount = 1, PfsIoQueueTypes ioType = PfsIoQueueTypes::sync,
+                  PfsCacheModes cacheMode = PfsCacheModes::buffered, bool verifyOutputs = false, bool merge = false);
@@ -10,6 +10,5 @@ int SceKernelUtilsForDriver_sceSha1DigestForDriver(std::shared_ptr<ICryptoOperat
 
 int SceKernelUtilsForDriver_sceHmacSha1DigestForDriver(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* key, int key_len, const unsigned char* data, int data_len, unsigned char digest[0x14])
 {
-   cryptops->hmac_sha1(data, digest, data_len, key, key_len);
-   return 0;
+   return SceKernelUtilsForDriver_sceHmacSha1DigestForDriver(PfsCryptoContext<ICryptoOperations>(cryptops.get(), nullptr), key, key_len, data, data_len, digest);
 }
\ No newline at end of file
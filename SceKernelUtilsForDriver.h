@@ -4,7 +4,16 @@
 #include <memory>
 
 #include "ICryptoOperations.h"
+#include "PfsCryptoContext.h"
 
 int SceKernelUtilsForDriver_sceSha1DigestForDriver(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char *source, int size, unsigned char result[0x14]);
 
-int SceKernelUtilsForDriver_sceHmacSha1DigestForDriver(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* key, int key_len, const unsigned char* data, int data_len, unsigned char digest[0x14]);
\ No newline at end of file
+int SceKernelUtilsForDriver_sceHmacSha1DigestForDriver(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* key, int key_len, const unsigned char* data, int data_len, unsigned char digest[0x14]);
+
+//non-owning variant that is used in inner loops of crypt engine
+template<typename TCryptoOperations>
+int SceKernelUtilsForDriver_sceHmacSha1DigestForDriver(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* key, int key_len, const unsigned char* data, int data_len, unsigned char digest[0x14])
+{
+   ctx.cryptops()->hmac_sha1(data, digest, data_len, key, key_len);
+   return 0;
+}
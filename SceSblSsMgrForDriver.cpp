@@ -7,17 +7,7 @@
 //this function is tested and works
 int SceSblSsMgrForDriver_sceSblSsMgrAESCBCDecryptWithKeygenForDriver(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, const unsigned char* src, unsigned char* dst, int size, const unsigned char* key, int key_size, unsigned char* iv, std::uint16_t key_id, int mask_enable)
 {
-   if(mask_enable != 1)
-      throw std::runtime_error("Unexpected mask_enable");
-
-   if(key_id != 0)
-      throw std::runtime_error("Unexpected key_id");
-
-   unsigned char drv_key[0x20] = {0}; //use max possible buffer
-   if(iF00D->encrypt_key(key, key_size, drv_key) < 0)
-      return -1;
-
-   return cryptops->aes_cbc_decrypt(src, dst, size, drv_key, key_size, iv);
+   return SceSblSsMgrForDriver_sceSblSsMgrAESCBCDecryptWithKeygenForDriver(PfsCryptoContext<ICryptoOperations>(cryptops.get(), iF00D.get()), src, dst, size, key, key_size, iv, key_id, mask_enable);
 }
 
 //this function is tested and works
@@ -39,17 +29,7 @@ int SceSblSsMgrForDriver_sceSblSsMgrAESCBCEncryptWithKeygenForDriver(std::shared
 //this function is tested and works
 int SceSblSsMgrForDriver_sceSblSsMgrAESECBEncryptWithKeygenForDriver(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, const unsigned char* src, unsigned char* dst, int size, const unsigned char* key, int key_size, std::uint16_t key_id, int mask_enable)
 {
-   if(mask_enable != 1)
-      throw std::runtime_error("Unexpected mask_enable");
-
-   if(key_id != 0)
-      throw std::runtime_error("Unexpected key_id");
-
-   unsigned char drv_key[0x20] = {0}; //use max possible buffer
-   if(iF00D->encrypt_key(key, key_size, drv_key) < 0)
-      return -1;
-
-   return cryptops->aes_ecb_encrypt(src, dst, size, drv_key, key_size);
+   return SceSblSsMgrForDriver_sceSblSsMgrAESECBEncryptWithKeygenForDriver(PfsCryptoContext<ICryptoOperations>(cryptops.get(), iF00D.get()), src, dst, size, key, key_size, key_id, mask_enable);
 }
 
 //##### NORMAL CRYPTO FUNCTIONS #####
@@ -59,12 +39,7 @@ int SceSblSsMgrForDriver_sceSblSsMgrAESECBEncryptWithKeygenForDriver(std::shared
 //not tested
 int SceSblSsMgrForDriver_sceSblSsMgrAESCBCDecryptForDriver(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* src, unsigned char* dst, int size, const unsigned char* key, int key_size, unsigned char* iv, int mask_enable)
 {
-   throw std::runtime_error("not tested");
-
-   if(mask_enable != 1)
-      throw std::runtime_error("Unexpected mask_enable");
-
-   return cryptops->aes_cbc_decrypt(src, dst, size, key, key_size, iv);
+   return SceSblSsMgrForDriver_sceSblSsMgrAESCBCDecryptForDriver(PfsCryptoContext<ICryptoOperations>(cryptops.get(), nullptr), src, dst, size, key, key_size, iv, mask_enable);
 }
 
 //not tested
@@ -83,12 +58,7 @@ int SceSblSsMgrForDriver_sceSblSsMgrAESCBCEncryptForDriver(std::shared_ptr<ICryp
 //not tested
 int SceSblSsMgrForDriver_sceSblSsMgrAESECBEncryptForDriver(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* src, unsigned char* dst, int size, const unsigned char* key, int key_size, int mask_enable)
 {
-   throw std::runtime_error("not tested");
-
-   if(mask_enable != 1)
-      throw std::runtime_error("Unexpected mask_enable");
-
-   return cryptops->aes_ecb_encrypt(src, dst, size, key, key_size);
+   return SceSblSsMgrForDriver_sceSblSsMgrAESECBEncryptForDriver(PfsCryptoContext<ICryptoOperations>(cryptops.get(), nullptr), src, dst, size, key, key_size, mask_enable);
 }
 
 //ECB works on block data - which means that data has to be padded (most likely with zeroes)
@@ -98,10 +68,7 @@ int SceSblSsMgrForDriver_sceSblSsMgrAESECBEncryptForDriver(std::shared_ptr<ICryp
 //this function is tested and works
 int SceSblSsMgrForDriver_sceSblSsMgrAESECBDecryptForDriver(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* src, unsigned char* dst, int size, const unsigned char* key, int key_size, int mask_enable)
 {
-   if(mask_enable != 1)
-      throw std::runtime_error("Unexpected mask_enable");
-
-   return cryptops->aes_ecb_decrypt(src, dst, size, key, key_size);
+   return SceSblSsMgrForDriver_sceSblSsMgrAESECBDecryptForDriver(PfsCryptoContext<ICryptoOperations>(cryptops.get(), nullptr), src, dst, size, key, key_size, mask_enable);
 }
 
 //##### CMAC FUNCTIONS #####
@@ -152,14 +119,5 @@ int SceSblSsMgrForDriver_sceSblSsMgrAESCMACWithKeygenForDriver(std::shared_ptr<I
 //this function is tested and works
 int SceSblSsMgrForDriver_sceSblSsMgrHMACSHA1ForDriver(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* src, unsigned char* dst, int size, const unsigned char* key, unsigned char* iv, int mask_enable, int command_bit)
 {
-   if(iv != 0)
-      throw std::runtime_error("unsupported iv");
-
-   if(mask_enable != 1)
-      throw std::runtime_error("unsupported mask_enable");
-
-   if(command_bit != 0)
-      throw std::runtime_error("unsupported command_bit");
-
-   return cryptops->hmac_sha1(src, dst, size, key, 0x14);
+   return SceSblSsMgrForDriver_sceSblSsMgrHMACSHA1ForDriver(PfsCryptoContext<ICryptoOperations>(cryptops.get(), nullptr), src, dst, size, key, iv, mask_enable, command_bit);
 }
\ No newline at end of file
@@ -2,9 +2,11 @@
 
 #include <cstdint>
 #include <memory>
+#include <stdexcept>
 
 #include "IF00DKeyEncryptor.h"
 #include "ICryptoOperations.h"
+#include "PfsCryptoContext.h"
 
 int SceSblSsMgrForDriver_sceSblSsMgrAESCBCDecryptWithKeygenForDriver(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, const unsigned char* src, unsigned char* dst, int size, const unsigned char* key, int key_size, unsigned char* iv, std::uint16_t key_id, int mask_enable);
 
@@ -24,4 +26,93 @@ int SceSblSsMgrForDriver_sceSblSsMgrAESCMACForDriver(std::shared_ptr<ICryptoOper
 
 int SceSblSsMgrForDriver_sceSblSsMgrAESCMACWithKeygenForDriver(std::shared_ptr<ICryptoOperations> cryptops, std::shared_ptr<IF00DKeyEncryptor> iF00D, const unsigned char* src, unsigned char dst[0x10], int size, const unsigned char* key, int key_size, unsigned char* iv, std::uint16_t key_id, int mask_enable, int command_bit);
 
-int SceSblSsMgrForDriver_sceSblSsMgrHMACSHA1ForDriver(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* src, unsigned char* dst, int size, const unsigned char* key, unsigned char* iv, int mask_enable, int command_bit);
\ No newline at end of file
+int SceSblSsMgrForDriver_sceSblSsMgrHMACSHA1ForDriver(std::shared_ptr<ICryptoOperations> cryptops, const unsigned char* src, unsigned char* dst, int size, const unsigned char* key, unsigned char* iv, int mask_enable, int command_bit);
+
+//##### NON-OWNING VARIANTS #####
+
+//these variants are used in inner loops of crypt engine
+//functions above forward to them with PfsCryptoContext<ICryptoOperations>
+
+//this function is tested and works
+template<typename TCryptoOperations>
+int SceSblSsMgrForDriver_sceSblSsMgrAESCBCDecryptWithKeygenForDriver(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* src, unsigned char* dst, int size, const unsigned char* key, int key_size, unsigned char* iv, std::uint16_t key_id, int mask_enable)
+{
+   if(mask_enable != 1)
+      throw std::runtime_error("Unexpected mask_enable");
+
+   if(key_id != 0)
+      throw std::runtime_error("Unexpected key_id");
+
+   unsigned char drv_key[0x20] = {0}; //use max possible buffer
+   if(ctx.iF00D()->encrypt_key(key, key_size, drv_key) < 0)
+      return -1;
+
+   return ctx.cryptops()->aes_cbc_decrypt(src, dst, size, drv_key, key_size, iv);
+}
+
+//this function is tested and works
+template<typename TCryptoOperations>
+int SceSblSsMgrForDriver_sceSblSsMgrAESECBEncryptWithKeygenForDriver(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* src, unsigned char* dst, int size, const unsigned char* key, int key_size, std::uint16_t key_id, int mask_enable)
+{
+   if(mask_enable != 1)
+      throw std::runtime_error("Unexpected mask_enable");
+
+   if(key_id != 0)
+      throw std::runtime_error("Unexpected key_id");
+
+   unsigned char drv_key[0x20] = {0}; //use max possible buffer
+   if(ctx.iF00D()->encrypt_key(key, key_size, drv_key) < 0)
+      return -1;
+
+   return ctx.cryptops()->aes_ecb_encrypt(src, dst, size, drv_key, key_size);
+}
+
+//not tested
+template<typename TCryptoOperations>
+int SceSblSsMgrForDriver_sceSblSsMgrAESCBCDecryptForDriver(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* src, unsigned char* dst, int size, const unsigned char* key, int key_size, unsigned char* iv, int mask_enable)
+{
+   throw std::runtime_error("not tested");
+
+   if(mask_enable != 1)
+      throw std::runtime_error("Unexpected mask_enable");
+
+   return ctx.cryptops()->aes_cbc_decrypt(src, dst, size, key, key_size, iv);
+}
+
+//not tested
+template<typename TCryptoOperations>
+int SceSblSsMgrForDriver_sceSblSsMgrAESECBEncryptForDriver(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* src, unsigned char* dst, int size, const unsigned char* key, int key_size, int mask_enable)
+{
+   throw std::runtime_error("not tested");
+
+   if(mask_enable != 1)
+      throw std::runtime_error("Unexpected mask_enable");
+
+   return ctx.cryptops()->aes_ecb_encrypt(src, dst, size, key, key_size);
+}
+
+//this function is tested and works
+template<typename TCryptoOperations>
+int SceSblSsMgrForDriver_sceSblSsMgrAESECBDecryptForDriver(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* src, unsigned char* dst, int size, const unsigned char* key, int key_size, int mask_enable)
+{
+   if(mask_enable != 1)
+      throw std::runtime_error("Unexpected mask_enable");
+
+   return ctx.cryptops()->aes_ecb_decrypt(src, dst, size, key, key_size);
+}
+
+//this function is tested and works
+template<typename TCryptoOperations>
+int SceSblSsMgrForDriver_sceSblSsMgrHMACSHA1ForDriver(const PfsCryptoContext<TCryptoOperations>& ctx, const unsigned char* src, unsigned char* dst, int size, const unsigned char* key, unsigned char* iv, int mask_enable, int command_bit)
+{
+   if(iv != 0)
+      throw std::runtime_error("unsupported iv");
+
+   if(mask_enable != 1)
+      throw std::runtime_error("unsupported mask_enable");
+
+   if(command_bit != 0)
+      throw std::runtime_error("unsupported command_bit");
+
+   return ctx.cryptops()->hmac_sha1(src, dst, size, key, 0x14);
+}
@@ -8,8 +8,8 @@
 
 #include "UnicvDbTypes.h"
 
-UnicvDbParser::UnicvDbParser(const psvpfs::path& titleIdPath, std::ostream& output)
-   : m_titleIdPath(titleIdPath), m_output(output)
+UnicvDbParser::UnicvDbParser(const psvpfs::path& titleIdPath, std::ostream& output, bool lazy)
+   : m_titleIdPath(titleIdPath), m_output(output), m_lazy(lazy)
 {
 }
 
@@ -35,7 +35,7 @@ int UnicvDbParser::parse()
       {
          m_output << "parsing  icv.db..." << std::endl;
 
-         m_fdb = std::unique_ptr<sce_idb_base_t>(new sce_icvdb_t(m_output));
+         m_fdb = std::unique_ptr<sce_idb_base_t>(new sce_icvdb_t(m_output, m_lazy));
          if(!m_fdb->read(filepath2))
             return -1;
 
@@ -46,7 +46,7 @@ int UnicvDbParser::parse()
    {
       m_output << "parsing  unicv.db..." << std::endl;
 
-      m_fdb = std::unique_ptr<sce_idb_base_t>(new sce_irodb_t(m_output));
+      m_fdb = std::unique_ptr<sce_idb_base_t>(new sce_irodb_t(m_output, m_lazy));
       if(!m_fdb->read(filepath))
          return -1;
 
@@ -12,8 +12,11 @@ private:
    std::unique_ptr<sce_idb_base_t> m_fdb;
    std::ostream& m_output;
 
+   bool m_lazy;
+
 public:
-   UnicvDbParser(const psvpfs::path& titleIdPath, std::ostream& output);
+   //in lazy mode only table headers are parsed and signature blocks are loaded on first access
+   UnicvDbParser(const psvpfs::path& titleIdPath, std::ostream& output, bool lazy = false);
 
 public:
    int parse();
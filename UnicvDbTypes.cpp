@@ -1,10 +1,12 @@
 #include <iostream>
+#include <algorithm>
 
 #include "UnicvDbTypes.h"
 
 #include "UnicvDbUtils.h"
 #include "Utils.h"
 #include "HashTree.h"
+#include "WorkerPool.h"
 
 bool sce_irodb_header_proxy_t::validate(std::uint64_t fileSize) const
 {
@@ -51,15 +53,19 @@ bool sce_irodb_header_proxy_t::validate(std::uint64_t fileSize) const
    return true;
 }
 
-bool sce_irodb_header_proxy_t::read(std::ifstream& inputStream, std::uint64_t fileSize)
+bool sce_irodb_header_proxy_t::read(MappedFileView& inputView, std::uint64_t fileSize)
 {
    //read header
-   inputStream.read((char*)&m_header, sizeof(sce_irodb_header_t));
+   if(!inputView.read(&m_header, sizeof(sce_irodb_header_t)))
+   {
+      m_output << "Unexpected end of file" << std::endl;
+      return false;
+   }
 
    if(!validate(fileSize))
       return false;
 
-   inputStream.seekg(m_header.blockSize, std::ios::beg); //skip header
+   inputView.seek(m_header.blockSize); //skip header
 
    return true;
 }
@@ -98,46 +104,60 @@ bool sig_tbl_header_base_t::validate(std::shared_ptr<sce_iftbl_base_t> fft, std:
    return true;
 }
 
-bool sig_tbl_header_base_t::read(std::ifstream& inputStream, std::shared_ptr<sce_iftbl_base_t> fft, std::uint32_t sizeCheck, std::vector<icv>& signatures)
+bool sig_tbl_header_base_t::read(MappedFileView& inputView, std::shared_ptr<sce_iftbl_base_t> fft, std::uint32_t sizeCheck, std::vector<icv>& signatures)
 {
    //read header
-   inputStream.read((char*)&m_header, sizeof(sig_tbl_header_t));
+   if(!inputView.read(&m_header, sizeof(sig_tbl_header_t)))
+   {
+      m_output << "Unexpected end of file" << std::endl;
+      return false;
+   }
 
    //validate header
    if(!validate(fft, sizeCheck))
       return false;
 
-   //read signatures
+   //view all signatures at once
+   const std::uint8_t* sigData = inputView.view(static_cast<std::uint64_t>(m_header.nSignatures) * m_header.sigSize);
+   if(sigData == nullptr)
+   {
+      m_output << "Unexpected end of file" << std::endl;
+      return false;
+   }
+
+   //copy signatures
+   signatures.reserve(signatures.size() + m_header.nSignatures);
    for(std::uint32_t c = 0; c < m_header.nSignatures; c++)
    {
       signatures.push_back(icv());
       icv& dte = signatures.back();
-      dte.m_data.resize(m_header.sigSize);
-      inputStream.read((char*)dte.m_data.data(), m_header.sigSize);
+      dte.m_data.assign(sigData, sigData + m_header.sigSize);
+      sigData += m_header.sigSize;
    }
 
    //calculate size of tail data - this data should be zero padding
    //instead of skipping it is validated here that it contains only zeroes
-   std::uint64_t cp = inputStream.tellg();
+   std::uint64_t cp = inputView.tell();
    std::uint64_t dsize = cp % fft->get_header()->get_pageSize(); //calc size of data that was read
    std::uint64_t tail = fft->get_header()->get_pageSize() - dsize; //calc size of tail data
 
-   //read tail data
-   std::vector<std::uint8_t> data(static_cast<std::vector<std::uint8_t>::size_type>(tail));
-   inputStream.read((char*)data.data(), tail);
-
-   //fast way would be to use seek
-   //inputStream.seekg(tail, std::ios::cur);
+   //view tail data in place
+   const std::uint8_t* data = inputView.view(tail);
+   if(data == nullptr)
+   {
+      m_output << "Unexpected end of file" << std::endl;
+      return false;
+   }
 
    //validate tail in specific class
-   return validate_tail(fft, data);
+   return validate_tail(fft, data, tail);
 }
 
 
-bool sig_tbl_header_normal_t::validate_tail(std::shared_ptr<sce_iftbl_base_t> fft, const std::vector<std::uint8_t>& data) const
+bool sig_tbl_header_normal_t::validate_tail(std::shared_ptr<sce_iftbl_base_t> fft, const std::uint8_t* data, std::uint64_t size) const
 {
    //validate tail data
-   if(!isZeroVector(data))
+   if(!isZeroVector(data, data + size))
    {
       m_output << "Unexpected data instead of padding" << std::endl;
       return false;
@@ -146,40 +166,44 @@ bool sig_tbl_header_normal_t::validate_tail(std::shared_ptr<sce_iftbl_base_t> ff
    return true;
 }
 
-bool sig_tbl_header_merkle_t::read(std::ifstream& inputStream, std::shared_ptr<sce_iftbl_base_t> fft, std::uint32_t sizeCheck, std::vector<icv>& signatures)
+bool sig_tbl_header_merkle_t::read(MappedFileView& inputView, std::shared_ptr<sce_iftbl_base_t> fft, std::uint32_t sizeCheck, std::vector<icv>& signatures)
 {
    //read weird 0x10 byte zero header which makes the data not being aligned on page boder
-   unsigned char zero_header[0x10];
-   inputStream.read((char*)zero_header, 0x10);
-   if(!isZeroVector(zero_header, zero_header + 0x10))
+   const std::uint8_t* zero_header = inputView.view(0x10);
+   if(zero_header == nullptr || !isZeroVector(zero_header, zero_header + 0x10))
    {
       m_output << "Invalid zero vector" << std::endl;
       return false;
    }
 
-   return sig_tbl_header_base_t::read(inputStream, fft, sizeCheck, signatures);
+   return sig_tbl_header_base_t::read(inputView, fft, sizeCheck, signatures);
 }
 
-bool sig_tbl_header_merkle_t::validate_tail(std::shared_ptr<sce_iftbl_base_t> fft, const std::vector<std::uint8_t>& data) const
+bool sig_tbl_header_merkle_t::validate_tail(std::shared_ptr<sce_iftbl_base_t> fft, const std::uint8_t* data, std::uint64_t size) const
 {
-   std::vector<std::uint8_t> data_copy(data);
+   //there should be one 0xFFFFFFFF value per sector at the end of the tail
+   std::uint64_t unk_value_offset = size - 0x5C;
+   std::uint64_t unk_value_size = static_cast<std::uint64_t>(fft->get_header()->get_numSectors()) * sizeof(std::uint32_t);
 
-   uint32_t* unk_value_base = (uint32_t*)(data_copy.data() + (data_copy.size() - 0x5C));
+   if(size < 0x5C || unk_value_size > 0x5C)
+   {
+      m_output << "Unexpected value in signature table tail" << std::endl;
+      return false;
+   }
 
-   //there should be one 0xFFFFFFFF value per sector
-   for(std::uint32_t i = 0; i < fft->get_header()->get_numSectors(); i++)
+   //0xFFFFFFFF values are checked bytewise so that data does not have to be copied and aligned
+   const std::uint8_t* unk_value_base = data + unk_value_offset;
+   for(std::uint64_t i = 0; i < unk_value_size; i++)
    {
-      if(*(unk_value_base + i) != 0xFFFFFFFF)
+      if(unk_value_base[i] != 0xFF)
       {
          m_output << "Unexpected value in signature table tail" << std::endl;
          return false;
       }
-
-      *(unk_value_base + i) = 0; //clear that value
    }
 
-   //after 0xFFFFFFFF values are cleared - everything should be zeroes (including all other data)
-   if(!isZeroVector(data_copy))
+   //everything else should be zeroes (including all other data)
+   if(!isZeroVector(data, unk_value_base) || !isZeroVector(unk_value_base + unk_value_size, data + size))
    {
       m_output << "Invalid zero vector" << std::endl;
       return false;
@@ -238,9 +262,13 @@ bool sce_iftbl_header_proxy_t::validate() const
    return true;
 }
 
-bool sce_iftbl_header_proxy_t::read(std::ifstream& inputStream)
+bool sce_iftbl_header_proxy_t::read(MappedFileView& inputView)
 {
-   inputStream.read((char*)&m_header, sizeof(sce_iftbl_header_t));
+   if(!inputView.read(&m_header, sizeof(sce_iftbl_header_t)))
+   {
+      m_output << "Unexpected end of file" << std::endl;
+      return false;
+   }
    return true;
 }
 
@@ -298,13 +326,16 @@ bool sce_icvdb_header_proxy_t::validate() const
    return true;
 }
 
-bool sce_icvdb_header_proxy_t::read(std::ifstream& inputStream)
+bool sce_icvdb_header_proxy_t::read(MappedFileView& inputView)
 {
-   inputStream.seekg(0, std::ios::end);
-   m_realDataSize = inputStream.tellg();
-   inputStream.seekg(0, std::ios::beg);
+   m_realDataSize = inputView.size();
+   inputView.seek(0);
 
-   inputStream.read((char*)&m_header, sizeof(sce_icvdb_header_t));
+   if(!inputView.read(&m_header, sizeof(sce_icvdb_header_t)))
+   {
+      m_output << "Unexpected end of file" << std::endl;
+      return false;
+   }
 
    return true;
 }
@@ -345,9 +376,13 @@ bool sce_inull_header_proxy_t::validate() const
    return true;
 }
 
-bool sce_inull_header_proxy_t::read(std::ifstream& inputStream)
+bool sce_inull_header_proxy_t::read(MappedFileView& inputView)
 {
-   inputStream.read((char*)&m_header, sizeof(sce_inull_header_t));
+   if(!inputView.read(&m_header, sizeof(sce_inull_header_t)))
+   {
+      m_output << "Unexpected end of file" << std::endl;
+      return false;
+   }
    return true;
 }
 
@@ -391,10 +426,10 @@ std::shared_ptr<sce_iftbl_base_t> magic_to_ftbl(std::string type, std::ostream&
 
 //===========
 
-bool sce_iftbl_base_t::read(std::ifstream& inputStream, std::uint64_t& index, std::uint32_t icv_salt)
+bool sce_iftbl_base_t::read(MappedFileView& inputView, std::uint64_t& index, std::uint32_t icv_salt)
 {
    //read header
-   if(!m_header->read(inputStream))
+   if(!m_header->read(inputView))
       return false;
 
    //validate header
@@ -404,47 +439,123 @@ bool sce_iftbl_base_t::read(std::ifstream& inputStream, std::uint64_t& index, st
    return true;
 }
 
-bool sce_iftbl_base_t::read_block(std::ifstream& inputStream, std::uint64_t& index, std::uint32_t sizeCheck)
+bool sce_iftbl_base_t::read_block(MappedFileView& inputView, std::uint64_t& index, std::uint32_t sizeCheck)
 {
-   //create new signature block
-   m_blocks.push_back(sig_tbl_t(magic_to_sig_tbl(m_header->get_magic(), m_output)));
-   sig_tbl_t& fdt = m_blocks.back();
+   m_blockIndex.push_back(std::make_pair(inputView.tell(), sizeCheck));
 
-   //read and valiate signature block
-   if(!fdt.read(inputStream, shared_from_this(), sizeCheck))
-      return false;
+   if(is_lazy())
+   {
+      //only index the block - each signature block occupies exactly one page
+      if(!inputView.skip(m_header->get_pageSize()))
+      {
+         m_output << "Unexpected end of file" << std::endl;
+         return false;
+      }
+   }
+   else
+   {
+      //create new signature block
+      m_blocks.push_back(sig_tbl_t(magic_to_sig_tbl(m_header->get_magic(), m_output)));
+      sig_tbl_t& fdt = m_blocks.back();
+
+      //read and valiate signature block
+      if(!fdt.read(inputView, shared_from_this(), sizeCheck))
+         return false;
+
+      m_numLoaded = m_blocks.size();
+   }
 
    index++;
 
    return true;
 }
 
-bool sce_iftbl_cvdb_proxy_t::read(std::ifstream& inputStream, std::uint64_t& index, std::uint32_t icv_salt)
+bool sce_iftbl_base_t::post_validate_blocks()
+{
+   //lazy tables are validated when first block is loaded
+   if(is_lazy())
+      return true;
+
+   return m_header->post_validate(m_blocks);
+}
+
+bool sce_iftbl_base_t::load_blocks(std::size_t count)
+{
+   if(count > m_blockIndex.size())
+      return false;
+
+   if(m_numLoaded.load(std::memory_order_acquire) >= count)
+      return true;
+
+   std::lock_guard<std::mutex> guard(m_loadMutex);
+
+   if(m_blocks.capacity() < m_blockIndex.size())
+      m_blocks.reserve(m_blockIndex.size());
+
+   while(m_blocks.size() < count)
+   {
+      const std::pair<std::uint64_t, std::uint32_t>& entry = m_blockIndex[m_blocks.size()];
+
+      MappedFileView inputView(*m_source);
+      if(!inputView.seek(entry.first))
+      {
+         m_output << "Unexpected end of file" << std::endl;
+         return false;
+      }
+
+      sig_tbl_t fdt(magic_to_sig_tbl(m_header->get_magic(), m_output));
+
+      //read and valiate signature block
+      if(!fdt.read(inputView, shared_from_this(), entry.second))
+         return false;
+
+      //block has to end exactly on the page border that was assumed during indexing
+      if(inputView.tell() != entry.first + m_header->get_pageSize())
+      {
+         m_output << "Block misalign" << std::endl;
+         return false;
+      }
+
+      m_blocks.push_back(std::move(fdt));
+
+      //root signature is checked as soon as first block is available
+      if(m_blocks.size() == 1)
+      {
+         if(!m_header->post_validate(m_blocks))
+         {
+            m_blocks.clear();
+            return false;
+         }
+      }
+
+      m_numLoaded.store(m_blocks.size(), std::memory_order_release);
+   }
+
+   return true;
+}
+
+bool sce_iftbl_cvdb_proxy_t::read(MappedFileView& inputView, std::uint64_t& index, std::uint32_t icv_salt)
 {
-   if(!sce_iftbl_base_t::read(inputStream, index, icv_salt))
+   if(!sce_iftbl_base_t::read(inputView, index, icv_salt))
       return false;
 
    //calculate size of tail data - this data should be zero padding
    //instead of skipping it is validated here that it contains only zeroes
-   std::uint64_t cp = inputStream.tellg(); //get current pos
+   std::uint64_t cp = inputView.tell(); //get current pos
    std::uint64_t dsize = cp % m_header->get_pageSize(); //calc size of data that was read
    std::uint64_t tail = m_header->get_pageSize() - dsize; //calc size of tail data
 
-   //read tail
-   std::vector<std::uint8_t> tailData(static_cast<std::vector<std::uint8_t>::size_type>(tail));
-   inputStream.read((char*)tailData.data(), tail);
+   //view tail in place
+   const std::uint8_t* tailData = inputView.view(tail);
 
    //validate tail
-   if(!isZeroVector(tailData))
+   if(tailData == nullptr || !isZeroVector(tailData, tailData + tail))
    {
       m_output << "Unexpected data instead of padding" << std::endl;
       return false;
    }
 
-   //fast way would be to use seek
-   //inputStream.seekg(tail, std::ios::cur);
-
-   int64_t currentBlockPos = inputStream.tellg();
+   int64_t currentBlockPos = inputView.tell();
 
    m_page = off2page(currentBlockPos, m_header->get_pageSize());
 
@@ -455,10 +566,10 @@ bool sce_iftbl_cvdb_proxy_t::read(std::ifstream& inputStream, std::uint64_t& ind
    //check if there is single block read required or multiple
    if(m_header->get_numHashes() < m_header->get_binTreeNumMaxAvail())
    {
-      if(!read_block(inputStream, index, m_header->get_numHashes()))
+      if(!read_block(inputView, index, m_header->get_numHashes()))
          return false;
 
-      return m_header->post_validate(m_blocks);
+      return post_validate_blocks();
    }
    else
    {
@@ -467,17 +578,17 @@ bool sce_iftbl_cvdb_proxy_t::read(std::ifstream& inputStream, std::uint64_t& ind
 
       for(std::uint32_t dbi = 0; dbi < nDataBlocks; dbi++)
       {
-         if(!read_block(inputStream, index, m_header->get_binTreeNumMaxAvail()))
+         if(!read_block(inputView, index, m_header->get_binTreeNumMaxAvail()))
             return false;
       }
 
       if(nDataTail > 0)
       {
-         if(!read_block(inputStream, index, nDataTail))
+         if(!read_block(inputView, index, nDataTail))
             return false;
       }
 
-      return m_header->post_validate(m_blocks);
+      return post_validate_blocks();
    }
 }
 
@@ -493,10 +604,10 @@ std::uint32_t sce_icvdb_proxy_t::get_icv_salt() const
    return m_icv_salt; // icv.db uses file name as salt
 }
 
-bool sce_icvdb_proxy_t::read(std::ifstream& inputStream, std::uint64_t& index, std::uint32_t icv_salt)
+bool sce_icvdb_proxy_t::read(MappedFileView& inputView, std::uint64_t& index, std::uint32_t icv_salt)
 {
    m_icv_salt = icv_salt;
-   return sce_iftbl_cvdb_proxy_t::read(inputStream, index, icv_salt);
+   return sce_iftbl_cvdb_proxy_t::read(inputView, index, icv_salt);
 }
 
 
@@ -505,24 +616,30 @@ std::uint32_t sce_inull_proxy_t::get_icv_salt() const
    return m_icv_salt; // icv.db uses file name as salt
 }
 
-bool sce_inull_proxy_t::read(std::ifstream& inputStream, std::uint64_t& index, std::uint32_t icv_salt)
+bool sce_inull_proxy_t::read(MappedFileView& inputView, std::uint64_t& index, std::uint32_t icv_salt)
 {
    m_icv_salt = icv_salt;
-   return sce_iftbl_base_t::read(inputStream, index, icv_salt);
+   return sce_iftbl_base_t::read(inputView, index, icv_salt);
 }
 
 //===========
 
-bool sce_idb_base_t::read_table_item(std::ifstream& inputStream, std::uint64_t& index, std::uint32_t icv_salt)
+bool sce_idb_base_t::read_table_item(std::shared_ptr<MappedFile> inputFile, MappedFileView& inputView, std::uint64_t& index, std::uint32_t icv_salt)
 {
-   std::uint8_t magic[8];
-   inputStream.read((char*)magic, sizeof(magic));
-   inputStream.seekg(-8, std::ios::cur);
+   const std::uint8_t* magic = inputView.peek(8);
+   if(magic == nullptr)
+   {
+      m_output << "Unexpected end of file" << std::endl;
+      return false;
+   }
 
-   m_tables.push_back(magic_to_ftbl(std::string((char*)magic, sizeof(magic)), m_output));
+   m_tables.push_back(magic_to_ftbl(std::string((const char*)magic, 8), m_output));
    std::shared_ptr<sce_iftbl_base_t>& fft = m_tables.back();
 
-   if(!fft->read(inputStream, index, icv_salt))
+   if(m_lazy)
+      fft->set_lazy_source(inputFile);
+
+   if(!fft->read(inputView, index, icv_salt))
       return false;
 
    return true;
@@ -530,21 +647,23 @@ bool sce_idb_base_t::read_table_item(std::ifstream& inputStream, std::uint64_t&
 
 bool sce_irodb_t::read(psvpfs::path filepath)
 {
-   std::ifstream inputStream(filepath.generic_string().c_str(), std::ios::in | std::ios::binary);
+   //whole unicv.db is mapped into memory and parsed in place
+   //in lazy mode mapping is shared by all tables and stays alive after parsing
+   std::shared_ptr<MappedFile> inputFile = std::make_shared<MappedFile>();
 
-   if(!inputStream.is_open())
+   if(!inputFile->open(filepath))
    {
       m_output << "failed to open unicv.db file" << std::endl;
       return false;
    }
 
-   //get stream size
-   inputStream.seekg(0, std::ios::end);
-   std::uint64_t fileSize = inputStream.tellg();
-   inputStream.seekg(0, std::ios::beg);
+   MappedFileView inputView(*inputFile);
+
+   //get file size
+   std::uint64_t fileSize = inputView.size();
 
    //read header
-   if(!m_dbHeader->read(inputStream, fileSize))
+   if(!m_dbHeader->read(inputView, fileSize))
       return false;
 
    //it looks like unicv file is split into groups of SCEIFTBL chunks (blocks)
@@ -566,25 +685,30 @@ bool sce_irodb_t::read(psvpfs::path filepath)
 
    m_output << "Total blocks: " << std::dec << nBlocks << std::endl;
 
-   std::vector<std::uint8_t> blankPage(m_dbHeader->get_blockSize());
-
    //read all blocks
    for(std::uint64_t index = 0; index < nBlocks; index++)
    {
       //try to skip blank pages
-      inputStream.read((char*)blankPage.data(), m_dbHeader->get_blockSize());
-      if(isZeroVector(blankPage))
-         continue;
+      const std::uint8_t* page = inputView.peek(m_dbHeader->get_blockSize());
+      if(page == nullptr)
+      {
+         m_output << "Unexpected end of file" << std::endl;
+         return false;
+      }
 
-      inputStream.seekg(-(std::int32_t)m_dbHeader->get_blockSize(), std::ios::cur);
+      if(isZeroVector(page, page + m_dbHeader->get_blockSize()))
+      {
+         inputView.skip(m_dbHeader->get_blockSize());
+         continue;
+      }
 
       //read single block
-      if(!read_table_item(inputStream, index, 0))
+      if(!read_table_item(inputFile, inputView, index, 0))
          return false;
    }
 
    //check that there is no data left
-   std::uint64_t endp = inputStream.tellg();
+   std::uint64_t endp = inputView.tell();
    if(fileSize != endp)
    {
       m_output << "Data misalign" << std::endl;
@@ -596,17 +720,61 @@ bool sce_irodb_t::read(psvpfs::path filepath)
 
 bool sce_icvdb_t::read(psvpfs::path filepath)
 {
-   std::uint64_t index = 0;
+   //collect entries and sort them so that order of tables does not depend on directory iteration order
+   std::vector<psvpfs::path> entries;
    for(auto& entry : psvpfs::directory_iterator(filepath))
+      entries.push_back(entry.path());
+
+   std::sort(entries.begin(), entries.end());
+
+   //open and prefetch all entries concurrently - this is bound by open/read latency rather than cpu
+   std::vector<std::shared_ptr<MappedFile> > inputFiles(entries.size());
+   std::vector<std::uint8_t> openResults(entries.size(), 0);
+
+   std::size_t nThreads = (entries.size() < ICV_DB_IO_THREADS) ? entries.size() : ICV_DB_IO_THREADS;
+   if(nThreads > 1)
    {
-      std::ifstream inputStream(entry.path().generic_string().c_str(), std::ios::in | std::ios::binary);
+      WorkerPool pool(nThreads - 1);
+      pool.parallel_for(entries.size(), [&](std::size_t i)
+      {
+         inputFiles[i] = std::make_shared<MappedFile>();
+         if(inputFiles[i]->open(entries[i]))
+         {
+            inputFiles[i]->prefetch();
+            openResults[i] = 1;
+         }
+      });
+   }
+   else
+   {
+      for(std::size_t i = 0; i < entries.size(); i++)
+      {
+         inputFiles[i] = std::make_shared<MappedFile>();
+         openResults[i] = inputFiles[i]->open(entries[i]) ? 1 : 0;
+      }
+   }
 
-      std::string saltStr = entry.path().stem().generic_string();
+   //parse entries sequentially in sorted order. data is already in memory at this point
+   std::uint64_t index = 0;
+   for(std::size_t i = 0; i < entries.size(); i++)
+   {
+      if(openResults[i] == 0)
+      {
+         m_output << "failed to open " << entries[i].generic_string() << std::endl;
+         return false;
+      }
+
+      MappedFileView inputView(*inputFiles[i]);
+
+      std::string saltStr = entries[i].stem().generic_string();
       std::uint32_t saltNum =  std::stoul(saltStr, nullptr, 16);
 
       //read single block
-      if(!read_table_item(inputStream, index, saltNum))
+      if(!read_table_item(inputFiles[i], inputView, index, saltNum))
          return false;
+
+      //in eager mode mapping is not needed anymore
+      inputFiles[i].reset();
    }
    return true;
-}
\ No newline at end of file
+}
@@ -6,8 +6,11 @@
 #include <memory>
 #include <cstring>
 #include <string>
+#include <mutex>
+#include <atomic>
 
 #include "LocalFilesystem.h"
+#include "MappedFile.h"
 
 //some terms
 //SCEIRODB (magic word) - sony computer entertainment interface readonly database (unicv file)
@@ -37,6 +40,9 @@
 
 #define ICV_NUM_ENTRIES 0x2D
 
+//number of threads used to open icv.db entries concurrently
+#define ICV_DB_IO_THREADS 16
+
 #pragma pack(push, 1)
 
 //=================================================
@@ -68,7 +74,7 @@ public:
 public:
    bool validate(std::uint64_t fileSize) const;
 
-   bool read(std::ifstream& inputStream, std::uint64_t fileSize);
+   bool read(MappedFileView& inputView, std::uint64_t fileSize);
 
 public:
    std::string get_magic() const
@@ -203,9 +209,9 @@ public:
 public:
    bool validate(std::shared_ptr<sce_iftbl_base_t> fft, std::uint32_t sizeCheck) const;
 
-   virtual bool read(std::ifstream& inputStream, std::shared_ptr<sce_iftbl_base_t> fft, std::uint32_t sizeCheck, std::vector<icv>& signatures);
+   virtual bool read(MappedFileView& inputView, std::shared_ptr<sce_iftbl_base_t> fft, std::uint32_t sizeCheck, std::vector<icv>& signatures);
 
-   virtual bool validate_tail(std::shared_ptr<sce_iftbl_base_t> fft, const std::vector<std::uint8_t>& data) const = 0;
+   virtual bool validate_tail(std::shared_ptr<sce_iftbl_base_t> fft, const std::uint8_t* data, std::uint64_t size) const = 0;
 };
 
 class sig_tbl_header_normal_t : public sig_tbl_header_base_t
@@ -217,7 +223,7 @@ public:
    }
 
 public:
-   bool validate_tail(std::shared_ptr<sce_iftbl_base_t> fft, const std::vector<std::uint8_t>& data) const override;
+   bool validate_tail(std::shared_ptr<sce_iftbl_base_t> fft, const std::uint8_t* data, std::uint64_t size) const override;
 };
 
 class sig_tbl_header_merkle_t : public sig_tbl_header_base_t
@@ -229,9 +235,9 @@ public:
    }
 
 public:
-   bool read(std::ifstream& inputStream, std::shared_ptr<sce_iftbl_base_t> fft, std::uint32_t sizeCheck, std::vector<icv>& signatures) override;
+   bool read(MappedFileView& inputView, std::shared_ptr<sce_iftbl_base_t> fft, std::uint32_t sizeCheck, std::vector<icv>& signatures) override;
 
-   bool validate_tail(std::shared_ptr<sce_iftbl_base_t> fft, const std::vector<std::uint8_t>& data) const override;
+   bool validate_tail(std::shared_ptr<sce_iftbl_base_t> fft, const std::uint8_t* data, std::uint64_t size) const override;
 };
 
 //this is a signature table structure - it contains header and list of signatures
@@ -258,9 +264,9 @@ public:
       return m_header;
    }
 
-   bool read(std::ifstream& inputStream, std::shared_ptr<sce_iftbl_base_t> fft, std::uint32_t sizeCheck)
+   bool read(MappedFileView& inputView, std::shared_ptr<sce_iftbl_base_t> fft, std::uint32_t sizeCheck)
    {
-      return m_header->read(inputStream, fft, sizeCheck, m_signatures);
+      return m_header->read(inputView, fft, sizeCheck, m_signatures);
    }
 };
 
@@ -293,7 +299,7 @@ public:
 public:
    virtual bool validate() const = 0;
 
-   virtual bool read(std::ifstream& inputStream) = 0;
+   virtual bool read(MappedFileView& inputView) = 0;
 
    virtual bool post_validate(const std::vector<sig_tbl_t>& blocks) const = 0;
 };
@@ -356,7 +362,7 @@ public:
 public:
    bool validate() const override;
 
-   bool read(std::ifstream& inputStream) override;
+   bool read(MappedFileView& inputView) override;
 
    bool post_validate(const std::vector<sig_tbl_t>& blocks) const override
    {
@@ -425,7 +431,7 @@ public:
 public:
    bool validate() const override;
 
-   bool read(std::ifstream& inputStream) override;
+   bool read(MappedFileView& inputView) override;
 
    bool post_validate(const std::vector<sig_tbl_t>& blocks) const override
    {
@@ -497,7 +503,7 @@ public:
 public:
    bool validate() const override;
 
-   bool read(std::ifstream& inputStream) override;
+   bool read(MappedFileView& inputView) override;
 
    bool post_validate(const std::vector<sig_tbl_t>& blocks) const override
    {
@@ -516,8 +522,16 @@ protected:
 protected:
    std::uint32_t m_page;
 
-public:
+private:
+   //signature blocks are materialized as a prefix of m_blockIndex
+   //in eager mode all blocks are read during parsing
+   //in lazy mode only offsets are indexed and blocks are read from m_source on first access
    std::vector<sig_tbl_t> m_blocks;
+   std::vector<std::pair<std::uint64_t, std::uint32_t> > m_blockIndex; //offset of block in source file and size check
+
+   std::shared_ptr<MappedFile> m_source; //set only in lazy mode
+   std::atomic<std::size_t> m_numLoaded;
+   std::mutex m_loadMutex;
 
 protected:
    std::ostream& m_output;
@@ -526,6 +540,7 @@ public:
    sce_iftbl_base_t(std::shared_ptr<sce_iftbl_header_base_t> header, std::ostream& output)
       : m_header(header),
         m_page(-1),
+        m_numLoaded(0),
         m_output(output)
    {
    }
@@ -540,11 +555,47 @@ public:
       return m_header;
    }
 
+   //total number of signature blocks (loaded or not)
+   std::size_t get_num_blocks() const
+   {
+      return m_blockIndex.size();
+   }
+
+   //returns signature blocks that are already loaded
+   //use load_blocks before accessing blocks that may not be loaded yet
+   const std::vector<sig_tbl_t>& get_blocks() const
+   {
+      return m_blocks;
+   }
+
+   bool is_lazy() const
+   {
+      return (bool)m_source;
+   }
+
+public:
+   //makes sure that first count signature blocks are loaded and validated. safe to call from multiple threads
+   bool load_blocks(std::size_t count);
+
+   //makes sure that all signature blocks are loaded and validated
+   bool load_blocks()
+   {
+      return load_blocks(m_blockIndex.size());
+   }
+
 public:
-   virtual bool read(std::ifstream& inputStream, std::uint64_t& index, std::uint32_t icv_salt);
+   //source file has to stay alive after parsing if blocks are loaded lazily
+   void set_lazy_source(std::shared_ptr<MappedFile> source)
+   {
+      m_source = source;
+   }
+
+   virtual bool read(MappedFileView& inputView, std::uint64_t& index, std::uint32_t icv_salt);
 
 protected:
-   bool read_block(std::ifstream& inputStream, std::uint64_t& index, std::uint32_t sizeCheck);
+   bool read_block(MappedFileView& inputView, std::uint64_t& index, std::uint32_t sizeCheck);
+
+   bool post_validate_blocks();
 
 public:
    virtual std::uint32_t get_icv_salt() const = 0;
@@ -559,7 +610,7 @@ public:
    }
 
 public:
-   bool read(std::ifstream& inputStream, std::uint64_t& index, std::uint32_t icv_salt) override;
+   bool read(MappedFileView& inputView, std::uint64_t& index, std::uint32_t icv_salt) override;
 };
 
 //for now these types do not implement any additional logic that is different from base classes
@@ -591,7 +642,7 @@ public:
    std::uint32_t get_icv_salt() const override;
 
 public:
-   bool read(std::ifstream& inputStream, std::uint64_t& index, std::uint32_t icv_salt) override;
+   bool read(MappedFileView& inputView, std::uint64_t& index, std::uint32_t icv_salt) override;
 };
 
 class sce_inull_proxy_t : public sce_iftbl_base_t
@@ -609,7 +660,7 @@ public:
    std::uint32_t get_icv_salt() const override;
 
 public:
-   bool read(std::ifstream& inputStream, std::uint64_t& index, std::uint32_t icv_salt) override;
+   bool read(MappedFileView& inputView, std::uint64_t& index, std::uint32_t icv_salt) override;
 };
 
 //=================================================
@@ -622,9 +673,12 @@ public:
 protected:
    std::ostream& m_output;
 
+   bool m_lazy;
+
 public:
-   sce_idb_base_t(std::ostream& output)
-      : m_output(output)
+   sce_idb_base_t(std::ostream& output, bool lazy)
+      : m_output(output),
+        m_lazy(lazy)
    {
    }
 
@@ -636,7 +690,7 @@ public:
    virtual bool read(psvpfs::path filepath) = 0;
 
 protected:
-   bool read_table_item(std::ifstream& inputStream, std::uint64_t& index, std::uint32_t icv_salt);
+   bool read_table_item(std::shared_ptr<MappedFile> inputFile, MappedFileView& inputView, std::uint64_t& index, std::uint32_t icv_salt);
 };
 
 //this is a root object for unicv.db - it contains SCEIRODB header and list of SCEIFTBL file table blocks
@@ -646,8 +700,8 @@ private:
    std::unique_ptr<sce_irodb_header_proxy_t> m_dbHeader;
 
 public:
-   sce_irodb_t(std::ostream& output)
-      : sce_idb_base_t(output)
+   sce_irodb_t(std::ostream& output, bool lazy = false)
+      : sce_idb_base_t(output, lazy)
    {
       m_dbHeader = std::unique_ptr<sce_irodb_header_proxy_t>(new sce_irodb_header_proxy_t(output));
    }
@@ -660,8 +714,8 @@ public:
 class sce_icvdb_t : public sce_idb_base_t
 {
 public:
-   sce_icvdb_t(std::ostream& output)
-      : sce_idb_base_t(output)
+   sce_icvdb_t(std::ostream& output, bool lazy = false)
+      : sce_idb_base_t(output, lazy)
    {
    }
 
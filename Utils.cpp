@@ -42,13 +42,20 @@ std::string byte_array_to_string(const unsigned char* source, int nBytes)
    return std::string(result.data(), nBytes * 2);
 }
 
-int print_bytes(const unsigned char* bytes, int length)
+int print_bytes(const unsigned char* bytes, int length, std::ostream& output)
 {
+   //stream is shared with the rest of the log so its format is restored
+   std::ios_base::fmtflags flags = output.flags();
+   char fill = output.fill();
+
    for(int i = 0; i < length; i++)
    {
-      std::cout << std::hex << std::setfill('0') << std::setw(2) << (0xFF & (int)bytes[i]);
+      output << std::hex << std::setfill('0') << std::setw(2) << (0xFF & (int)bytes[i]);
    }
-   std::cout << std::endl;
+   output << std::endl;
+
+   output.flags(flags);
+   output.fill(fill);
    return 0;
 }
 
@@ -199,12 +206,23 @@ bool sce_junction::create_empty_directory(const psvpfs::path& source_root, const
    return true;
 }
 
+//get path of the file in destination root using path from this junction
+psvpfs::path sce_junction::get_dest_path(const psvpfs::path& source_root, const psvpfs::path& destination_root, const std::string& suffix) const
+{
+   psvpfs::path new_path = source_path_to_dest_path(source_root, destination_root, m_real);
+
+   if(suffix.length() > 0)
+      new_path += suffix;
+
+   return new_path;
+}
+
 //create empty file in destination root using path from this junction
 //leaves stream opened for other operations like write
-bool sce_junction::create_empty_file(const psvpfs::path& source_root, const psvpfs::path& destination_root, std::ofstream& outputStream) const
+bool sce_junction::create_empty_file(const psvpfs::path& source_root, const psvpfs::path& destination_root, std::ofstream& outputStream, const std::string& suffix) const
 {
    //construct new path
-   psvpfs::path new_path = source_path_to_dest_path(source_root, destination_root, m_real);
+   psvpfs::path new_path = get_dest_path(source_root, destination_root, suffix);
    psvpfs::path new_directory = new_path;
    new_directory.remove_filename();
 
@@ -268,13 +286,31 @@ bool sce_junction::copy_existing_file(const psvpfs::path& source_root, const psv
 }
 
 
-bool sce_junction::copy_existing_file(const psvpfs::path& source_root, const psvpfs::path& destination_root, std::uintmax_t size) const
+bool sce_junction::copy_existing_file(const psvpfs::path& source_root, const psvpfs::path& destination_root, std::uintmax_t size, const std::string& suffix) const
 {
-   if (!copy_existing_file(source_root, destination_root))
+   //construct new path
+   psvpfs::path new_path = get_dest_path(source_root, destination_root, suffix);
+   psvpfs::path new_directory = new_path;
+   new_directory.remove_filename();
+
+   //create all directories on the way
+
+   psvpfs::create_directories(new_directory);
+
+   //copy the file
+
+   if(psvpfs::exists(new_path))
+      psvpfs::remove(new_path);
+
+   psvpfs::copy(m_real.generic_string(), new_path);
+
+   if(!psvpfs::exists(new_path))
+   {
+      std::cout << "Failed to copy: " << m_real.generic_string() << " to " << new_path.generic_string() << std::endl;
       return false;
+   }
 
    // trim size
-   psvpfs::path new_path = source_path_to_dest_path(source_root, destination_root, m_real);
    psvpfs::resize_file(new_path, size);
 
    return true;
@@ -284,6 +320,10 @@ const psvpfs::path &sce_junction::get_value() const {
     return m_value;
 }
 
+const psvpfs::path &sce_junction::get_real() const {
+    return m_real;
+}
+
 std::ostream& operator<<(std::ostream& os, const sce_junction& p)
 {
    os << p.m_value.generic_string();
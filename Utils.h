@@ -24,7 +24,7 @@ int string_to_byte_array(std::string str, std::uint32_t nBytes, unsigned char* d
 
 std::string byte_array_to_string(const unsigned char* source, int nBytes);
 
-int print_bytes(const unsigned char* bytes, int length);
+int print_bytes(const unsigned char* bytes, int length, std::ostream& output);
 
 void getFileListNoPfs(psvpfs::path root_path, std::set<psvpfs::path>& files, std::set<psvpfs::path>& directories);
 
@@ -63,9 +63,13 @@ public:
    //create empty directory in destination root using path from this junction
    bool create_empty_directory(const psvpfs::path& source_root, const psvpfs::path& destination_root) const;
 
+   //get path of the file in destination root using path from this junction
+   psvpfs::path get_dest_path(const psvpfs::path& source_root, const psvpfs::path& destination_root, const std::string& suffix = std::string()) const;
+
    //create empty file in destination root using path from this junction
    //leaves stream opened for other operations like write
-   bool create_empty_file(const psvpfs::path& source_root, const psvpfs::path& destination_root, std::ofstream& outputStream) const;
+   //suffix is appended to file name, used to write into temporary file first
+   bool create_empty_file(const psvpfs::path& source_root, const psvpfs::path& destination_root, std::ofstream& outputStream, const std::string& suffix = std::string()) const;
 
    //create empty file in destination root using path from this junction
    bool create_empty_file(const psvpfs::path& source_root, const psvpfs::path& destination_root) const;
@@ -74,11 +78,14 @@ public:
    bool copy_existing_file(const psvpfs::path& source_root, const psvpfs::path& destination_root) const;
 
    //copy file with specific size in destination root using path from this junction
-   bool copy_existing_file(const psvpfs::path& source_root, const psvpfs::path& destination_root, std::uintmax_t size) const;
+   bool copy_existing_file(const psvpfs::path& source_root, const psvpfs::path& destination_root, std::uintmax_t size, const std::string& suffix = std::string()) const;
 
    //return corresponding virtual path
    const psvpfs::path& get_value() const;
 
+   //return path of linked real file
+   const psvpfs::path& get_real() const;
+
 public:
    //this operator should only be used for printing to console!
    friend std::ostream& operator<<(std::ostream& os, const sce_junction& p);
@@ -0,0 +1,136 @@
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace {
+
+//state of single parallel_for call. shared with helper tasks that may outlive the call
+struct parallel_for_state
+{
+   std::atomic<std::size_t> next;
+   std::size_t count;
+   std::size_t done;
+
+   std::mutex mutex;
+   std::condition_variable condition;
+   std::exception_ptr error;
+
+   const std::function<void(std::size_t)>* func;
+};
+
+void run_iterations(std::shared_ptr<parallel_for_state> state)
+{
+   std::size_t nDone = 0;
+
+   for(std::size_t i = state->next++; i < state->count; i = state->next++)
+   {
+      try
+      {
+         (*state->func)(i);
+      }
+      catch(...)
+      {
+         std::lock_guard<std::mutex> guard(state->mutex);
+         if(!state->error)
+            state->error = std::current_exception();
+      }
+
+      nDone++;
+   }
+
+   if(nDone == 0)
+      return;
+
+   std::lock_guard<std::mutex> guard(state->mutex);
+   state->done += nDone;
+   if(state->done == state->count)
+      state->condition.notify_all();
+}
+
+}
+
+WorkerPool::WorkerPool(std::size_t nThreads)
+   : m_stop(false)
+{
+   if(nThreads == 0)
+      nThreads = default_concurrency();
+
+   for(std::size_t i = 0; i < nThreads; i++)
+      m_threads.emplace_back(&WorkerPool::worker, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+   {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_stop = true;
+   }
+
+   m_condition.notify_all();
+
+   for(auto& t : m_threads)
+      t.join();
+}
+
+std::size_t WorkerPool::default_concurrency()
+{
+   std::size_t n = std::thread::hardware_concurrency();
+   return (n == 0) ? 1 : n;
+}
+
+void WorkerPool::worker()
+{
+   while(true)
+   {
+      std::function<void()> task;
+
+      {
+         std::unique_lock<std::mutex> lock(m_mutex);
+         m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+
+         if(m_stop && m_tasks.empty())
+            return;
+
+         task = std::move(m_tasks.front());
+         m_tasks.pop_front();
+      }
+
+      task();
+   }
+}
+
+void WorkerPool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& func)
+{
+   if(count == 0)
+      return;
+
+   std::shared_ptr<parallel_for_state> state = std::make_shared<parallel_for_state>();
+   state->next = 0;
+   state->count = count;
+   state->done = 0;
+   state->func = &func;
+
+   //one helper per worker is enough - each helper processes iterations until range is exhausted
+   std::size_t nHelpers = (count - 1 < m_threads.size()) ? count - 1 : m_threads.size();
+
+   if(nHelpers > 0)
+   {
+      {
+         std::lock_guard<std::mutex> guard(m_mutex);
+         for(std::size_t i = 0; i < nHelpers; i++)
+            m_tasks.push_back([state]() { run_iterations(state); });
+      }
+
+      m_condition.notify_all();
+   }
+
+   run_iterations(state);
+
+   std::unique_lock<std::mutex> lock(state->mutex);
+   state->condition.wait(lock, [&state]() { return state->done == state->count; });
+
+   if(state->error)
+      std::rethrow_exception(state->error);
+}
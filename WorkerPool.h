@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+//fixed size pool of worker threads
+//work is submitted with parallel_for which blocks until all iterations are done
+//calling thread also takes part in processing so nested parallel_for calls do not deadlock
+class WorkerPool
+{
+private:
+   std::vector<std::thread> m_threads;
+
+   std::mutex m_mutex;
+   std::condition_variable m_condition;
+   std::deque<std::function<void()> > m_tasks;
+   bool m_stop;
+
+public:
+   //0 means number of hardware threads
+   WorkerPool(std::size_t nThreads = 0);
+
+   WorkerPool(const WorkerPool&) = delete;
+
+   WorkerPool& operator=(const WorkerPool&) = delete;
+
+   ~WorkerPool();
+
+public:
+   std::size_t size() const
+   {
+      return m_threads.size();
+   }
+
+   static std::size_t default_concurrency();
+
+public:
+   //calls func for each index in range [0, count)
+   //first exception thrown by func is rethrown in calling thread after all iterations are finished
+   void parallel_for(std::size_t count, const std::function<void(std::size_t)>& func);
+
+private:
+   void worker();
+};
@@ -1,4 +1,5 @@
 #include "PsvPfsParserConfig.h"
+#include "PfsShard.h"
 
 #include <iostream>
 #include <string>
@@ -12,10 +13,18 @@
 #define ZRIF_NAME "zRIF"
 #define F00D_URL_NAME "f00d_url"
 #define F00D_CACHE_NAME "f00d_cache"
+#define F00D_CACHE_BIN_NAME "f00d_cache_bin"
+#define BATCH_NAME "batch"
+#define THREADS_NAME "threads"
+#define SHARD_NAME "shard"
+#define IO_NAME "io"
+#define CACHE_NAME "cache"
+#define VERIFY_NAME "verify"
+#define MERGE_NAME "merge"
 
 boost::program_options::options_description get_options_desc(bool include_deprecated) {
     boost::program_options::options_description desc("Options");
-    desc.add_options()((std::string(HELP_NAME) + ",h").c_str(), "Show help")((std::string(TITLE_ID_SRC_NAME) + ",i").c_str(), boost::program_options::value<std::string>(), "Source directory that contains the application. Like PCSC00000.")((std::string(TITLE_ID_DST_NAME) + ",o").c_str(), boost::program_options::value<std::string>(), "Destination directory where everything will be unpacked. Like PCSC00000_dec.")((std::string(KLICENSEE_NAME) + ",k").c_str(), boost::program_options::value<std::string>(), "klicensee hex coded string. Like 00112233445566778899AABBCCDDEEFF.")((std::string(ZRIF_NAME) + ",z").c_str(), boost::program_options::value<std::string>(), "zRIF string.")((std::string(F00D_CACHE_NAME) + ",c").c_str(), boost::program_options::value<std::string>(), "Path to flat or json file with F00D cache.");
+    desc.add_options()((std::string(HELP_NAME) + ",h").c_str(), "Show help")((std::string(TITLE_ID_SRC_NAME) + ",i").c_str(), boost::program_options::value<std::string>(), "Source directory that contains the application. Like PCSC00000.")((std::string(TITLE_ID_DST_NAME) + ",o").c_str(), boost::program_options::value<std::string>(), "Destination directory where everything will be unpacked. Like PCSC00000_dec. Path ending with .tar or - (stdout) writes tar archive instead.")((std::string(KLICENSEE_NAME) + ",k").c_str(), boost::program_options::value<std::string>(), "klicensee hex coded string. Like 00112233445566778899AABBCCDDEEFF.")((std::string(ZRIF_NAME) + ",z").c_str(), boost::program_options::value<std::string>(), "zRIF string.")((std::string(F00D_CACHE_NAME) + ",c").c_str(), boost::program_options::value<std::string>(), "Path to flat, json or binary (.bin) file with F00D cache.")(F00D_CACHE_BIN_NAME, boost::program_options::value<std::string>(), "Convert F00D cache given with --f00d_cache to binary cache at this path (.bin) and exit. Binary cache loads without parsing.")((std::string(BATCH_NAME) + ",b").c_str(), boost::program_options::value<std::string>(), "File with list of titles to unpack in one process. One title per line: <title_id_src> <title_id_dst> [klicensee or zRIF].")((std::string(THREADS_NAME) + ",j").c_str(), boost::program_options::value<std::size_t>(), "Number of titles unpacked at once in batch mode. Default is number of hardware threads.")((std::string(SHARD_NAME) + ",s").c_str(), boost::program_options::value<std::string>(), "Process only shard i of N in batch mode, like 0/4. Files of every title are split by size recorded in files.db, so N processes with different i unpack every file exactly once. Run --merge N when all shards are done.")(IO_NAME, boost::program_options::value<std::string>(), "How files are read and written: sync (default) or uring. uring keeps several requests in flight and falls back to sync if kernel does not support it.")(CACHE_NAME, boost::program_options::value<std::string>(), "How page cache is used: buffered (default), dontneed (pages are dropped after use) or direct (direct io, only file tails go through page cache).")(VERIFY_NAME, "Rehash files completed by previous interrupted run before skipping them. By default their size and salt recorded in the manifest are trusted.")(MERGE_NAME, boost::program_options::value<std::uint32_t>(), "Check that N shards together unpacked every file of all titles in batch list instead of unpacking. Manifests of shards are merged. Use 1 if titles were not sharded. Outputs are rehashed if --verify is also set.");
 
     if (include_deprecated) {
         desc.add_options()((std::string(F00D_URL_NAME) + ",f").c_str(), boost::program_options::value<std::string>(), "Url of F00D service. [DEPRECATED] Native implementation of F00D will be used.");
@@ -39,7 +48,83 @@ int parse_options(int argc, char *argv[], PsvPfsParserConfig &cfg) {
             return -1;
         }
 
-        if (vm.count(TITLE_ID_SRC_NAME)) {
+        if (vm.count(THREADS_NAME)) {
+            cfg.threads = vm[THREADS_NAME].as<std::size_t>();
+        }
+
+        if (vm.count(SHARD_NAME)) {
+            if (parse_shard(vm[SHARD_NAME].as<std::string>(), cfg.shard_index, cfg.shard_count) < 0) {
+                std::cout << "Invalid option --" << SHARD_NAME << ". Expected i/N where i < N" << std::endl;
+                return -1;
+            }
+        }
+
+        if (vm.count(IO_NAME)) {
+            std::string io = vm[IO_NAME].as<std::string>();
+            if (io == "sync") {
+                cfg.io_type = PfsIoQueueTypes::sync;
+            } else if (io == "uring") {
+                cfg.io_type = PfsIoQueueTypes::uring;
+            } else {
+                std::cout << "Invalid option --" << IO_NAME << ". Expected sync or uring" << std::endl;
+                return -1;
+            }
+        }
+
+        if (vm.count(CACHE_NAME)) {
+            std::string cache = vm[CACHE_NAME].as<std::string>();
+            if (cache == "buffered") {
+                cfg.cache_mode = PfsCacheModes::buffered;
+            } else if (cache == "dontneed") {
+                cfg.cache_mode = PfsCacheModes::dontneed;
+            } else if (cache == "direct") {
+                cfg.cache_mode = PfsCacheModes::direct;
+            } else {
+                std::cout << "Invalid option --" << CACHE_NAME << ". Expected buffered, dontneed or direct" << std::endl;
+                return -1;
+            }
+        }
+
+        cfg.verify_outputs = vm.count(VERIFY_NAME) > 0;
+
+        //single title mode does not split titles yet
+        if (vm.count(SHARD_NAME) && !vm.count(BATCH_NAME)) {
+            std::cout << "Option --" << SHARD_NAME << " requires --" << BATCH_NAME << std::endl;
+            return -1;
+        }
+
+        if (vm.count(MERGE_NAME)) {
+            if (!vm.count(BATCH_NAME) || vm.count(SHARD_NAME)) {
+                std::cout << "Option --" << MERGE_NAME << " requires --" << BATCH_NAME << " and checks all shards at once" << std::endl;
+                return -1;
+            }
+
+            cfg.merge = true;
+            cfg.shard_index = 0;
+            cfg.shard_count = vm[MERGE_NAME].as<std::uint32_t>();
+            if (cfg.shard_count == 0) {
+                std::cout << "Invalid option --" << MERGE_NAME << ". Expected number of shards" << std::endl;
+                return -1;
+            }
+        }
+
+        //conversion of the cache does not need any title
+        if (vm.count(F00D_CACHE_BIN_NAME)) {
+            if (!vm.count(F00D_CACHE_NAME)) {
+                std::cout << "Option --" << F00D_CACHE_BIN_NAME << " requires --" << F00D_CACHE_NAME << std::endl;
+                return -1;
+            }
+
+            cfg.f00d_cache_bin = vm[F00D_CACHE_BIN_NAME].as<std::string>();
+            cfg.f00d_enc_type = F00DEncryptorTypes::file;
+            cfg.f00d_arg = vm[F00D_CACHE_NAME].as<std::string>();
+            return 0;
+        }
+
+        //sources, destinations and keys are taken from the list in batch mode
+        if (vm.count(BATCH_NAME)) {
+            cfg.batch_file = vm[BATCH_NAME].as<std::string>();
+        } else if (vm.count(TITLE_ID_SRC_NAME)) {
             cfg.title_id_src = vm[TITLE_ID_SRC_NAME].as<std::string>();
         } else {
             std::cout << "Missing option --" << TITLE_ID_SRC_NAME << std::endl;
@@ -48,19 +133,24 @@ int parse_options(int argc, char *argv[], PsvPfsParserConfig &cfg) {
 
         if (vm.count(TITLE_ID_DST_NAME)) {
             cfg.title_id_dst = vm[TITLE_ID_DST_NAME].as<std::string>();
-        } else {
+        } else if (cfg.batch_file.empty()) {
             std::cout << "Missing option --" << TITLE_ID_DST_NAME << std::endl;
             return -1;
         }
 
-        if (vm.count(KLICENSEE_NAME)) {
+        //stdout carries archive so warnings go to stderr
+        std::ostream &log = cfg.title_id_dst == "-" ? std::cerr : std::cout;
+
+        if (!cfg.batch_file.empty()) {
+            //keys are given per title
+        } else if (vm.count(KLICENSEE_NAME)) {
             cfg.klicensee = vm[KLICENSEE_NAME].as<std::string>();
         } else {
             if (vm.count(ZRIF_NAME)) {
                 cfg.zRIF = vm[ZRIF_NAME].as<std::string>();
             } else {
-                std::cout << "Missing option --" << KLICENSEE_NAME << " or --" ZRIF_NAME << std::endl;
-                std::cout << "sealedkey will be used" << std::endl;
+                log << "Missing option --" << KLICENSEE_NAME << " or --" ZRIF_NAME << std::endl;
+                log << "sealedkey will be used" << std::endl;
             }
         }
 
@@ -80,7 +170,7 @@ int parse_options(int argc, char *argv[], PsvPfsParserConfig &cfg) {
         }
 
         if (!f00d_url.empty()) {
-            std::cout << "Warning. Option " << F00D_URL_NAME << " is deprecated. Switching to native implementation of F00D" << std::endl;
+            log << "Warning. Option " << F00D_URL_NAME << " is deprecated. Switching to native implementation of F00D" << std::endl;
 
             cfg.f00d_enc_type = F00DEncryptorTypes::native;
             cfg.f00d_arg = std::string();
@@ -106,5 +196,21 @@ int main(int argc, char *argv[]) {
     if (parse_options(argc, argv, cfg) < 0)
         return -1;
 
-    return 0;
+    if (!cfg.f00d_cache_bin.empty())
+        return convert_F00D_cache(cfg.f00d_arg, cfg.f00d_cache_bin) == 0 ? 0 : -1;
+
+    if (!cfg.batch_file.empty()) {
+        std::vector<PsvPfsParserConfig> jobs;
+        if (load_batch_file(cfg.batch_file, jobs) < 0)
+            return -1;
+
+        return execute_batch(jobs, cfg.f00d_enc_type, cfg.f00d_arg, cfg.threads, cfg.shard_index, cfg.shard_count, cfg.io_type, cfg.cache_mode, cfg.verify_outputs, cfg.merge) == 0 ? 0 : -1;
+    }
+
+    try {
+        return execute(cfg) == 0 ? 0 : -1;
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
 }
@@ -0,0 +1,263 @@
+//read only FUSE frontend that exposes decrypted title as a directory
+//files are decrypted lazily on read, nothing is written to disk
+//usage: psvpfsfuse -i PCSC00000 -k 00112233445566778899AABBCCDDEEFF [-c f00d_cache] [--cache_size=MB] mountpoint [fuse options]
+
+#define FUSE_USE_VERSION 31
+
+#include <fuse.h>
+
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <iostream>
+#include <string>
+#include <memory>
+
+#include "PfsFilesystem.h"
+#include "PfsVirtualFilesystem.h"
+#include "PfsSectorCache.h"
+
+#include "CryptoOperationsFactory.h"
+#include "PsvPfsParserConfig.h"
+
+//default size of decrypted sector cache in megabytes
+#define PSVPFSFUSE_DEFAULT_CACHE_SIZE 256
+
+struct psvpfsfuse_options
+{
+   char* title_id_src;
+   char* klicensee;
+   char* zRIF;
+   char* f00d_cache;
+   unsigned long cache_size;
+   int show_help;
+};
+
+#define PSVPFSFUSE_OPT(t, p) { t, offsetof(struct psvpfsfuse_options, p), 1 }
+
+static const struct fuse_opt option_spec[] = {
+   PSVPFSFUSE_OPT("-i %s", title_id_src),
+   PSVPFSFUSE_OPT("--title_id_src=%s", title_id_src),
+   PSVPFSFUSE_OPT("-k %s", klicensee),
+   PSVPFSFUSE_OPT("--klicensee=%s", klicensee),
+   PSVPFSFUSE_OPT("-z %s", zRIF),
+   PSVPFSFUSE_OPT("--zRIF=%s", zRIF),
+   PSVPFSFUSE_OPT("-c %s", f00d_cache),
+   PSVPFSFUSE_OPT("--f00d_cache=%s", f00d_cache),
+   PSVPFSFUSE_OPT("--cache_size=%lu", cache_size),
+   PSVPFSFUSE_OPT("-h", show_help),
+   PSVPFSFUSE_OPT("--help", show_help),
+   FUSE_OPT_END
+};
+
+static PfsVirtualFilesystem* get_vfs()
+{
+   return (PfsVirtualFilesystem*)fuse_get_context()->private_data;
+}
+
+static int psvpfsfuse_getattr(const char* path, struct stat* stbuf, struct fuse_file_info* fi)
+{
+   (void)fi;
+
+   pfs_vfs_stat_t st;
+   if(get_vfs()->stat(path, st) < 0)
+      return -ENOENT;
+
+   memset(stbuf, 0, sizeof(struct stat));
+
+   if(st.is_directory)
+   {
+      stbuf->st_mode = S_IFDIR | 0555;
+      stbuf->st_nlink = 2;
+   }
+   else
+   {
+      stbuf->st_mode = S_IFREG | 0444;
+      stbuf->st_nlink = 1;
+      stbuf->st_size = st.size;
+   }
+
+   return 0;
+}
+
+static int psvpfsfuse_readdir(const char* path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi, enum fuse_readdir_flags flags)
+{
+   //whole directory is filled at once so offset is not used
+   (void)offset;
+   (void)fi;
+   (void)flags;
+
+   std::vector<std::string> entries;
+   if(get_vfs()->readdir(path, entries) < 0)
+      return -ENOENT;
+
+   filler(buf, ".", NULL, 0, (enum fuse_fill_dir_flags)0);
+   filler(buf, "..", NULL, 0, (enum fuse_fill_dir_flags)0);
+
+   for(auto& e : entries)
+      filler(buf, e.c_str(), NULL, 0, (enum fuse_fill_dir_flags)0);
+
+   return 0;
+}
+
+static int psvpfsfuse_open(const char* path, struct fuse_file_info* fi)
+{
+   if((fi->flags & O_ACCMODE) != O_RDONLY)
+      return -EACCES;
+
+   int handle = get_vfs()->open(path);
+   if(handle < 0)
+      return -ENOENT;
+
+   fi->fh = handle;
+
+   //decrypted content never changes while mounted
+   fi->keep_cache = 1;
+
+   return 0;
+}
+
+static int psvpfsfuse_read(const char* path, char* buf, size_t size, off_t offset, struct fuse_file_info* fi)
+{
+   //file is already opened by handle
+   (void)path;
+
+   std::int64_t res = get_vfs()->pread(static_cast<int>(fi->fh), (unsigned char*)buf, static_cast<std::uint32_t>(size), offset);
+   if(res < 0)
+      return -EIO;
+
+   return static_cast<int>(res);
+}
+
+static int psvpfsfuse_release(const char* path, struct fuse_file_info* fi)
+{
+   (void)path;
+
+   get_vfs()->close(static_cast<int>(fi->fh));
+   return 0;
+}
+
+static void* psvpfsfuse_init(struct fuse_conn_info* conn, struct fuse_config* cfg)
+{
+   (void)conn;
+
+   cfg->kernel_cache = 1;
+   return fuse_get_context()->private_data;
+}
+
+static void show_help(const char* progname)
+{
+   std::cout << "usage: " << progname << " [options] <mountpoint>" << std::endl << std::endl;
+   std::cout << "File-system specific options:" << std::endl;
+   std::cout << "    -i, --title_id_src=<s>  Source directory that contains the application. Like PCSC00000." << std::endl;
+   std::cout << "    -k, --klicensee=<s>     klicensee hex coded string. Like 00112233445566778899AABBCCDDEEFF." << std::endl;
+   std::cout << "    -z, --zRIF=<s>          zRIF string." << std::endl;
+   std::cout << "    -c, --f00d_cache=<s>    Path to flat, json or binary (.bin) file with F00D cache." << std::endl;
+   std::cout << "    --cache_size=<n>        Size of decrypted sector cache in megabytes. Default is " << PSVPFSFUSE_DEFAULT_CACHE_SIZE << "." << std::endl;
+   std::cout << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+   struct fuse_args args = FUSE_ARGS_INIT(argc, argv);
+
+   struct psvpfsfuse_options options;
+   memset(&options, 0, sizeof(options));
+   options.cache_size = PSVPFSFUSE_DEFAULT_CACHE_SIZE;
+
+   if(fuse_opt_parse(&args, &options, option_spec, NULL) == -1)
+      return -1;
+
+   if(options.show_help)
+   {
+      show_help(argv[0]);
+
+      //let fuse print its own options
+      fuse_opt_add_arg(&args, "--help");
+      args.argv[0][0] = '\0';
+
+      struct fuse_operations empty_operations;
+      memset(&empty_operations, 0, sizeof(empty_operations));
+      int res = fuse_main(args.argc, args.argv, &empty_operations, NULL);
+      fuse_opt_free_args(&args);
+      return res;
+   }
+
+   if(!options.title_id_src)
+   {
+      std::cout << "Missing option --title_id_src" << std::endl;
+      fuse_opt_free_args(&args);
+      return -1;
+   }
+
+   PsvPfsParserConfig cfg;
+   cfg.title_id_src = options.title_id_src;
+   if(options.klicensee)
+      cfg.klicensee = options.klicensee;
+   if(options.zRIF)
+      cfg.zRIF = options.zRIF;
+
+   if(options.f00d_cache)
+   {
+      cfg.f00d_enc_type = F00DEncryptorTypes::file;
+      cfg.f00d_arg = options.f00d_cache;
+   }
+   else
+   {
+      //sectors of different files are decrypted concurrently so F00D has to be thread safe
+      cfg.f00d_enc_type = F00DEncryptorTypes::native_concurrent;
+   }
+
+   std::shared_ptr<ICryptoOperations> cryptops = CryptoOperationsFactory::create(CryptoOperationsTypes::openssl);
+   std::shared_ptr<IF00DKeyEncryptor> iF00D = create_F00D_encryptor(cfg, cryptops);
+
+   unsigned char klicensee[0x10] = { 0 };
+   if(extract_klicensee(cfg, cryptops, klicensee, std::cout) < 0)
+   {
+      fuse_opt_free_args(&args);
+      return -1;
+   }
+
+   //filesystem is mounted before fuse forks into background
+   //mount does not leave any threads running so nothing is lost by the fork
+   psvpfs::path titleIdPath(cfg.title_id_src);
+
+   PfsFilesystem pfs(cryptops, iF00D, std::cout, klicensee, titleIdPath, true);
+   if(pfs.mount() < 0)
+   {
+      fuse_opt_free_args(&args);
+      return -1;
+   }
+
+   std::shared_ptr<PfsSectorCache> cache;
+   if(options.cache_size > 0)
+      cache = std::make_shared<PfsSectorCache>(static_cast<std::size_t>(options.cache_size) * 1024 * 1024);
+
+   PfsVirtualFilesystem vfs(pfs, cache);
+   if(vfs.mount() < 0)
+   {
+      fuse_opt_free_args(&args);
+      return -1;
+   }
+
+   //file system is always read only
+   fuse_opt_add_arg(&args, "-oro");
+
+   struct fuse_operations operations;
+   memset(&operations, 0, sizeof(operations));
+   operations.init = psvpfsfuse_init;
+   operations.getattr = psvpfsfuse_getattr;
+   operations.readdir = psvpfsfuse_readdir;
+   operations.open = psvpfsfuse_open;
+   operations.read = psvpfsfuse_read;
+   operations.release = psvpfsfuse_release;
+
+   //fuse_main uses multithreaded loop unless -s is passed
+   int res = fuse_main(args.argc, args.argv, &operations, &vfs);
+
+   fuse_opt_free_args(&args);
+   return res;
+}
@@ -0,0 +1,90 @@
+//converts flat F00D cache to binary cache the same way "--f00d_cache_bin" does
+//and checks that binary cache gives same keys as the flat one
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "PsvPfsParserConfig.h"
+#include "F00DFileKeyEncryptor.h"
+
+static const char* g_key128 = "00112233445566778899AABBCCDDEEFF";
+static const char* g_value128 = "FFEEDDCCBBAA99887766554433221100";
+static const char* g_key256 = "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F";
+static const char* g_value256 = "1F1E1D1C1B1A191817161514131211100F0E0D0C0B0A09080706050403020100";
+
+static void hex_to_bytes(const char* str, unsigned char* dest)
+{
+   for(std::size_t i = 0; str[i * 2] != 0; i++)
+      dest[i] = static_cast<unsigned char>(std::stoul(std::string(str + i * 2, 2), 0, 16));
+}
+
+//returns 0 if encryptor gives expected value for the key
+static int check_key(IF00DKeyEncryptor& iF00D, const char* key, const char* value, int key_size)
+{
+   unsigned char keyData[0x20] = {0};
+   unsigned char expected[0x20] = {0};
+   unsigned char actual[0x20] = {0};
+   hex_to_bytes(key, keyData);
+   hex_to_bytes(value, expected);
+
+   if(iF00D.encrypt_key(keyData, key_size, actual) < 0)
+      return -1;
+
+   return memcmp(actual, expected, key_size / 8) == 0 ? 0 : -1;
+}
+
+static int check_cache(IF00DKeyEncryptor& iF00D, const std::string& name)
+{
+   if(check_key(iF00D, g_key128, g_value128, 0x80) < 0 || check_key(iF00D, g_key256, g_value256, 0x100) < 0)
+   {
+      std::cout << "key is not found in " << name << " cache" << std::endl;
+      return -1;
+   }
+
+   //value of other key must not be found
+   if(check_key(iF00D, g_value128, g_key128, 0x80) == 0)
+   {
+      std::cout << "unknown key is found in " << name << " cache" << std::endl;
+      return -1;
+   }
+
+   return 0;
+}
+
+int main(int argc, char* argv[])
+{
+   psvpfs::path root = argc > 1 ? psvpfs::path(argv[1]) : psvpfs::path(".");
+
+   psvpfs::path flatPath = root / "f00d_cache.txt";
+   psvpfs::path binaryPath = root / "f00d_cache.bin";
+
+   {
+      std::ofstream flat(flatPath.generic_string().c_str());
+      flat << "PCSE00000 " << g_key128 << " " << g_value128 << std::endl;
+      flat << "PCSE00001," << g_key256 << "," << g_value256 << std::endl;
+   }
+
+   if(convert_F00D_cache(flatPath.generic_string(), binaryPath.generic_string()) < 0)
+      return 1;
+
+   F00DFileKeyEncryptor flatCache(flatPath);
+   if(check_cache(flatCache, "flat") < 0)
+      return 1;
+
+   F00DFileKeyEncryptor binaryCache(binaryPath);
+   if(check_cache(binaryCache, "binary") < 0)
+      return 1;
+
+   //binary cache is recognized by extension only
+   if(convert_F00D_cache(flatPath.generic_string(), (root / "f00d_cache.dat").generic_string()) == 0)
+      return 1;
+
+   psvpfs::remove(flatPath);
+   psvpfs::remove(binaryPath);
+
+   std::cout << "binary F00D cache gives same keys as flat cache" << std::endl;
+   return 0;
+}
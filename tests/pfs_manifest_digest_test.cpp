@@ -0,0 +1,98 @@
+//compares digest that file writer computes while writing with digest of the file read back from disk
+//sizes and buffer sizes cross the digest chunk and the aligned part of the file that direct mode writes
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "PfsDestinationWriter.h"
+#include "PfsExtractManifest.h"
+#include "PfsIoQueueFactory.h"
+#include "CryptoOperationsFactory.h"
+
+static const std::uint64_t g_sizes[] = {0, 1, 0x1000, 0x1001, PFS_EXTRACT_DIGEST_CHUNK_SIZE - 1, PFS_EXTRACT_DIGEST_CHUNK_SIZE,
+                                        PFS_EXTRACT_DIGEST_CHUNK_SIZE + 0x10, 3 * PFS_EXTRACT_DIGEST_CHUNK_SIZE + 0x1234};
+
+static const std::size_t g_bufferSizes[] = {0x3000, PFS_IO_BUFFER_SIZE};
+
+static const PfsCacheModes g_modes[] = {PfsCacheModes::buffered, PfsCacheModes::direct};
+
+static int check_digest(std::shared_ptr<ICryptoOperations> cryptops, const psvpfs::path& root, std::size_t bufferSize, PfsCacheModes mode,
+                        std::uint64_t size, std::mt19937& rng)
+{
+   std::vector<char> data(static_cast<std::size_t>(size));
+   for(auto& c : data)
+      c = static_cast<char>(rng());
+
+   psvpfs::path filepath = root / "digest.bin";
+
+   std::shared_ptr<PfsChunkDigest> digest = std::make_shared<PfsChunkDigest>(cryptops);
+
+   PfsFileWriter writer(PfsIoQueueFactory::create(PfsIoQueueTypes::sync, PFS_IO_QUEUE_DEPTH, bufferSize), mode);
+   writer.set_digest(digest);
+
+   if(writer.open(filepath, size) < 0)
+   {
+      std::cout << "Failed to open " << filepath.generic_string() << std::endl;
+      return -1;
+   }
+
+   //writes of uneven size so that buffers are filled by several calls
+   std::ostream stream(&writer);
+   for(std::size_t offset = 0; offset < data.size(); )
+   {
+      std::size_t n = std::min<std::size_t>(data.size() - offset, 1 + rng() % 0x20000);
+      stream.write(data.data() + offset, n);
+      offset += n;
+   }
+
+   if(writer.close() < 0)
+   {
+      std::cout << "Failed to write " << filepath.generic_string() << std::endl;
+      return -1;
+   }
+
+   std::string written = digest->finish();
+
+   PfsExtractManifest manifest(cryptops, std::cout, root);
+
+   std::string expected;
+   if(manifest.digest(filepath, expected) < 0)
+      return -1;
+
+   if(written != expected)
+   {
+      std::cout << "digest of " << size << " bytes written with buffer of " << bufferSize << " bytes does not match" << std::endl;
+      return -1;
+   }
+
+   return 0;
+}
+
+int main(int argc, char* argv[])
+{
+   psvpfs::path root = argc > 1 ? psvpfs::path(argv[1]) : psvpfs::path(".");
+
+   std::shared_ptr<ICryptoOperations> cryptops = CryptoOperationsFactory::create(CryptoOperationsTypes::openssl);
+   std::mt19937 rng(0x50465332);
+
+   for(PfsCacheModes mode : g_modes)
+   {
+      for(std::size_t bufferSize : g_bufferSizes)
+      {
+         for(std::uint64_t size : g_sizes)
+         {
+            if(check_digest(cryptops, root, bufferSize, mode, size, rng) < 0)
+               return 1;
+         }
+      }
+   }
+
+   psvpfs::remove(root / "digest.bin");
+
+   std::cout << "digest of written files matches digest of files on disk" << std::endl;
+   return 0;
+}
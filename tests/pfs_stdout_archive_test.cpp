@@ -0,0 +1,106 @@
+//writes tar archive to stdout the same way "-o -" does and runs every diagnostic that happens during extraction in between
+//test passes only if stdout can be listed by "tar -t", so any log line that leaks to stdout breaks it
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "PfsTarSink.h"
+#include "PsvPfsParserConfig.h"
+#include "CryptoOperationsFactory.h"
+#include "LocalKeyGenerator.h"
+#include "FilesDbParser.h"
+#include "HashTree.h"
+
+static int write_file(PfsTarSink& sink, const std::string& path, const std::string& data)
+{
+   std::ostream* stream = sink.begin_file(path, data.size());
+   if(!stream)
+      return -1;
+
+   stream->write(data.data(), data.size());
+   return sink.end_file();
+}
+
+//root page 0 keeps hash of page 1. one tree is valid and other does not match
+static int log_hash_tree(std::ostream& output)
+{
+   std::vector<sce_ng_pfs_block_t> blocks(2);
+   blocks[0].page = 0;
+   blocks[1].page = 1;
+
+   page_icv_data icv;
+   icv.offset = 0;
+   icv.page = 1;
+   memset(icv.icv, 0xAB, sizeof(icv.icv));
+
+   std::multimap<std::uint32_t, page_icv_data> page_icvs;
+   page_icvs.insert(std::make_pair(0, icv));
+
+   sce_ng_pfs_hash_t hash;
+   memset(hash.data, 0xCD, sizeof(hash.data));
+   blocks[0].hashes.push_back(hash);
+
+   if(validate_hash_tree(0, 0, blocks, page_icvs, output))
+      return -1;
+
+   memcpy(blocks[0].hashes[0].data, icv.icv, sizeof(icv.icv));
+
+   if(!validate_hash_tree(0, 0, blocks, page_icvs, output))
+      return -1;
+
+   return 0;
+}
+
+//every key source fails here and logs the reason
+static int log_keys(std::ostream& output)
+{
+   std::shared_ptr<ICryptoOperations> cryptops = CryptoOperationsFactory::create(CryptoOperationsTypes::openssl);
+   unsigned char klicensee[0x10] = {0};
+
+   PsvPfsParserConfig cfg;
+   cfg.title_id_src = "missing_title";
+
+   cfg.klicensee = "not a key";
+   if(extract_klicensee(cfg, cryptops, klicensee, output) >= 0)
+      return -1;
+
+   cfg.klicensee = "";
+   if(extract_klicensee(cfg, cryptops, klicensee, output) >= 0)
+      return -1;
+
+   if(get_keystone(cryptops, cfg.title_id_src, output) >= 0)
+      return -1;
+
+   return 0;
+}
+
+int main()
+{
+   std::ostream& output = std::cerr;
+
+   PfsTarSink sink(std::cout, output);
+
+   if(sink.create_directory("sce_sys") < 0)
+      return 1;
+
+   if(log_keys(output) < 0)
+      return 1;
+
+   if(write_file(sink, "sce_sys/param.sfo", "param") < 0)
+      return 1;
+
+   if(log_hash_tree(output) < 0)
+      return 1;
+
+   if(write_file(sink, "eboot.bin", std::string(0x300, 'e')) < 0)
+      return 1;
+
+   if(sink.finish() < 0)
+      return 1;
+
+   std::cout.flush();
+   return 0;
+}
@@ -0,0 +1,140 @@
+//checks that verify-only kernels accept sectors with correct icv, reject every single corrupted sector
+//and that files without icv are not reported as verified
+//verify_files marks result as verified only if pfs_has_icv is true for the file
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "PfsCryptEngine.h"
+#include "FilesDbParser.h"
+#include "CryptoOperationsFactory.h"
+
+#define TEST_SECTOR_SIZE 0x200
+#define TEST_SECTOR_COUNT 4
+#define TEST_SECRET_BYTE 0x5A
+
+//icv of savedata sector is hmac-sha1 of the whole sector with secret as key
+static void compute_signatures(std::shared_ptr<ICryptoOperations> cryptops, const std::vector<std::uint8_t>& sectors, std::vector<std::uint8_t>& signatures)
+{
+   unsigned char secret[0x14];
+   memset(secret, TEST_SECRET_BYTE, sizeof(secret));
+
+   signatures.assign(0x14 * TEST_SECTOR_COUNT, 0);
+   for(std::uint32_t i = 0; i < TEST_SECTOR_COUNT; i++)
+      cryptops->hmac_sha1(sectors.data() + i * TEST_SECTOR_SIZE, signatures.data() + i * 0x14, TEST_SECTOR_SIZE, secret, sizeof(secret));
+}
+
+//runs verify kernel over sectors of savedata file (xts-aes, icv is hmac-sha1 with secret) and returns error of work context
+static int run_verify_kernel(std::shared_ptr<ICryptoOperations> cryptops, std::uint16_t fs_attr, std::uint16_t crypto_engine_flag,
+                             std::vector<std::uint8_t>& sectors, std::vector<std::uint8_t>& signatures)
+{
+   CryptEngineData data;
+   memset(&data, 0, sizeof(CryptEngineData));
+   data.mode_index = 0x05;
+   data.crypto_engine_flag = crypto_engine_flag;
+   data.fs_attr = fs_attr;
+   data.block_size = TEST_SECTOR_SIZE;
+   memset(data.secret, TEST_SECRET_BYTE, sizeof(data.secret));
+
+   CryptEngineSubctx subctx;
+   memset(&subctx, 0, sizeof(CryptEngineSubctx));
+   subctx.opt_code = CRYPT_ENGINE_READ;
+   subctx.data = &data;
+   subctx.nBlocks = TEST_SECTOR_COUNT;
+   subctx.tail_size = TEST_SECTOR_SIZE;
+   subctx.signature_table = signatures.data();
+   subctx.work_buffer0 = sectors.data();
+   subctx.work_buffer1 = sectors.data();
+
+   CryptEngineWorkCtx work_ctx;
+   memset(&work_ctx, 0, sizeof(CryptEngineWorkCtx));
+   work_ctx.subctx = &subctx;
+   work_ctx.error = 0;
+
+   pfs_crypt_kernel_t kernel = pfs_select_verify_kernel(&subctx, cryptops.get());
+   kernel(cryptops, std::shared_ptr<IF00DKeyEncryptor>(), &work_ctx);
+
+   return work_ctx.error;
+}
+
+int main()
+{
+   std::shared_ptr<ICryptoOperations> cryptops = CryptoOperationsFactory::create(CryptoOperationsTypes::openssl);
+
+   std::mt19937 rng(0x50465333);
+
+   std::vector<std::uint8_t> sectors(TEST_SECTOR_SIZE * TEST_SECTOR_COUNT);
+   for(auto& b : sectors)
+      b = static_cast<std::uint8_t>(rng());
+
+   std::vector<std::uint8_t> signatures;
+   compute_signatures(cryptops, sectors, signatures);
+
+   std::vector<std::uint8_t> original = sectors;
+
+   if(run_verify_kernel(cryptops, normal_file, CRYPTO_ENGINE_THROW_ERROR, sectors, signatures) != 0)
+   {
+      std::cout << "correct icv is rejected" << std::endl;
+      return 1;
+   }
+
+   //single flipped byte in any sector is detected
+   for(std::uint32_t i = 0; i < TEST_SECTOR_COUNT; i++)
+   {
+      std::vector<std::uint8_t> corrupted = sectors;
+      corrupted[i * TEST_SECTOR_SIZE + (rng() % TEST_SECTOR_SIZE)] ^= 0x01;
+
+      if(run_verify_kernel(cryptops, normal_file, CRYPTO_ENGINE_THROW_ERROR, corrupted, signatures) == 0)
+      {
+         std::cout << "corrupted sector " << i << " is not detected" << std::endl;
+         return 1;
+      }
+   }
+
+   //none of the signatures matches the data
+   signatures.assign(0x14 * TEST_SECTOR_COUNT, 0);
+
+   if(!pfs_has_icv(normal_file, CRYPTO_ENGINE_THROW_ERROR))
+   {
+      std::cout << "file with icv is not verified" << std::endl;
+      return 1;
+   }
+
+   if(run_verify_kernel(cryptops, normal_file, CRYPTO_ENGINE_THROW_ERROR, sectors, signatures) == 0)
+   {
+      std::cout << "wrong icv is not detected" << std::endl;
+      return 1;
+   }
+
+   //file without icv passes any check, so it must not be reported as verified
+   if(pfs_has_icv(normal_file | ATTR_NICV, CRYPTO_ENGINE_THROW_ERROR))
+   {
+      std::cout << "file without icv is reported as verified" << std::endl;
+      return 1;
+   }
+
+   if(run_verify_kernel(cryptops, normal_file | ATTR_NICV, CRYPTO_ENGINE_THROW_ERROR, sectors, signatures) != 0)
+   {
+      std::cout << "file without icv fails verification" << std::endl;
+      return 1;
+   }
+
+   if(pfs_has_icv(normal_file, CRYPTO_ENGINE_THROW_ERROR | CRYPTO_ENGINE_SKIP_VERIFY) || pfs_has_icv(normal_directory, CRYPTO_ENGINE_THROW_ERROR))
+   {
+      std::cout << "skipped verification is reported as verified" << std::endl;
+      return 1;
+   }
+
+   //verify-only kernel leaves data encrypted
+   if(sectors != original)
+   {
+      std::cout << "verify kernel modified data" << std::endl;
+      return 1;
+   }
+
+   std::cout << "files without icv are not reported as verified" << std::endl;
+   return 0;
+}
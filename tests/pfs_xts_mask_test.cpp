@@ -0,0 +1,200 @@
+//compares vectorized xts tweak sequence with the original adds/adcs implementation
+//and xts-aes functions with reference composed of adds/adcs tweaks and plain ecb
+//block counts cross the 4 block unroll of xts_xor_mask and chunk size of xts_xor_tweaks
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "PfsCryptEngineBase.h"
+#include "CryptoOperationsFactory.h"
+
+//xores data with tweaks of the original adds/adcs implementation
+static void reference_xor_tweaks(const unsigned char* tweak, std::uint32_t size, const unsigned char* src, unsigned char* dst)
+{
+   unsigned char t[0x10];
+   memcpy(t, tweak, 0x10);
+
+   std::vector<unsigned char> mask(size);
+   xts_generate_mask_generic(t, size, mask.data());
+
+   for(std::uint32_t i = 0; i < size; i++)
+      dst[i] = src[i] ^ mask[i];
+}
+
+static const std::uint32_t g_blockCounts[] = {1, 2, 3, 4, 5, 7, 8, 63, 64, 65, 255, 256, 257, 2048, 2049};
+
+static const std::uint32_t g_sizes[] = {0x10, 0x40, 0x50, 0xFF0, 0x1000, 0x1010, 0x2000, 0x8000, 0x8030};
+
+//tweaks where doubling carries out of every 32 bit lane and out of the top bit (reduced with 0x87)
+static void get_edge_tweaks(std::vector<std::vector<std::uint8_t> >& tweaks)
+{
+   static const std::uint32_t lanes[][4] = {
+      {0x00000000, 0x00000000, 0x00000000, 0x00000000},
+      {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF},
+      {0x00000000, 0x00000000, 0x00000000, 0x80000000},
+      {0x80000000, 0x80000000, 0x80000000, 0x80000000},
+      {0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF},
+      {0x80000000, 0x00000000, 0x00000000, 0x00000000},
+      {0x00000000, 0x80000000, 0x00000000, 0x00000000},
+      {0x00000000, 0x00000000, 0x80000000, 0x00000000},
+      {0x00000001, 0x00000000, 0x00000000, 0x00000000},
+   };
+
+   for(auto& l : lanes)
+   {
+      std::vector<std::uint8_t> tweak(0x10);
+      memcpy(tweak.data(), l, 0x10);
+      tweaks.push_back(tweak);
+   }
+}
+
+static void fill_random(std::mt19937& rng, std::uint8_t* data, std::size_t size)
+{
+   for(std::size_t i = 0; i < size; i++)
+      data[i] = static_cast<std::uint8_t>(rng());
+}
+
+static int check_mask(const std::vector<std::uint8_t>& tweak, std::uint32_t nBlocks, std::mt19937& rng)
+{
+   std::uint32_t size = nBlocks * 0x10;
+
+   std::vector<std::uint8_t> src(size);
+   fill_random(rng, src.data(), size);
+
+   std::vector<std::uint8_t> expected(size);
+   reference_xor_tweaks(tweak.data(), size, src.data(), expected.data());
+
+   //whole mask at once
+   std::vector<std::uint8_t> mask(size);
+   std::vector<std::uint8_t> actual(size);
+   unsigned char t[0x10];
+   memcpy(t, tweak.data(), 0x10);
+   xts_generate_mask(t, size, mask.data());
+   xts_xor_mask(src.data(), mask.data(), actual.data(), size);
+
+   if(actual != expected)
+   {
+      std::cout << "mask of " << nBlocks << " blocks does not match" << std::endl;
+      return -1;
+   }
+
+   //mask continued from advanced tweak in two parts and xored in place
+   std::uint32_t first = (nBlocks / 2) * 0x10;
+   memcpy(t, tweak.data(), 0x10);
+   xts_generate_mask(t, first, mask.data());
+   xts_generate_mask(t, size - first, mask.data() + first);
+
+   actual = src;
+   xts_xor_mask(actual.data(), mask.data(), actual.data(), size);
+
+   if(actual != expected)
+   {
+      std::cout << "continued mask of " << nBlocks << " blocks does not match" << std::endl;
+      return -1;
+   }
+
+   //mask in chunks of stack buffer
+   xts_xor_tweaks(tweak.data(), size, src.data(), actual.data());
+
+   if(actual != expected)
+   {
+      std::cout << "chunked mask of " << nBlocks << " blocks does not match" << std::endl;
+      return -1;
+   }
+
+   return 0;
+}
+
+//xts-aes with tweaks of adds/adcs implementation
+static void reference_xts(std::shared_ptr<ICryptoOperations> cryptops, bool decrypt, const unsigned char* tweak, const unsigned char* dst_key, const unsigned char* tweak_enc_key,
+                          std::uint32_t key_size, std::uint32_t size, const unsigned char* src, unsigned char* dst)
+{
+   unsigned char tweak_enc_value[0x10];
+   cryptops->aes_ecb_encrypt(tweak, tweak_enc_value, 0x10, tweak_enc_key, key_size);
+
+   reference_xor_tweaks(tweak_enc_value, size, src, dst);
+
+   if(decrypt)
+      cryptops->aes_ecb_decrypt(dst, dst, size, dst_key, key_size);
+   else
+      cryptops->aes_ecb_encrypt(dst, dst, size, dst_key, key_size);
+
+   reference_xor_tweaks(tweak_enc_value, size, dst, dst);
+}
+
+static int check_xts(std::shared_ptr<ICryptoOperations> cryptops, std::uint32_t key_size, std::uint32_t size, std::mt19937& rng)
+{
+   unsigned char tweak[0x10];
+   unsigned char dst_key[0x20];
+   unsigned char tweak_enc_key[0x20];
+   fill_random(rng, tweak, sizeof(tweak));
+   fill_random(rng, dst_key, sizeof(dst_key));
+   fill_random(rng, tweak_enc_key, sizeof(tweak_enc_key));
+
+   std::vector<unsigned char> src(size);
+   fill_random(rng, src.data(), size);
+
+   std::vector<unsigned char> expected(size);
+   std::vector<unsigned char> actual(size);
+
+   reference_xts(cryptops, false, tweak, dst_key, tweak_enc_key, key_size, size, src.data(), expected.data());
+   XTSAESEncrypt_base(cryptops, tweak, dst_key, tweak_enc_key, key_size, size, src.data(), actual.data());
+
+   if(actual != expected)
+   {
+      std::cout << "xts-aes encrypt of " << size << " bytes with key size " << key_size << " does not match" << std::endl;
+      return -1;
+   }
+
+   //decryption is done in place like in crypt engine
+   reference_xts(cryptops, true, tweak, dst_key, tweak_enc_key, key_size, size, src.data(), expected.data());
+   actual = src;
+   XTSAESDecrypt_base(cryptops, tweak, dst_key, tweak_enc_key, key_size, size, actual.data(), actual.data());
+
+   if(actual != expected)
+   {
+      std::cout << "xts-aes decrypt of " << size << " bytes with key size " << key_size << " does not match" << std::endl;
+      return -1;
+   }
+
+   return 0;
+}
+
+int main()
+{
+   std::mt19937 rng(0x50465331);
+
+   std::vector<std::vector<std::uint8_t> > tweaks;
+   get_edge_tweaks(tweaks);
+
+   for(int i = 0; i < 64; i++)
+   {
+      std::vector<std::uint8_t> tweak(0x10);
+      fill_random(rng, tweak.data(), tweak.size());
+      tweaks.push_back(tweak);
+   }
+
+   for(auto& tweak : tweaks)
+   {
+      for(std::uint32_t nBlocks : g_blockCounts)
+      {
+         if(check_mask(tweak, nBlocks, rng) < 0)
+            return 1;
+      }
+   }
+
+   std::shared_ptr<ICryptoOperations> cryptops = CryptoOperationsFactory::create(CryptoOperationsTypes::openssl);
+
+   //goes through aes-ni kernel if cpu supports it and through generated mask otherwise
+   for(std::uint32_t size : g_sizes)
+   {
+      if(check_xts(cryptops, 0x80, size, rng) < 0)
+         return 1;
+   }
+
+   std::cout << "xts mask matches reference for " << tweaks.size() << " tweaks" << std::endl;
+   return 0;
+}